@@ -0,0 +1,229 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/program_options.hpp>
+#include "../../shared/utilities/compression.h"
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+/*
+ * This benchmark measures the CPU cost of the CONTENT TLV compression
+ * against the bytes it saves. The corpus is split in chunks of the size
+ * of a CONTENT TLV, that are compressed as f_message::next_chunk does:
+ * the sampling check skips the data that looks random and a compressed
+ * chunk is kept only if it shrinks. The same chunks are also compressed
+ * without the sampling check, to show what the check saves. The corpus
+ * is a mixed synthetic one (source, logs, random and already compressed
+ * data) or the files of --dir, grouped by extension.
+ */
+
+namespace {
+    // about the data length of the CONTENT TLV of a full chunk
+    size_t const TLV_DATA_SIZE = compression::MAX_SIZE - 512;
+}
+
+po::variables_map parse_options(int argc, char const *const argv[]) {
+    try {
+        po::options_description desc("Compression benchmark options");
+        desc.add_options()
+                ("help,h",
+                 "produce help message")
+                ("dir,P",
+                 po::value<fs::path>(),
+                 "set the directory of the corpus files, instead of the synthetic corpus")
+                ("size,M",
+                 po::value<size_t>()->default_value(16 * 1024 * 1024),
+                 "set the size in bytes of each part of the synthetic corpus")
+                ("min-time,t",
+                 po::value<double>()->default_value(1),
+                 "set the minimum time in seconds each part of the corpus is compressed for");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            std::exit(EXIT_SUCCESS);
+        }
+
+        po::notify(vm);
+        return vm;
+    }
+    catch (std::exception &ex) {
+        std::cout << "Error during options parsing:\n\t" << ex.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Allow to build the synthetic corpus: source code, logs, random data
+ * and already compressed data, each one of the requested size
+ *
+ * @param size the size of each part of the corpus
+ * @return the corpus parts, by name
+ */
+std::map<std::string, std::vector<uint8_t>> synthetic_corpus(size_t size) {
+    std::map<std::string, std::vector<uint8_t>> corpus;
+    std::mt19937_64 random{size};
+    std::vector<std::string> const words{
+            "auto", "size_t", "this->", "return", "if", "for", "const", "std::vector<uint8_t>",
+            "buffer", "length", "offset", "path", "rsrc", "digest", "++i", "nullptr", "{", "}"
+    };
+
+    std::string source;
+    while (source.size() < size) {
+        source.append(random() % 4 * 4, ' ');
+        for (size_t i = 0, n = 3 + random() % 8; i < n; i++) source += words[random() % words.size()] + ' ';
+        source += ";\n";
+    }
+    corpus["source"].assign(source.cbegin(), source.cbegin() + static_cast<std::ptrdiff_t>(size));
+
+    std::string log;
+    for (size_t line = 0; log.size() < size; line++) {
+        log += "2021-06-" + std::to_string(10 + line / 86400 % 20) + " " + std::to_string(line / 3600 % 24)
+               + ":" + std::to_string(line / 60 % 60) + ":" + std::to_string(line % 60)
+               + (random() % 16 ? " INFO " : " WARN ") + "request " + std::to_string(random() % 100000)
+               + " served in " + std::to_string(random() % 1000) + " us\n";
+    }
+    corpus["log"].assign(log.cbegin(), log.cbegin() + static_cast<std::ptrdiff_t>(size));
+
+    auto &random_data = corpus["random"];
+    random_data.resize(size);
+    for (auto &byte : random_data) byte = static_cast<uint8_t>(random());
+
+    // already compressed data, as zip archives, images or videos
+    auto &compressed = corpus["compressed"];
+    compressed.reserve(size);
+    std::vector<uint8_t> buffer(TLV_DATA_SIZE);
+    for (size_t offset = 0; compressed.size() < size; offset = (offset + TLV_DATA_SIZE) % (size - TLV_DATA_SIZE)) {
+        size_t length = compression::compress(
+                communication::COMPRESSION_TYPE::COMPRESSION_ZLIB,
+                corpus["log"].data() + offset,
+                TLV_DATA_SIZE,
+                buffer.data(),
+                buffer.size()
+        );
+        compressed.insert(compressed.end(), buffer.cbegin(), buffer.cbegin() + static_cast<std::ptrdiff_t>(length));
+    }
+    compressed.resize(size);
+    return corpus;
+}
+
+/**
+ * Allow to build the corpus from the regular files of a directory,
+ * grouping their content by extension
+ *
+ * @param dir the directory path
+ * @return the corpus parts, by extension
+ */
+std::map<std::string, std::vector<uint8_t>> dir_corpus(fs::path const &dir) {
+    std::map<std::string, std::vector<uint8_t>> corpus;
+    for (auto const &entry : fs::recursive_directory_iterator(dir)) {
+        if (!fs::is_regular_file(entry.status())) continue;
+        auto extension = entry.path().extension().string();
+        auto &part = corpus[extension.empty() ? "(none)" : extension];
+        size_t offset = part.size();
+        part.resize(offset + fs::file_size(entry.path()));
+        fs::ifstream ifs{entry.path(), std::ios_base::binary};
+        ifs.read(reinterpret_cast<char *>(part.data() + offset), static_cast<std::streamsize>(part.size() - offset));
+        part.resize(offset + static_cast<size_t>(ifs.gcount()));
+    }
+    return corpus;
+}
+
+/*
+ * The result of the compression of a corpus part
+ */
+struct result {
+    size_t sent = 0;
+    double seconds = 0;
+};
+
+/**
+ * Allow to compress a corpus part chunk by chunk, as f_message::next_chunk does,
+ * until the minimum time is elapsed
+ *
+ * @param data the corpus part
+ * @param sampling true if the chunks that look random have to be skipped
+ * @param min_time the minimum time in seconds
+ * @return the bytes sent for the whole part and the seconds it took
+ */
+result run(std::vector<uint8_t> const &data, bool sampling, double min_time) {
+    static std::vector<uint8_t> compressed(compression::MAX_SIZE);
+    result res;
+    size_t count = 0;
+    auto start = std::chrono::steady_clock::now();
+    do {
+        res.sent = 0;
+        for (size_t offset = 0; offset < data.size(); offset += TLV_DATA_SIZE) {
+            size_t length = std::min(TLV_DATA_SIZE, data.size() - offset);
+            size_t compressed_length = 0;
+            if (!sampling || compression::compressible(data.data() + offset, length)) {
+                compressed_length = compression::compress(
+                        communication::COMPRESSION_TYPE::COMPRESSION_ZLIB,
+                        data.data() + offset,
+                        length,
+                        compressed.data(),
+                        length - 1
+                );
+            }
+            res.sent += compressed_length ? compressed_length : length;
+        }
+        count++;
+        res.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (res.seconds < min_time);
+    res.seconds /= static_cast<double>(count);
+    return res;
+}
+
+int main(int argc, char const *const argv[]) {
+    po::variables_map vm = parse_options(argc, argv);
+    double min_time = vm["min-time"].as<double>();
+
+    try {
+        auto corpus = vm.count("dir")
+                      ? dir_corpus(vm["dir"].as<fs::path>())
+                      : synthetic_corpus(std::max<size_t>(vm["size"].as<size_t>(), 2 * TLV_DATA_SIZE));
+
+        std::cout << std::setw(12) << "corpus" << std::setw(12) << "bytes" << std::setw(10) << "sampling"
+                  << std::setw(10) << "saved %" << std::setw(12) << "ms/MiB" << std::setw(12) << "MiB/s" << std::endl;
+        size_t total = 0;
+        result totals[2];
+        for (auto const &[name, data] : corpus) {
+            if (data.empty()) continue;
+            total += data.size();
+            double mib = static_cast<double>(data.size()) / (1024 * 1024);
+            for (bool sampling : {true, false}) {
+                auto res = run(data, sampling, min_time);
+                totals[sampling].sent += res.sent;
+                totals[sampling].seconds += res.seconds;
+                std::cout << std::setw(12) << name << std::setw(12) << data.size()
+                          << std::setw(10) << (sampling ? "yes" : "no") << std::fixed << std::setprecision(1)
+                          << std::setw(10) << 100 * (1 - static_cast<double>(res.sent) / static_cast<double>(data.size()))
+                          << std::setw(12) << res.seconds * 1000 / mib
+                          << std::setw(12) << mib / res.seconds << std::endl;
+            }
+        }
+        if (total == 0) return 0;
+        double mib = static_cast<double>(total) / (1024 * 1024);
+        for (bool sampling : {true, false}) {
+            std::cout << std::setw(12) << "total" << std::setw(12) << total
+                      << std::setw(10) << (sampling ? "yes" : "no") << std::fixed << std::setprecision(1)
+                      << std::setw(10) << 100 * (1 - static_cast<double>(totals[sampling].sent) / static_cast<double>(total))
+                      << std::setw(12) << totals[sampling].seconds * 1000 / mib
+                      << std::setw(12) << mib / totals[sampling].seconds << std::endl;
+        }
+    }
+    catch (fs::filesystem_error &ex) {
+        std::cerr << "Filesystem error:\n\t" << ex.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return 0;
+}
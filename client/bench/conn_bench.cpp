@@ -0,0 +1,327 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/program_options.hpp>
+#include "../../shared/communication/message.h"
+#include "../../shared/communication/tlv_view.h"
+
+namespace po = boost::program_options;
+namespace ssl = boost::asio::ssl;
+using tcp = boost::asio::ip::tcp;
+using steady_clock = std::chrono::steady_clock;
+
+/*
+ * This benchmark measures how the server scales with the number of
+ * concurrent clients. For each step, from 1 to --max-clients clients
+ * connect, authenticate, list the user directory (better if almost
+ * empty) and then send KEEP_ALIVE requests, each one as soon as the
+ * previous reply is received. The time needed to set up all
+ * the connections, the served requests per second and the request
+ * latencies are reported, so that the server can be compared with and
+ * without --per-core. The server file descriptor limit (ulimit -n) has
+ * to be raised for several thousand clients.
+ */
+
+po::variables_map parse_options(int argc, char const *const argv[]) {
+    try {
+        po::options_description desc("Connection scaling benchmark options");
+        desc.add_options()
+                ("help,h",
+                 "produce help message")
+                ("hostname,H",
+                 po::value<std::string>()->required(),
+                 "set backup server hostname")
+                ("service,S",
+                 po::value<std::string>()->required(),
+                 "set backup server service name/port number")
+                ("username,u",
+                 po::value<std::string>()->required(),
+                 "set the username the clients authenticate with")
+                ("password,p",
+                 po::value<std::string>()->required(),
+                 "set the password the clients authenticate with")
+                ("max-clients,C",
+                 po::value<size_t>()->default_value(4096),
+                 "set the number of concurrent clients of the last step")
+                ("duration,d",
+                 po::value<size_t>()->default_value(5),
+                 "set the duration in seconds of the measure of each step")
+                ("ca-file,A",
+                 po::value<std::string>()->default_value("../files/certs/ca.pem"),
+                 "set the certificate authority file");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            std::exit(EXIT_SUCCESS);
+        }
+
+        po::notify(vm);
+        return vm;
+    }
+    catch (std::exception &ex) {
+        std::cout << "Error during options parsing:\n\t" << ex.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/*
+ * The results of a step, shared by all its clients
+ */
+struct stats {
+    size_t connected = 0;
+    size_t failed = 0;
+    bool measuring = false;
+    bool stopping = false;
+    std::vector<double> latencies_ms;
+};
+
+/**
+ * Allow to frame a message as the client does: its size followed by its content
+ *
+ * @param msg the message that has to be framed
+ * @return the framed message
+ */
+std::vector<uint8_t> frame(communication::message const &msg) {
+    auto raw_msg_ptr = msg.raw_msg_ptr();
+    size_t header = raw_msg_ptr->size();
+    std::vector<uint8_t> framed(sizeof(header));
+    std::memcpy(framed.data(), &header, sizeof(header));
+    framed.insert(framed.end(), raw_msg_ptr->cbegin(), raw_msg_ptr->cend());
+    return framed;
+}
+
+/*
+ * A benchmark client: once authenticated and synced, it sends a KEEP_ALIVE
+ * request each time the previous reply is received, until the step ends.
+ */
+class bench_client : public std::enable_shared_from_this<bench_client> {
+    ssl::stream<tcp::socket> socket_;
+    stats &stats_;
+    std::vector<uint8_t> const &auth_;
+    std::vector<uint8_t> const &list_;
+    std::vector<uint8_t> const &keep_alive_;
+    size_t header_ = 0;
+    std::shared_ptr<std::vector<uint8_t>> reply_ptr_;
+    bool authenticated_ = false;
+    bool synced_ = false;
+    steady_clock::time_point sent_;
+
+public:
+    bench_client(
+            boost::asio::io_context &io,
+            ssl::context &ctx,
+            stats &stats,
+            std::vector<uint8_t> const &auth,
+            std::vector<uint8_t> const &list,
+            std::vector<uint8_t> const &keep_alive
+    ) : socket_{io, ctx}, stats_{stats}, auth_{auth}, list_{list}, keep_alive_{keep_alive} {}
+
+    /**
+     * Allow to connect and authenticate the client
+     *
+     * @param endpoints the server endpoints
+     * @return void
+     */
+    void start(tcp::resolver::results_type const &endpoints) {
+        boost::asio::async_connect(
+                this->socket_.lowest_layer(),
+                endpoints,
+                [self = this->shared_from_this()](boost::system::error_code const &ec, tcp::endpoint const &) {
+                    if (ec) return self->fail();
+                    self->socket_.async_handshake(
+                            ssl::stream_base::client,
+                            [self](boost::system::error_code const &ec) {
+                                if (ec) return self->fail();
+                                self->send(self->auth_);
+                            }
+                    );
+                }
+        );
+    }
+
+    /**
+     * Allow to close the client connection
+     *
+     * @return void
+     */
+    void close() {
+        boost::system::error_code ec;
+        this->socket_.lowest_layer().close(ec);
+    }
+
+private:
+    void fail() {
+        if (!this->synced_) this->stats_.failed++;
+        this->close();
+    }
+
+    /**
+     * Allow to send a request, reading its reply once it has been sent
+     *
+     * @param request the framed request
+     * @return void
+     */
+    void send(std::vector<uint8_t> const &request) {
+        this->sent_ = steady_clock::now();
+        boost::asio::async_write(
+                this->socket_,
+                boost::asio::buffer(request),
+                [self = this->shared_from_this()](boost::system::error_code const &ec, size_t) {
+                    if (ec) return self->fail();
+                    self->reply_ptr_ = std::make_shared<std::vector<uint8_t>>();
+                    self->read(true);
+                }
+        );
+    }
+
+    /**
+     * Allow to read a part of a reply, going on until the reply END
+     *
+     * @param first true if the first part of the reply has to be read
+     * @return void
+     */
+    void read(bool first) {
+        boost::asio::async_read(
+                this->socket_,
+                boost::asio::buffer(&this->header_, sizeof(this->header_)),
+                [self = this->shared_from_this(), first](boost::system::error_code const &ec, size_t) {
+                    if (ec) return self->fail();
+                    size_t offset = self->reply_ptr_->size();
+                    self->reply_ptr_->resize(offset + self->header_);
+                    boost::asio::async_read(
+                            self->socket_,
+                            boost::asio::buffer(self->reply_ptr_->data() + offset, self->header_),
+                            [self, first, offset](boost::system::error_code const &ec, size_t) {
+                                if (ec) return self->fail();
+                                // the parts following the first one start with the message type
+                                if (!first) self->reply_ptr_->erase(self->reply_ptr_->begin() + offset);
+                                communication::message reply{self->reply_ptr_};
+                                communication::tlv_view view{reply};
+                                bool ended = false;
+                                while (view.next_tlv()) if (view.tlv_type() == communication::END) ended = true;
+                                if (!ended) return self->read(false);
+                                self->handle_reply(reply);
+                            }
+                    );
+                }
+        );
+    }
+
+    /**
+     * Allow to handle a complete reply, sending the next request
+     *
+     * @param reply the reply
+     * @return void
+     */
+    void handle_reply(communication::message const &reply) {
+        communication::tlv_view view{reply};
+        while (view.next_tlv()) if (view.tlv_type() == communication::TLV_TYPE::ERROR) return this->fail();
+        if (!this->authenticated_) {
+            // the server accepts KEEP_ALIVE requests only after the LIST one
+            this->authenticated_ = true;
+            return this->send(this->list_);
+        }
+        if (!this->synced_) {
+            this->synced_ = true;
+            this->stats_.connected++;
+        } else if (this->stats_.measuring) {
+            this->stats_.latencies_ms.push_back(
+                    std::chrono::duration<double, std::milli>(steady_clock::now() - this->sent_).count()
+            );
+        }
+        if (this->stats_.stopping) return this->close();
+        this->send(this->keep_alive_);
+    }
+};
+
+/**
+ * Allow to obtain a percentile of the sorted latencies
+ *
+ * @param latencies the sorted latencies
+ * @param percentile the percentile, between 0 and 1
+ * @return the latency of the percentile
+ */
+double percentile(std::vector<double> const &latencies, double percentile) {
+    if (latencies.empty()) return 0;
+    return latencies[static_cast<size_t>(percentile * static_cast<double>(latencies.size() - 1))];
+}
+
+int main(int argc, char const *const argv[]) {
+    po::variables_map vm = parse_options(argc, argv);
+    size_t max_clients = std::max<size_t>(vm["max-clients"].as<size_t>(), 1);
+    auto duration = std::chrono::seconds{vm["duration"].as<size_t>()};
+    std::string const &username = vm["username"].as<std::string>();
+    std::string const &password = vm["password"].as<std::string>();
+
+    communication::message auth_msg{communication::MSG_TYPE::AUTH};
+    auth_msg.add_TLV(communication::TLV_TYPE::USRN, username.size(), username.c_str());
+    auth_msg.add_TLV(communication::TLV_TYPE::PSWD, password.size(), password.c_str());
+    auth_msg.add_TLV(communication::TLV_TYPE::END);
+    communication::message list_msg{communication::MSG_TYPE::LIST};
+    list_msg.add_TLV(communication::TLV_TYPE::END);
+    communication::message keep_alive_msg{communication::MSG_TYPE::KEEP_ALIVE};
+    keep_alive_msg.add_TLV(communication::TLV_TYPE::END);
+    auto auth = frame(auth_msg);
+    auto list = frame(list_msg);
+    auto keep_alive = frame(keep_alive_msg);
+
+    try {
+        boost::asio::io_context io;
+        ssl::context ctx{ssl::context::sslv23};
+        ctx.load_verify_file(vm["ca-file"].as<std::string>());
+        ctx.set_verify_mode(ssl::verify_peer | ssl::verify_fail_if_no_peer_cert);
+        tcp::resolver resolver{io};
+        auto endpoints = resolver.resolve(vm["hostname"].as<std::string>(), vm["service"].as<std::string>());
+
+        std::cout << std::setw(8) << "clients" << std::setw(8) << "failed" << std::setw(12) << "setup s"
+                  << std::setw(12) << "req/s" << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::endl;
+        std::vector<size_t> steps;
+        for (size_t clients = 1; clients < max_clients; clients *= 4) steps.push_back(clients);
+        steps.push_back(max_clients);
+        for (size_t clients : steps) {
+            stats stats;
+            std::vector<std::shared_ptr<bench_client>> bench_clients;
+            bench_clients.reserve(clients);
+            io.restart();
+            auto start = steady_clock::now();
+            for (size_t i = 0; i < clients; i++) {
+                bench_clients.push_back(std::make_shared<bench_client>(io, ctx, stats, auth, list, keep_alive));
+                bench_clients.back()->start(endpoints);
+            }
+            while (stats.connected + stats.failed < clients && steady_clock::now() - start < std::chrono::minutes{1}) {
+                io.run_one_for(std::chrono::seconds{1});
+            }
+            double setup = std::chrono::duration<double>(steady_clock::now() - start).count();
+
+            stats.measuring = true;
+            io.run_for(duration);
+            stats.measuring = false;
+            stats.stopping = true;
+            for (auto &bench_client : bench_clients) bench_client->close();
+            io.run();
+
+            std::sort(stats.latencies_ms.begin(), stats.latencies_ms.end());
+            std::cout << std::setw(8) << clients << std::setw(8) << stats.failed
+                      << std::fixed << std::setprecision(2) << std::setw(12) << setup
+                      << std::setprecision(0) << std::setw(12)
+                      << static_cast<double>(stats.latencies_ms.size()) / static_cast<double>(duration.count())
+                      << std::setprecision(2) << std::setw(10) << percentile(stats.latencies_ms, 0.5)
+                      << std::setw(10) << percentile(stats.latencies_ms, 0.99) << std::endl;
+        }
+    }
+    catch (std::exception &ex) {
+        std::cerr << "Error in main():\n\t" << ex.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+namespace po = boost::program_options;
+using tcp = boost::asio::ip::tcp;
+using steady_clock = std::chrono::steady_clock;
+
+/*
+ * This benchmark tool is a TCP proxy that delays the data forwarded in both
+ * directions, so that the client can be measured on a high latency link
+ * where netem is not available. The round trip time added is twice the
+ * delay. Each burst of data sent by a client, ended by a second without
+ * data, is reported with its throughput, so the upload of the same file
+ * can be compared for different --window values, e.g.
+ *
+ *   ./server
+ *   ./delay_proxy -L 6055 -H localhost -S 5055 -D 25
+ *   ./client -H localhost -S 6055 -C 1 -W 1
+ */
+
+namespace {
+    size_t const BUFFER_SIZE = 64 * 1024;
+    auto const BURST_GAP = std::chrono::seconds{1};
+    size_t next_session_id = 1;
+}
+
+po::variables_map parse_options(int argc, char const *const argv[]) {
+    try {
+        po::options_description desc("Delay proxy options");
+        desc.add_options()
+                ("help,h",
+                 "produce help message")
+                ("listen-port,L",
+                 po::value<unsigned short>()->required(),
+                 "set the port the proxy listens on")
+                ("hostname,H",
+                 po::value<std::string>()->required(),
+                 "set backup server hostname")
+                ("service,S",
+                 po::value<std::string>()->required(),
+                 "set backup server service name/port number")
+                ("delay,D",
+                 po::value<size_t>()->default_value(25),
+                 "set the delay in milliseconds added in each direction");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            std::exit(EXIT_SUCCESS);
+        }
+
+        po::notify(vm);
+        return vm;
+    }
+    catch (std::exception &ex) {
+        std::cout << "Error during options parsing:\n\t" << ex.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/*
+ * One direction of a proxied connection: the data read from a socket
+ * is written on the other one, in order, once its delay is elapsed.
+ */
+class delayed_pipe : public std::enable_shared_from_this<delayed_pipe> {
+    struct segment {
+        steady_clock::time_point due;
+        std::vector<char> data;
+    };
+
+    std::shared_ptr<tcp::socket> from_;
+    std::shared_ptr<tcp::socket> to_;
+    steady_clock::duration delay_;
+    boost::asio::steady_timer timer_;
+    std::deque<segment> segments_;
+    std::vector<char> buffer_;
+    bool writing_ = false;
+    bool ended_ = false;
+    // the name the bursts are reported with, empty if they are not reported
+    std::string name_;
+    size_t burst_bytes_ = 0;
+    steady_clock::time_point burst_start_;
+    steady_clock::time_point burst_last_;
+    boost::asio::steady_timer burst_timer_;
+
+public:
+    delayed_pipe(
+            std::shared_ptr<tcp::socket> from,
+            std::shared_ptr<tcp::socket> to,
+            steady_clock::duration delay,
+            std::string name
+    ) : from_{std::move(from)},
+        to_{std::move(to)},
+        delay_{delay},
+        timer_{from_->get_executor()},
+        buffer_(BUFFER_SIZE),
+        name_{std::move(name)},
+        burst_timer_{from_->get_executor()} {}
+
+    /**
+     * Allow to read the data that has to be forwarded
+     *
+     * @return void
+     */
+    void read() {
+        this->from_->async_read_some(
+                boost::asio::buffer(this->buffer_),
+                [self = this->shared_from_this()](boost::system::error_code const &ec, size_t length) {
+                    if (ec) {
+                        self->ended_ = true;
+                        if (!self->writing_) self->write();
+                        return;
+                    }
+                    auto now = steady_clock::now();
+                    self->segments_.push_back(segment{
+                            now + self->delay_,
+                            std::vector<char>(self->buffer_.begin(), self->buffer_.begin() + length)
+                    });
+                    if (!self->name_.empty()) self->count(now, length);
+                    if (!self->writing_) self->write();
+                    self->read();
+                }
+        );
+    }
+
+private:
+    /**
+     * Allow to write the first pending segment once its delay is elapsed.
+     * The write side is shut down once the read side ended.
+     *
+     * @return void
+     */
+    void write() {
+        if (this->segments_.empty()) {
+            this->writing_ = false;
+            boost::system::error_code ec;
+            if (this->ended_) this->to_->shutdown(tcp::socket::shutdown_send, ec);
+            return;
+        }
+        this->writing_ = true;
+        this->timer_.expires_at(this->segments_.front().due);
+        this->timer_.async_wait([self = this->shared_from_this()](boost::system::error_code const &) {
+            boost::asio::async_write(
+                    *self->to_,
+                    boost::asio::buffer(self->segments_.front().data),
+                    [self](boost::system::error_code const &ec, size_t) {
+                        if (ec) {
+                            boost::system::error_code sec;
+                            self->from_->shutdown(tcp::socket::shutdown_receive, sec);
+                            self->segments_.clear();
+                            self->writing_ = false;
+                            return;
+                        }
+                        self->segments_.pop_front();
+                        self->write();
+                    }
+            );
+        });
+    }
+
+    /**
+     * Allow to account the data read in the current burst, that is
+     * reported once no data is read for BURST_GAP
+     *
+     * @param now the time the data has been read
+     * @param length the read data length
+     * @return void
+     */
+    void count(steady_clock::time_point now, size_t length) {
+        if (this->burst_bytes_ == 0) this->burst_start_ = now;
+        this->burst_bytes_ += length;
+        this->burst_last_ = now;
+        this->burst_timer_.expires_after(BURST_GAP);
+        this->burst_timer_.async_wait([self = this->shared_from_this()](boost::system::error_code const &ec) {
+            if (ec || self->burst_bytes_ == 0) return;
+            double seconds = std::chrono::duration<double>(self->burst_last_ - self->burst_start_).count();
+            std::cout << self->name_ << ": " << self->burst_bytes_ << " bytes in "
+                      << std::fixed << std::setprecision(3) << seconds << " s";
+            if (seconds > 0) std::cout << " (" << self->burst_bytes_ / seconds / (1024 * 1024) << " MiB/s)";
+            std::cout << std::endl;
+            self->burst_bytes_ = 0;
+        });
+    }
+};
+
+/**
+ * Allow to accept the client connections, connecting each one to the server
+ * and forwarding the data in both directions with the requested delay
+ *
+ * @param acceptor the acceptor of the client connections
+ * @param endpoints the server endpoints
+ * @param delay the delay added in each direction
+ * @return void
+ */
+void accept(
+        tcp::acceptor &acceptor,
+        tcp::resolver::results_type const &endpoints,
+        steady_clock::duration delay
+) {
+    acceptor.async_accept([&acceptor, &endpoints, delay](boost::system::error_code const &ec, tcp::socket socket) {
+        if (!ec) {
+            auto client = std::make_shared<tcp::socket>(std::move(socket));
+            auto server = std::make_shared<tcp::socket>(acceptor.get_executor());
+            boost::system::error_code cec;
+            boost::asio::connect(*server, endpoints, cec);
+            if (cec) {
+                std::cerr << "Failed to connect to the server:\n\t" << cec.message() << std::endl;
+            } else {
+                client->set_option(tcp::no_delay{true});
+                server->set_option(tcp::no_delay{true});
+                std::string name = "connection " + std::to_string(next_session_id++);
+                std::make_shared<delayed_pipe>(client, server, delay, name)->read();
+                std::make_shared<delayed_pipe>(server, client, delay, "")->read();
+            }
+        }
+        accept(acceptor, endpoints, delay);
+    });
+}
+
+int main(int argc, char const *const argv[]) {
+    po::variables_map vm = parse_options(argc, argv);
+    try {
+        boost::asio::io_context io_context;
+        tcp::resolver resolver{io_context};
+        auto endpoints = resolver.resolve(vm["hostname"].as<std::string>(), vm["service"].as<std::string>());
+        tcp::acceptor acceptor{io_context, tcp::endpoint{tcp::v4(), vm["listen-port"].as<unsigned short>()}};
+        steady_clock::duration delay = std::chrono::milliseconds{vm["delay"].as<size_t>()};
+        accept(acceptor, endpoints, delay);
+        io_context.run();
+    }
+    catch (std::exception &ex) {
+        std::cerr << "Error in main():\n\t" << ex.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return 0;
+}
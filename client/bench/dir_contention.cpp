@@ -0,0 +1,154 @@
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <boost/program_options.hpp>
+#include "../../shared/directory/dir.h"
+#include "../directory/c_resource.h"
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+/*
+ * This benchmark measures the contention on the directory representation
+ * shared by the file watcher, the io_context workers and the completion
+ * handlers. From 1 to --max-threads threads do a mix of rsrc() and
+ * insert_or_assign() calls on random paths of the same dir, which is
+ * compared with a single std::unordered_map guarded by one lock.
+ */
+
+po::variables_map parse_options(int argc, char const *const argv[]) {
+    try {
+        po::options_description desc("Directory contention benchmark options");
+        desc.add_options()
+                ("help,h",
+                 "produce help message")
+                ("entries,E",
+                 po::value<size_t>()->default_value(10000),
+                 "set the number of directory entries")
+                ("operations,O",
+                 po::value<size_t>()->default_value(200000),
+                 "set the number of operations done by each thread")
+                ("reads,R",
+                 po::value<unsigned>()->default_value(90),
+                 "set the percentage of rsrc() calls, the other ones are insert_or_assign() calls")
+                ("max-threads,T",
+                 po::value<size_t>()->default_value(32),
+                 "set the maximum number of threads");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            std::exit(EXIT_SUCCESS);
+        }
+
+        po::notify(vm);
+        return vm;
+    }
+    catch (std::exception &ex) {
+        std::cout << "Error during options parsing:\n\t" << ex.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/*
+ * The reference the dir is compared with: the whole content is guarded by a single lock
+ */
+class locked_map {
+    std::unordered_map<fs::path, directory::c_resource> content_;
+    mutable std::mutex m_;
+
+public:
+    bool insert_or_assign(fs::path const &path, directory::c_resource const &rsrc) {
+        std::unique_lock ul{this->m_};
+        return this->content_.insert_or_assign(path, rsrc).second;
+    }
+
+    std::optional<directory::c_resource> rsrc(fs::path const &path) const {
+        std::unique_lock ul{this->m_};
+        auto it = this->content_.find(path);
+        if (it == this->content_.end()) return std::nullopt;
+        return it->second;
+    }
+};
+
+/**
+ * Allow to run the mixed workload on a directory representation
+ *
+ * @param map the directory representation
+ * @param paths the paths of the entries
+ * @param threads the number of threads
+ * @param operations the number of operations done by each thread
+ * @param reads the percentage of rsrc() calls
+ * @return the number of operations per second
+ */
+template<typename M>
+double run(M &map, std::vector<fs::path> const &paths, size_t threads, size_t operations, unsigned reads) {
+    directory::c_resource const rsrc{true, true, "D41D8CD98F00B204E9800998ECF8427E"};
+    std::atomic<bool> started = false;
+    std::atomic<size_t> found = 0;
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back([&, i]() {
+            std::mt19937_64 random{i};
+            std::uniform_int_distribution<size_t> path_dist{0, paths.size() - 1};
+            std::uniform_int_distribution<unsigned> op_dist{0, 99};
+            size_t local_found = 0;
+            while (!started) std::this_thread::yield();
+            for (size_t op = 0; op < operations; op++) {
+                auto const &path = paths[path_dist(random)];
+                if (op_dist(random) < reads) {
+                    if (map.rsrc(path)) local_found++;
+                } else map.insert_or_assign(path, rsrc);
+            }
+            found += local_found;
+        });
+    }
+    auto start = std::chrono::steady_clock::now();
+    started = true;
+    for (auto &worker : workers) worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return static_cast<double>(threads * operations) / seconds;
+}
+
+int main(int argc, char const *const argv[]) {
+    po::variables_map vm = parse_options(argc, argv);
+    size_t entries = std::max<size_t>(vm["entries"].as<size_t>(), 1);
+    size_t operations = vm["operations"].as<size_t>();
+    unsigned reads = std::min(vm["reads"].as<unsigned>(), 100u);
+    size_t max_threads = std::max<size_t>(vm["max-threads"].as<size_t>(), 1);
+
+    std::vector<fs::path> paths;
+    paths.reserve(entries);
+    for (size_t i = 0; i < entries; i++) {
+        paths.emplace_back("/dir" + std::to_string(i % 64) + "/file" + std::to_string(i) + ".txt");
+    }
+    directory::c_resource const rsrc{true, true, "D41D8CD98F00B204E9800998ECF8427E"};
+    auto dir_ptr = directory::dir<directory::c_resource>::get_instance("/", true);
+    locked_map map;
+    for (auto const &path : paths) {
+        dir_ptr->insert_or_assign(path, rsrc);
+        map.insert_or_assign(path, rsrc);
+    }
+
+    std::cout << entries << " entries, " << reads << "% rsrc(), "
+              << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "dir ops/s"
+              << std::setw(16) << "locked ops/s" << std::setw(10) << "speedup" << std::endl;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        double dir_rate = run(*dir_ptr, paths, threads, operations, reads);
+        double map_rate = run(map, paths, threads, operations, reads);
+        std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0)
+                  << std::setw(16) << dir_rate << std::setw(16) << map_rate
+                  << std::setprecision(2) << std::setw(10) << dir_rate / map_rate << std::endl;
+    }
+    return 0;
+}
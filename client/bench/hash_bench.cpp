@@ -0,0 +1,128 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/program_options.hpp>
+#include "../../shared/utilities/hasher.h"
+#include "../../shared/utilities/tools.h"
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+
+/*
+ * This benchmark measures the file hashing done by the client scans and
+ * by the server checks (tools::file_hash) for each supported digest type,
+ * on files from 1 KB to 1 GB. Each file is hashed once to load it in the
+ * page cache, then again until --min-time is elapsed, so the results are
+ * the hashing cost and not the disk throughput.
+ */
+
+po::variables_map parse_options(int argc, char const *const argv[]) {
+    try {
+        po::options_description desc("Hashing benchmark options");
+        desc.add_options()
+                ("help,h",
+                 "produce help message")
+                ("dir,P",
+                 po::value<fs::path>()->default_value(fs::temp_directory_path()),
+                 "set the directory the hashed files are written in")
+                ("max-size,M",
+                 po::value<uintmax_t>()->default_value(1024 * 1024 * 1024),
+                 "set the size in bytes of the largest hashed file")
+                ("min-time,t",
+                 po::value<double>()->default_value(1),
+                 "set the minimum time in seconds each file is hashed for");
+
+        po::variables_map vm;
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            std::exit(EXIT_SUCCESS);
+        }
+
+        po::notify(vm);
+        return vm;
+    }
+    catch (std::exception &ex) {
+        std::cout << "Error during options parsing:\n\t" << ex.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Allow to write a file of random content
+ *
+ * @param path the file path
+ * @param size the file size
+ * @return void
+ */
+void write_file(fs::path const &path, uintmax_t size) {
+    std::vector<uint64_t> block(1024 * 1024 / sizeof(uint64_t));
+    std::mt19937_64 random{size};
+    fs::ofstream ofs{path, std::ios_base::binary | std::ios_base::trunc};
+    for (uintmax_t written = 0; written < size && ofs;) {
+        for (auto &value : block) value = random();
+        auto length = std::min<uintmax_t>(size - written, block.size() * sizeof(uint64_t));
+        ofs.write(reinterpret_cast<char const *>(block.data()), static_cast<std::streamsize>(length));
+        written += length;
+    }
+    if (!ofs) throw fs::filesystem_error{"Failed to write file", path, boost::system::error_code{}};
+}
+
+/**
+ * Allow to obtain the name of a digest type
+ *
+ * @param digest_type the digest type
+ * @return the digest type name
+ */
+char const *digest_name(communication::DIGEST_TYPE digest_type) {
+    switch (digest_type) {
+        case communication::DIGEST_TYPE::DIGEST_MD5:
+            return "MD5";
+        case communication::DIGEST_TYPE::DIGEST_SHA256:
+            return "SHA256";
+    }
+    return "?";
+}
+
+int main(int argc, char const *const argv[]) {
+    po::variables_map vm = parse_options(argc, argv);
+    fs::path dir = vm["dir"].as<fs::path>();
+    uintmax_t max_size = vm["max-size"].as<uintmax_t>();
+    double min_time = vm["min-time"].as<double>();
+
+    std::cout << std::setw(12) << "size" << std::setw(10) << "digest"
+              << std::setw(14) << "us/file" << std::setw(12) << "MiB/s" << std::endl;
+    try {
+        for (uintmax_t size = 1024; size <= max_size; size *= 32) {
+            fs::path path = dir / fs::unique_path("hash_bench-%%%%%%%%.bin");
+            write_file(path, size);
+            for (auto digest_type : hasher::supported()) {
+                tools::file_hash(path, "bench.bin", digest_type);
+                size_t count = 0;
+                double seconds = 0;
+                auto start = std::chrono::steady_clock::now();
+                do {
+                    tools::file_hash(path, "bench.bin", digest_type);
+                    count++;
+                    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                } while (seconds < min_time);
+                std::cout << std::setw(12) << size << std::setw(10) << digest_name(digest_type)
+                          << std::fixed << std::setprecision(1)
+                          << std::setw(14) << seconds * 1e6 / static_cast<double>(count)
+                          << std::setw(12) << static_cast<double>(size * count) / seconds / (1024 * 1024)
+                          << std::endl;
+            }
+            fs::remove(path);
+        }
+    }
+    catch (fs::filesystem_error &ex) {
+        std::cerr << "Filesystem error:\n\t" << ex.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    return 0;
+}
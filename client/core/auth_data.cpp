@@ -47,3 +47,41 @@ auth_data::auth_data(std::string username, std::string password)
 void auth_data::authenticated(bool authenticated) {
     this->authenticated_ = authenticated;
 }
+
+/**
+* Getter for the digest type negotiated with the server.
+*
+* @return the digest type field value
+*/
+[[nodiscard]] communication::DIGEST_TYPE auth_data::digest_type() const {
+    return this->digest_type_;
+}
+
+/**
+* Allow to set the digest type negotiated with the server
+*
+* @param digest_type the new digest type
+* @return void
+*/
+void auth_data::digest_type(communication::DIGEST_TYPE digest_type) {
+    this->digest_type_ = digest_type;
+}
+
+/**
+* Getter for the compression type negotiated with the server
+*
+* @return the compression type field value
+*/
+[[nodiscard]] communication::COMPRESSION_TYPE auth_data::compression_type() const {
+    return this->compression_type_;
+}
+
+/**
+* Allow to set the compression type negotiated with the server
+*
+* @param compression_type the new compression type
+* @return void
+*/
+void auth_data::compression_type(communication::COMPRESSION_TYPE compression_type) {
+    this->compression_type_ = compression_type;
+}
@@ -1,6 +1,7 @@
 #ifndef REMOTE_BACKUP_M1_CLIENT_USER_H
 #define REMOTE_BACKUP_M1_CLIENT_USER_H
 #include <string>
+#include "../../shared/communication/types.h"
 
 /*
  * This class is used to store the user
@@ -10,6 +11,8 @@ class auth_data {
     std::string username_;
     std::string password_;
     bool authenticated_ = false;
+    communication::DIGEST_TYPE digest_type_ = communication::DIGEST_TYPE::DIGEST_MD5;
+    communication::COMPRESSION_TYPE compression_type_ = communication::COMPRESSION_TYPE::COMPRESSION_NONE;
 public:
     auth_data() = default;
     auth_data(std::string username, std::string password);
@@ -18,6 +21,10 @@ public:
     [[nodiscard]] std::string const& password() const;
     [[nodiscard]] bool authenticated() const;
     void authenticated(bool authenticated);
+    [[nodiscard]] communication::DIGEST_TYPE digest_type() const;
+    void digest_type(communication::DIGEST_TYPE digest_type);
+    [[nodiscard]] communication::COMPRESSION_TYPE compression_type() const;
+    void compression_type(communication::COMPRESSION_TYPE compression_type);
 };
 
 
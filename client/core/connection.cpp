@@ -8,21 +8,28 @@
 
 namespace ssl = boost::asio::ssl;
 
+namespace {
+    // stream ids are unique for the whole process; 0 means no stream
+    std::atomic<uint32_t> next_stream_id{1};
+}
+
 /**
  * Construct a connection instance with an associated
  * SSL socket and a thread to execute related completion handlers.
  *
  * @param io io_context object associated with socket operation
  * @param ctx ssl context object, used to specify SSL connection parameters
- * @param thread_pool_size the number of threads inside the thread
+ * @param window the maximum number of f_message chunks sent without waiting for the server reply
  * @return a new constructed connection instance
  */
 connection::connection(
         boost::asio::io_context &io,
-        ssl::context &ctx
+        ssl::context &ctx,
+        size_t window
 ) : strand_{boost::asio::make_strand(io)},
     socket_{strand_, ctx},
-    keepalive_timer_{strand_, boost::asio::chrono::seconds{KEEPALIVE_INT_S}} {
+    keepalive_timer_{strand_, boost::asio::chrono::seconds{KEEPALIVE_INT_S}},
+    window_{std::max<size_t>(window, 1)} {
 
     this->socket_.set_verify_mode(ssl::verify_peer | ssl::verify_fail_if_no_peer_cert);
 }
@@ -33,14 +40,15 @@ connection::connection(
  *
  * @param io io_context object associated with socket operation
  * @param ctx ssl context object, used to specify SSL connection parameters
- * @param thread_pool_size the number of threads inside the thread
+ * @param window the maximum number of f_message chunks sent without waiting for the server reply
  * @return a new constructed connection instance std::shared_ptr
  */
 std::shared_ptr<connection> connection::get_instance(
         boost::asio::io_context &io,
-        ssl::context &ctx
+        ssl::context &ctx,
+        size_t window
 ) {
-    return std::shared_ptr<connection>(new connection{io, ctx});
+    return std::shared_ptr<connection>(new connection{io, ctx, window});
 }
 
 
@@ -64,7 +72,10 @@ void connection::schedule_keepalive() {
         this->keepalive_timer_.expires_after(boost::asio::chrono::seconds{KEEPALIVE_INT_S});
         this->keepalive_timer_.async_wait(
                 [this](boost::system::error_code const &e) {
-                    if (!e) {
+                    if (!e && this->in_flight_ > 0) {
+                        // replies are still expected: the connection is not idle
+                        return schedule_keepalive();
+                    } else if (!e) {
                         communication::message msg{communication::MSG_TYPE::KEEP_ALIVE};
                         msg.add_TLV(communication::TLV_TYPE::END);
                         auto result = this->sync_post(msg);
@@ -102,25 +113,30 @@ void connection::resolve(std::string const &hostname, std::string const &service
 
 /**
  * Allow to establish an SSL socket connection for the first available already
- * resolved endpoint
+ * resolved endpoint. The connection is retried if it is closed during the
+ * handshake, e.g. by a server that is shutting down.
  *
  * @return void
  */
 void connection::connect() {
-    SSL_clear(this->socket_.native_handle());
     boost::system::error_code ec;
     do {
+        SSL_clear(this->socket_.native_handle());
         boost::asio::connect(this->socket_.lowest_layer(), this->endpoints_, ec);
+        if (!ec) {
+            this->socket_.lowest_layer().set_option(boost::asio::socket_base::keep_alive(true));
+            this->socket_.handshake(ssl::stream<boost::asio::ip::tcp::socket>::client, ec);
+            if (ec && ec != boost::asio::error::eof &&
+                ec != boost::asio::error::connection_reset &&
+                ec != boost::asio::error::broken_pipe) {
+                std::exit(EXIT_FAILURE);
+            }
+        }
         if (ec) {
             std::cerr << "Failed to connect. Retrying..." << std::endl;
             std::this_thread::sleep_for(std::chrono::seconds(RECONN_INT_S));
         }
     } while (ec);
-
-    this->socket_.lowest_layer().set_option(boost::asio::socket_base::keep_alive(true));
-    boost::system::error_code hec;
-    this->socket_.handshake(ssl::stream<boost::asio::ip::tcp::socket>::client, hec);
-    if (hec) std::exit(EXIT_FAILURE);
 }
 
 /**
@@ -153,25 +169,16 @@ void connection::async_post(
         communication::message const &request_msg,
         std::function<void(std::optional<communication::message> const &)> const &fn
 ) {
-    boost::asio::post(this->strand_, [this, request_msg, fn]() {
-        std::pair<boost::logic::tribool, std::optional<communication::message>> result;
-        result.first = this->write(request_msg);
-        if (boost::indeterminate(result.first)) {
-            this->handle_reconnection_();
-        }
-        if (boost::indeterminate(result.first) || !result.first) return fn(result.second);
-        result = this->read();
-        if (boost::indeterminate(result.first)) {
-            this->handle_reconnection_();
-        }
-        fn(result.second);
-    });
+    this->start_transfer(std::make_shared<transfer>(transfer{
+            next_stream_id++, nullptr, request_msg, fn
+    }));
 }
 
 /**
  * Handle the sending and receiving procedures for a specific f_message
  * using the internal thread. The entire f_message is sent
- * through different sequential message to server.
+ * through different sequential message to server, interleaved with
+ * the ones of the other transfers in progress.
  * A provided callback will be executed on completion
  *
  * @param request_msg f_message that has to be sent
@@ -182,46 +189,252 @@ void connection::async_post(
         std::shared_ptr<communication::f_message> const &request_msg,
         std::function<void(std::optional<communication::message> const &)> const &fn
 ) {
-    boost::asio::post(this->strand_, [this, request_msg, fn]() {
-        std::optional<communication::message> msg;
-        try {
-            std::pair<boost::logic::tribool, std::optional<communication::message>> result;
-            while (request_msg->next_chunk()) {
-                result.first = this->write(*request_msg);
-                if (boost::indeterminate(result.first)) {
-                    this->handle_reconnection_();
-                }
-                if (boost::indeterminate(result.first) || !result.first) return fn(result.second);
-                result = this->read();
-                if (boost::indeterminate(result.first)) {
-                    this->handle_reconnection_();
+    this->start_transfer(std::make_shared<transfer>(transfer{
+            next_stream_id++, request_msg, std::nullopt, fn
+    }));
+}
+
+/**
+ * Allow to add a transfer to the ones in progress, starting the
+ * sending procedure if it is not already running
+ *
+ * @param t the transfer that has to be started
+ * @return void
+ */
+void connection::start_transfer(std::shared_ptr<transfer> const &t) {
+    boost::asio::post(this->strand_, [this, t]() {
+        this->transfers_.emplace(t->stream_id, t);
+        this->sending_.push_back(t);
+        this->pump();
+    });
+}
+
+/**
+ * Allow to advance the transfers in progress. Chunks are taken in round robin
+ * from the transfers that still have to send something, up to window_ chunks
+ * waiting for a reply. The replies are read asynchronously, one at time, and
+ * each one advances the transfers again, so the strand is never blocked
+ * waiting for the server and new transfers can join in the meantime.
+ * Once a reply reports an error, no more chunks are sent for that transfer
+ * and the replies of the chunks still in flight are discarded.
+ *
+ * @return void
+ */
+void connection::pump() {
+    while (this->in_flight_ < this->window_ && !this->sending_.empty()) {
+        auto t = this->sending_.front();
+        this->sending_.pop_front();
+        communication::message const *msg;
+        if (t->f_msg_ptr) {
+            try {
+                if (!t->f_msg_ptr->next_chunk()) {
+                    t->sending = false;
+                    this->complete(t);
+                    continue;
                 }
-                if (boost::indeterminate(result.first) || !result.first) return fn(result.second);
             }
-            fn(result.second);
+            catch (std::exception &e) {
+                // the replies of the chunks already sent have to be read anyway
+                t->sending = false;
+                t->failed = true;
+                t->reply = std::nullopt;
+                this->complete(t);
+                continue;
+            }
+            msg = t->f_msg_ptr.get();
+        } else {
+            t->sending = false;
+            msg = &t->msg.value();
         }
-        catch (std::exception &e) {
-            fn(std::nullopt);
+        boost::logic::tribool sent = this->write(*msg, t->stream_id);
+        if (boost::indeterminate(sent) || !sent) return this->abort_transfers(boost::indeterminate(sent));
+        t->in_flight++;
+        this->in_flight_++;
+        if (t->sending) this->sending_.push_back(t);
+    }
+    if (this->in_flight_ == 0 || this->reading_) return;
+    this->reading_ = true;
+    this->reply_ptr_ = std::make_shared<std::vector<uint8_t>>();
+    this->keepalive_timer_.cancel();
+    this->async_read_reply(true, this->generation_);
+}
+
+/**
+ * Allow to read asynchronously a part of a reply from the server, going on
+ * until the reply END. The completion handlers are executed on the strand.
+ *
+ * @param first true if the first part of the reply has to be read
+ * @param generation the transfers generation the reply belongs to
+ * @return void
+ */
+void connection::async_read_reply(bool first, uint64_t generation) {
+    boost::asio::async_read(
+            this->socket_,
+            boost::asio::buffer(&this->reply_header_, sizeof(this->reply_header_)),
+            boost::asio::bind_executor(this->strand_, [this, first, generation](
+                    boost::system::error_code const &ec,
+                    size_t
+            ) {
+                if (generation != this->generation_) return;
+                if (ec) return this->read_failed(ec);
+                // the parts following the first one start with the message type, that is dropped
+                size_t offset = this->reply_ptr_->size();
+                this->reply_ptr_->resize(offset + this->reply_header_);
+                boost::asio::async_read(
+                        this->socket_,
+                        boost::asio::buffer(this->reply_ptr_->data() + offset, this->reply_header_),
+                        boost::asio::bind_executor(this->strand_, [this, first, generation, offset](
+                                boost::system::error_code const &ec,
+                                size_t
+                        ) {
+                            if (generation != this->generation_) return;
+                            if (ec) return this->read_failed(ec);
+                            if (!first) this->reply_ptr_->erase(this->reply_ptr_->begin() + offset);
+                            communication::message reply{this->reply_ptr_};
+                            communication::tlv_view view{reply};
+                            bool ended = false;
+                            while (view.next_tlv()) if (view.tlv_type() == communication::END) ended = true;
+                            if (!ended) return this->async_read_reply(false, generation);
+                            this->reading_ = false;
+                            this->reply_ptr_.reset();
+                            this->schedule_keepalive();
+                            this->handle_reply(reply);
+                        })
+                );
+            })
+    );
+}
+
+/**
+ * Allow to handle a failed reply read, aborting the transfers in progress
+ *
+ * @param ec the read error code
+ * @return void
+ */
+void connection::read_failed(boost::system::error_code const &ec) {
+    this->reading_ = false;
+    this->reply_ptr_.reset();
+    if (ec == boost::asio::error::eof ||
+        ec == boost::asio::error::connection_reset ||
+        ec == boost::asio::error::broken_pipe) {
+        std::cerr << "Connection to the server has been lost. Trying to reconnect..." << std::endl;
+        return this->abort_transfers(true);
+    }
+    std::cerr << "Error in read():\n\t" << ec.message() << std::endl;
+    this->schedule_keepalive();
+    this->abort_transfers(false);
+}
+
+/**
+ * Allow to dispatch a reply to its transfer using the stream id,
+ * then to advance the transfers in progress
+ *
+ * @param reply the reply read from the server
+ * @return void
+ */
+void connection::handle_reply(communication::message const &reply) {
+    this->in_flight_--;
+
+    // extracting the stream id and removing it from the reply
+    auto raw_msg_ptr = reply.raw_msg_ptr();
+    communication::tlv_view view{reply};
+    std::shared_ptr<transfer> t;
+    if (view.next_tlv() && view.tlv_type() == communication::TLV_TYPE::STREAM) {
+        try {
+            auto it = this->transfers_.find(std::stoul(std::string{view.cbegin(), view.cend()}));
+            if (it != this->transfers_.end()) t = it->second;
         }
-    });
+        catch (std::exception &e) {}
+    }
+    if (!t || t->in_flight == 0) {
+        std::cerr << "Received a reply for an unknown stream" << std::endl;
+        return this->abort_transfers(false);
+    }
+    t->in_flight--;
+    if (!t->failed) {
+        auto reply_ptr = std::make_shared<std::vector<uint8_t>>();
+        reply_ptr->reserve(raw_msg_ptr->size());
+        reply_ptr->push_back(raw_msg_ptr->front());
+        reply_ptr->insert(reply_ptr->end(), view.cend(), raw_msg_ptr->cend());
+        t->reply.emplace(reply_ptr);
+        communication::tlv_view reply_view{t->reply.value()};
+        while (reply_view.next_tlv()) {
+            if (reply_view.tlv_type() == communication::TLV_TYPE::ERROR) {
+                t->failed = true;
+                if (t->sending) {
+                    t->sending = false;
+                    this->sending_.erase(std::find(this->sending_.begin(), this->sending_.end(), t));
+                }
+            }
+        }
+    }
+    this->complete(t);
+    this->pump();
+}
+
+/**
+ * Allow to execute the completion callback of a transfer if it has nothing
+ * more to send and all its replies have been received
+ *
+ * @param t the transfer that has to be checked
+ * @return void
+ */
+void connection::complete(std::shared_ptr<transfer> const &t) {
+    if (t->sending || t->in_flight > 0) return;
+    this->transfers_.erase(t->stream_id);
+    t->fn(t->reply);
+}
+
+/**
+ * Allow to abort all the transfers in progress after a communication error.
+ * Their callbacks are executed without any reply.
+ *
+ * @param reconnect true if the connection has been lost and has to be reestablished
+ * @return void
+ */
+void connection::abort_transfers(bool reconnect) {
+    auto transfers = std::move(this->transfers_);
+    this->transfers_.clear();
+    this->sending_.clear();
+    this->in_flight_ = 0;
+    // a reply that is being read belongs to the aborted transfers
+    this->generation_++;
+    this->reading_ = false;
+    this->reply_ptr_.reset();
+    if (reconnect) this->handle_reconnection_();
+    for (auto &[stream_id, t] : transfers) t->fn(std::nullopt);
 }
 
 /**
  * Allow to send a message to the server.
  *
  * @param request_msg message that has to be sent
+ * @param stream_id the stream id that has to be attached to the message, 0 for none
  * @return true if the message has been successfully sent, false if there has been
  * an error and boost::indeterminate if the connection has been closed
  * // (true, std::optional<message>)
 // (false, std::nullopt)
 // (indeterminate, std::nullopt) // failed connection
  */
-boost::logic::tribool connection::write(communication::message const &request_msg) {
+boost::logic::tribool connection::write(communication::message const &request_msg, uint32_t stream_id) {
     this->keepalive_timer_.cancel();
     size_t header = request_msg.raw_msg_ptr()->size();
     std::vector<boost::asio::mutable_buffer> buffers;
     buffers.emplace_back(boost::asio::buffer(&header, sizeof(header)));
-    buffers.emplace_back(request_msg.buffer());
+    // the STREAM TLV is placed just after the message type, without copying the message
+    std::vector<uint8_t> stream_tlv;
+    if (stream_id) {
+        std::string stream_id_str = std::to_string(stream_id);
+        stream_tlv.push_back(communication::TLV_TYPE::STREAM);
+        stream_tlv.push_back((stream_id_str.size() >> 8) & 0xFF);
+        stream_tlv.push_back(stream_id_str.size() & 0xFF);
+        stream_tlv.insert(stream_tlv.end(), stream_id_str.cbegin(), stream_id_str.cend());
+        header += stream_tlv.size();
+        auto msg_buffer = request_msg.buffer();
+        buffers.emplace_back(boost::asio::buffer(msg_buffer.data(), 1));
+        buffers.emplace_back(boost::asio::buffer(stream_tlv));
+        buffers.emplace_back(msg_buffer + 1);
+    } else buffers.emplace_back(request_msg.buffer());
     try {
 //        std::cout << "<<<<<<<<<<REQUEST>>>>>>>>>" << std::endl;
 //        std::cout << "HEADER: " << header << std::endl;
@@ -11,6 +11,8 @@
 #include <boost/asio/ssl.hpp>
 #include <boost/regex.hpp>
 #include <mutex>
+#include <deque>
+#include <unordered_map>
 #include "../../shared/communication/f_message.h"
 #include "../../shared/communication/message.h"
 #include "auth_data.h"
@@ -20,20 +22,51 @@
  * It allow to communicate with server using the sync_post
  * and the async_post methods. It manages asynchronous
  * calls using the internal strand and the internal thread. It also handles keepalive
- * and reconnection features.
+ * and reconnection features. Asynchronous requests are multiplexed on the socket:
+ * each one is tagged with a stream id, so that the chunks of different files can be
+ * interleaved and a small file doesn't wait for a large one to be completely sent.
  */
 class connection {
+    /*
+     * A request in progress: a single message or a file sent chunk by chunk
+     */
+    struct transfer {
+        uint32_t stream_id;
+        std::shared_ptr<communication::f_message> f_msg_ptr;
+        std::optional<communication::message> msg;
+        std::function<void(std::optional<communication::message> const &)> fn;
+        // number of sent chunks whose reply has not been received yet
+        size_t in_flight = 0;
+        bool sending = true;
+        bool failed = false;
+        std::optional<communication::message> reply = std::nullopt;
+    };
+
     // needed for isolated completion handler execution
     boost::asio::strand<boost::asio::io_context::executor_type> strand_;
     boost::asio::ssl::stream<boost::asio::ip::tcp::socket> socket_;
     boost::asio::ip::tcp::resolver::results_type endpoints_;
     boost::asio::steady_timer keepalive_timer_;
     boost::signals2::signal<void()> handle_reconnection_;
+    // maximum number of chunks sent without waiting for the server reply
+    size_t window_;
+    // transfers with chunks that still have to be sent, served in round robin
+    std::deque<std::shared_ptr<transfer>> sending_;
+    // stream id -> transfer map of all the transfers in progress
+    std::unordered_map<uint32_t, std::shared_ptr<transfer>> transfers_;
+    size_t in_flight_ = 0;
+    // the reply that is being read asynchronously
+    size_t reply_header_ = 0;
+    std::shared_ptr<std::vector<uint8_t>> reply_ptr_;
+    bool reading_ = false;
+    // incremented when the transfers are aborted, so that the replies read before are discarded
+    uint64_t generation_ = 0;
 public:
 
     static std::shared_ptr<connection> get_instance(
             boost::asio::io_context &io,
-            boost::asio::ssl::context &ctx
+            boost::asio::ssl::context &ctx,
+            size_t window = 1
     );
 
     void resolve(std::string const &hostname, std::string const &service);
@@ -65,10 +98,25 @@ public:
 private:
     connection(
             boost::asio::io_context &io,
-            boost::asio::ssl::context &ctx
+            boost::asio::ssl::context &ctx,
+            size_t window
     );
 
-    boost::logic::tribool write(communication::message const &request_msg);
+    void start_transfer(std::shared_ptr<transfer> const &t);
+
+    void pump();
+
+    void async_read_reply(bool first, uint64_t generation);
+
+    void read_failed(boost::system::error_code const &ec);
+
+    void handle_reply(communication::message const &reply);
+
+    void complete(std::shared_ptr<transfer> const &t);
+
+    void abort_transfers(bool reconnect);
+
+    boost::logic::tribool write(communication::message const &request_msg, uint32_t stream_id = 0);
 
     std::pair<boost::logic::tribool, std::optional<communication::message>> read();
 
@@ -1,87 +1,585 @@
 #include <utility>
+#include <iomanip>
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/post.hpp>
 #include "file_watcher.h"
 #include "../../shared/utilities/tools.h"
+#define EVENT_BUFFER_SIZE (64 * 1024)
+#define MAX_PENDING_PER_THREAD 256
+#define MAX_MOVE_CANDIDATES 4
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
 
 namespace fs = boost::filesystem;
 
+namespace {
+    /*
+     * Releases a slot of the files waiting to be hashed once the
+     * hashing task ends, however it ends
+     */
+    struct pending_guard {
+        std::mutex &m;
+        std::condition_variable &cv;
+        size_t &pending;
+
+        ~pending_guard() {
+            {
+                std::unique_lock ul{m};
+                pending--;
+            }
+            cv.notify_one();
+        }
+    };
+}
+
 /**
  * Construct a file_watcher instance with the associated watched directory
- * and a scheduler for server update scheduling.
+ * and a scheduler for server update scheduling. In event driven mode the
+ * inotify watches are registered before scanning the directory, so that
+ * no change happening during the scan is lost. The digests stored in the
+ * on-disk index are reused for the files that didn't change.
  *
  * @param dir_ptr std::shared_ptr to the watched directory
  * @param scheduler_ptr std::shared_ptr to an operation scheduler
  * @param wait_time file_watcher refresh rate in milliseconds
+ * @param event_driven a boolean value specifying if inotify has to be used instead of polling
+ * @param scan_threads the number of threads hashing files during the initial scan
  * @return a new constructed file_watcher instance
  */
 file_watcher::file_watcher(
         std::shared_ptr<directory::dir<directory::c_resource>> dir_ptr,
         std::shared_ptr<scheduler> scheduler_ptr,
-        std::chrono::milliseconds wait_time
-) : dir_ptr_{std::move(dir_ptr)}, scheduler_ptr_{std::move(scheduler_ptr)}, wait_time_{wait_time} {
+        std::chrono::milliseconds wait_time,
+        bool event_driven,
+        size_t scan_threads
+) : wait_time_{wait_time},
+    dir_ptr_{std::move(dir_ptr)},
+    scheduler_ptr_{std::move(scheduler_ptr)},
+    index_{std::make_unique<directory::c_index>(dir_ptr_->path(), scheduler_ptr_->digest_type())},
+    event_driven_{event_driven} {
+    if (this->event_driven_) {
+        this->inotify_fd_ = inotify_init1(IN_CLOEXEC);
+        if (this->inotify_fd_ == -1) {
+            std::cerr << "Failed to initialize inotify. Falling back to polling..." << std::endl;
+            this->event_driven_ = false;
+        } else this->add_watches(this->dir_ptr_->path());
+    }
+    this->scan(scan_threads);
+}
+
+/**
+ * Allow to build the internal representation of the watched directory.
+ * The calling thread walks the directory while a pool of threads hashes
+ * the found files. The number of files waiting to be hashed is bounded,
+ * so the memory usage doesn't depend on the directory size.
+ *
+ * @param threads the number of hashing threads
+ * @return void
+ */
+void file_watcher::scan(size_t threads) {
     std::cout << " \u25CC Scanning directory..." << std::endl;
+    size_t const max_pending = MAX_PENDING_PER_THREAD * threads;
+    size_t pending = 0;
+    std::mutex m;
+    std::condition_variable cv;
+    boost::asio::thread_pool pool{threads};
+    // the resources stored on the previous run, only read by the hashing threads
+    auto const indexed = this->index_->load();
+
     size_t watched_dir_length = this->dir_ptr_->path().size();
     for (auto &de : fs::recursive_directory_iterator(dir_ptr_->path())) {
         fs::path const &absolute_path = de.path();
         if (fs::is_regular_file(absolute_path)) {
             boost::filesystem::path relative_path{absolute_path.generic_path().string().substr(watched_dir_length)};
-            this->dir_ptr_->insert_or_assign(relative_path, directory::c_resource{
-                    boost::indeterminate,
-                    false,
-                    tools::MD5_hash(absolute_path, relative_path)
+            if (this->ignored(relative_path)) continue;
+            {
+                std::unique_lock ul{m};
+                cv.wait(ul, [&pending, max_pending]() { return pending < max_pending; });
+                pending++;
+            }
+            boost::asio::post(pool, [this, &m, &cv, &pending, &indexed, absolute_path, relative_path]() {
+                pending_guard guard{m, cv, pending};
+                try {
+                    auto it = indexed.find(relative_path);
+                    auto [digest, fingerprint] = this->digest(
+                            absolute_path,
+                            relative_path,
+                            it != indexed.cend() ? std::make_optional(it->second) : std::nullopt
+                    );
+                    this->dir_ptr_->insert_or_assign(relative_path, directory::c_resource{
+                            boost::indeterminate,
+                            false,
+                            digest,
+                            fingerprint
+                    });
+                }
+                catch (fs::filesystem_error &ex) {
+                    // the file has been removed in the meantime: it will be handled by the next checks
+                    std::cerr << "Failed to hash " << absolute_path.string() << ":\n\t" << ex.what() << std::endl;
+                }
+                catch (std::exception &ex) {
+                    // the file is left out of the scan: it will be handled by the next checks
+                    std::cerr << "Failed to hash " << absolute_path.string() << ":\n\t" << ex.what() << std::endl;
+                }
             });
         }
     }
+    pool.join();
+    this->report_hashing();
+    this->persist();
 }
 
 /**
- * Allow to start to watch the associated directory to sync
- * it with the internal representation and the backup server directory
+ * Release the inotify instance, if any.
+ */
+file_watcher::~file_watcher() {
+    if (this->inotify_fd_ != -1) close(this->inotify_fd_);
+}
+
+/**
+ * Allow to check if a path belongs to the client state directory, which
+ * is neither watched nor backed up.
+ *
+ * @param relative_path the relative path that has to be checked
+ * @return true if the path has to be ignored, false otherwise
+ */
+bool file_watcher::ignored(fs::path const &relative_path) const {
+    static std::string const state_dir = '/' + directory::c_index::STATE_DIR;
+    std::string path = relative_path.generic_path().string();
+    return path.compare(0, state_dir.size(), state_dir) == 0 &&
+           (path.size() == state_dir.size() || path[state_dir.size()] == '/');
+}
+
+/**
+ * Allow to obtain the watched directory relative path of an absolute path
+ *
+ * @param absolute_path the absolute path that has to be converted
+ * @return the relative path in the same form used as directory key
+ */
+fs::path file_watcher::relative(fs::path const &absolute_path) const {
+    return fs::path{absolute_path.generic_path().string().substr(this->dir_ptr_->path().size())};
+}
+
+/**
+ * Allow to register an inotify watch on the provided directory and on all
+ * its subdirectories. If the watch limit is reached, the file_watcher
+ * falls back to polling mode.
  *
+ * @param absolute_path the absolute path of the directory that has to be watched
  * @return void
  */
-void file_watcher::start() {
+void file_watcher::add_watches(fs::path const &absolute_path) {
+    auto add_watch = [this](fs::path const &path) {
+        if (!this->event_driven_ || this->ignored(this->relative(path))) return;
+        int wd = inotify_add_watch(this->inotify_fd_, path.c_str(), WATCH_MASK);
+        if (wd != -1) this->watches_.insert_or_assign(wd, path);
+        else if (errno == ENOSPC) {
+            std::cerr << "inotify watch limit reached. Falling back to polling..." << std::endl;
+            this->event_driven_ = false;
+        }
+    };
+    add_watch(absolute_path);
+    boost::system::error_code ec;
+    for (auto &de : fs::recursive_directory_iterator(absolute_path, ec)) {
+        if (fs::is_directory(de.path())) add_watch(de.path());
+    }
+}
+
+/**
+ * Allow to remove all the inotify watches registered on the provided
+ * directory and on all its subdirectories.
+ *
+ * @param absolute_path the absolute path of the directory that is no more watched
+ * @return void
+ */
+void file_watcher::remove_watches(fs::path const &absolute_path) {
+    std::string prefix = absolute_path.generic_path().string() + '/';
+    auto it = this->watches_.begin();
+    while (it != this->watches_.end()) {
+        std::string path = it->second.generic_path().string();
+        if (it->second == absolute_path || path.compare(0, prefix.size(), prefix) == 0) {
+            inotify_rm_watch(this->inotify_fd_, it->first);
+            it = this->watches_.erase(it);
+        } else it++;
+    }
+}
+
+/**
+ * Allow to schedule the erase of all the known resources under the provided
+ * relative path that don't exist anymore on the filesystem. The ERASE of the
+ * files stored on the server is deferred until erase_deferred() is called,
+ * so that the files created in the meantime with the same content can be
+ * moved on the server instead of being uploaded again.
+ *
+ * @param relative_path the relative path of a file or of a directory
+ * @return void
+ */
+void file_watcher::check_erased(fs::path const &relative_path) {
     fs::path const &root = this->dir_ptr_->path();
-    size_t watched_dir_length = root.size();
+    std::string path = relative_path.generic_path().string();
+    std::string prefix = path + '/';
+    std::vector<std::pair<fs::path, directory::c_resource>> erased;
+    this->dir_ptr_->for_each([&](std::pair<fs::path, directory::c_resource> const &pair) {
+        std::string const &entry = pair.first.string();
+        if (!path.empty() && entry != path && entry.compare(0, prefix.size(), prefix) != 0) return;
+        if (!fs::exists(root / pair.first)) erased.push_back(pair);
+    });
 
-    this->scheduler_ptr_->sync();
+    for (auto const &[erased_path, rsrc] : erased) {
+        this->index_->erase(erased_path);
+        if (boost::indeterminate(rsrc.synced())) {
+            // it can't be erased on the server until its operation ends
+            this->unsettled_.insert(erased_path);
+        } else {
+            if (rsrc.synced() && rsrc.fingerprint().size > 0) {
+                if (this->erased_.emplace(erased_path, rsrc).second) {
+                    this->erased_by_size_.emplace(rsrc.fingerprint().size, erased_path);
+                }
+            } else if (rsrc.exist_on_server()) {
+                this->scheduler_ptr_->erase(erased_path, rsrc.digest());
+            }
+        }
+    }
+}
+
+/**
+ * Allow to find the erased file a new file has been moved from. The new file
+ * matches an erased file if it has the same inode and modification time, or
+ * if its content has the same digest when it is hashed under the erased file
+ * path. The matching erased file is no more erased.
+ *
+ * @param absolute_path the absolute path of the new file
+ * @param fingerprint the fingerprint of the new file
+ * @return an optional containing the relative path and the resource of the erased file, if any
+ */
+std::optional<std::pair<fs::path, directory::c_resource>> file_watcher::moved_from(
+        fs::path const &absolute_path,
+        directory::fingerprint const &fingerprint
+) {
+    auto [begin, end] = this->erased_by_size_.equal_range(fingerprint.size);
+    auto match = end;
+    for (auto it = begin; it != end && match == end; it++) {
+        auto const &erased_fingerprint = this->erased_.at(it->second).fingerprint();
+        if (fingerprint.inode != 0 && erased_fingerprint.inode == fingerprint.inode &&
+            erased_fingerprint.mtime_ns == fingerprint.mtime_ns) match = it;
+    }
+    // files with the same size are hashed again only up to a limit, since each one has to be read
+    size_t candidates = 0;
+    for (auto it = begin; it != end && match == end && candidates < MAX_MOVE_CANDIDATES; it++, candidates++) {
+        try {
+            auto digest = tools::file_hash(absolute_path, it->second, this->scheduler_ptr_->digest_type());
+            if (this->erased_.at(it->second).digest_equals(digest)) match = it;
+        }
+        catch (fs::filesystem_error &ex) {
+            return std::nullopt;
+        }
+    }
+    if (match == end) return std::nullopt;
+    auto node = this->erased_.extract(match->second);
+    this->erased_by_size_.erase(match);
+    return std::make_pair(std::move(node.key()), std::move(node.mapped()));
+}
 
-    while (this->running_) {
-        std::this_thread::sleep_for(this->wait_time_);
+/**
+ * Allow to schedule the deferred ERASE operations, the ones of the erased
+ * files that haven't been found moved elsewhere.
+ *
+ * @return void
+ */
+void file_watcher::erase_deferred() {
+    for (auto const &[erased_path, rsrc] : this->erased_) {
+        this->scheduler_ptr_->erase(erased_path, rsrc.digest());
+    }
+    this->erased_.clear();
+    this->erased_by_size_.clear();
+}
 
-        this->dir_ptr_->for_each([&root, this](std::pair<fs::path, directory::c_resource> const &pair) {
-            if (fs::exists(root / pair.first)) return;
-            fs::path const &relative_path = pair.first;
-            directory::c_resource const &rsrc = pair.second;
+/**
+ * Allow to obtain a file digest. If the file fingerprint matches the one
+ * stored in the provided resource, the stored digest is returned without
+ * reading the file content.
+ *
+ * @param absolute_path the absolute path of the file
+ * @param relative_path the relative path of the file
+ * @param rsrc the resource currently associated to the file, if any
+ * @return an std::pair containing the file digest and the file fingerprint
+ */
+std::pair<std::string, directory::fingerprint> file_watcher::digest(
+        fs::path const &absolute_path,
+        fs::path const &relative_path,
+        std::optional<directory::c_resource> const &rsrc
+) {
+    // the fingerprint is taken before hashing: a change during hashing will be detected on the next check
+    auto fingerprint = directory::fingerprint::of(absolute_path);
+    if (fingerprint && rsrc && rsrc.value().fingerprint() == fingerprint.value()) {
+        this->hits_++;
+        return {rsrc.value().digest(), fingerprint.value()};
+    }
+    this->misses_++;
+    std::string digest = tools::file_hash(absolute_path, relative_path, this->scheduler_ptr_->digest_type());
+    if (fingerprint) {
+        this->index_->put(relative_path, directory::c_resource{boost::indeterminate, false, digest, fingerprint.value()});
+    }
+    return {digest, fingerprint.value_or(directory::fingerprint{})};
+}
 
-            if (!boost::indeterminate(rsrc.synced())) {
-                if (rsrc.exist_on_server()) {
-                    this->scheduler_ptr_->erase(relative_path, rsrc.digest());
-                }
+/**
+ * Allow to print how many digests have been taken from the fingerprint
+ * cache since the last report. Nothing is printed if no file has been hashed.
+ *
+ * @return void
+ */
+void file_watcher::report_hashing() {
+    if (this->misses_ == 0) {
+        this->hits_ = 0;
+        return;
+    }
+    size_t total = this->hits_ + this->misses_;
+    std::ostringstream oss;
+    oss << " \u25CC Hashed " << this->misses_ << " of " << total << " files (cache hit ratio "
+        << std::fixed << std::setprecision(1) << 100.0 * this->hits_ / total << "%)" << std::endl;
+    std::cout << oss.str();
+    this->hits_ = 0;
+    this->misses_ = 0;
+}
+
+/**
+ * Allow to write on disk the index changes, compacting it if necessary
+ *
+ * @return void
+ */
+void file_watcher::persist() {
+    this->index_->compact(*this->dir_ptr_);
+    this->index_->flush();
+}
+
+/**
+ * Allow to compare a file with its internal representation and to schedule
+ * the appropriate operation if they differ. A file that can't be read
+ * (e.g. removed in the meantime) is skipped: it is handled by the next checks.
+ *
+ * @param absolute_path the absolute path of the file that has to be checked
+ * @return void
+ */
+void file_watcher::check_file(fs::path const &absolute_path) {
+    try {
+        this->compare_file(absolute_path);
+    }
+    catch (fs::filesystem_error &ex) {
+        std::cerr << "Failed to check " << absolute_path.string() << ":\n\t" << ex.what() << std::endl;
+    }
+    catch (std::exception &ex) {
+        std::cerr << "Failed to check " << absolute_path.string() << ":\n\t" << ex.what() << std::endl;
+    }
+}
+
+/**
+ * Allow to compare a file with its internal representation and to schedule
+ * the appropriate operation if they differ.
+ *
+ * @param absolute_path the absolute path of the file that has to be compared
+ * @return void
+ */
+void file_watcher::compare_file(fs::path const &absolute_path) {
+    fs::path relative_path = this->relative(absolute_path);
+    if (this->ignored(relative_path) || !fs::is_regular_file(absolute_path)) return;
+    // a file erased and created again in the meantime is not erased anymore
+    auto erased_it = this->erased_.find(relative_path);
+    if (erased_it != this->erased_.end()) {
+        auto [begin, end] = this->erased_by_size_.equal_range(erased_it->second.fingerprint().size);
+        for (auto it = begin; it != end; it++) {
+            if (it->second == relative_path) {
+                this->erased_by_size_.erase(it);
+                break;
+            }
+        }
+        this->erased_.erase(erased_it);
+    }
+    auto rsrc_opt = this->dir_ptr_->rsrc(relative_path);
+    auto [digest, fingerprint] = this->digest(absolute_path, relative_path, rsrc_opt);
+
+    // if doesn't exists, it could have been moved from an erased file
+    if (!rsrc_opt) {
+        auto source = this->moved_from(absolute_path, fingerprint);
+        if (source) {
+            this->scheduler_ptr_->move(source->first, source->second.digest(), relative_path, digest, fingerprint);
+        } else this->scheduler_ptr_->create(relative_path, digest, fingerprint);
+    } else {
+        directory::c_resource rsrc = rsrc_opt.value();
+        if (rsrc.synced() == true) {
+            if (!rsrc.digest_equals(digest)) {
+                this->scheduler_ptr_->update(relative_path, digest, fingerprint);
+            } else if (rsrc.fingerprint() != fingerprint) {
+                // metadata changed without content changes: remembering the new fingerprint
+                this->dir_ptr_->insert_or_assign(relative_path, rsrc.fingerprint(fingerprint));
             }
-        });
-
-        for (auto &file : fs::recursive_directory_iterator(root)) {
-            fs::path const &absolute_path = file.path();
-            if (fs::is_regular_file(absolute_path)) {
-                fs::path relative_path{absolute_path.generic_path().string().substr(watched_dir_length)};
-                std::string digest = tools::MD5_hash(absolute_path, relative_path);
-
-                // if doesn't exists
-                if (!this->dir_ptr_->contains(relative_path)) {
-                    this->scheduler_ptr_->create(relative_path, digest);
-                } else {
-                    directory::c_resource rsrc = this->dir_ptr_->rsrc(relative_path).value();
-                    if (rsrc.synced() == true) {
-                        if (rsrc.digest() != digest) {
-                            this->scheduler_ptr_->update(relative_path, digest);
-                        }
-                    } else if (rsrc.synced() == false) {
-                        if (rsrc.exist_on_server()) {
-                            this->scheduler_ptr_->update(relative_path, digest);
-                        } else this->scheduler_ptr_->create(relative_path, digest);
-                    }
+        } else if (rsrc.synced() == false) {
+            if (rsrc.exist_on_server()) {
+                this->scheduler_ptr_->update(relative_path, digest, fingerprint);
+            } else this->scheduler_ptr_->create(relative_path, digest, fingerprint);
+        }
+    }
+}
+
+/**
+ * Allow to sync the internal representation with the filesystem content
+ * under the provided directory
+ *
+ * @param absolute_path the absolute path of the directory that has to be rescanned
+ * @return void
+ */
+void file_watcher::rescan(fs::path const &absolute_path) {
+    this->check_erased(this->relative(absolute_path));
+    boost::system::error_code ec;
+    fs::recursive_directory_iterator it{absolute_path, ec}, end;
+    while (!ec && it != end) {
+        // only the directories are walked, so that the files removed in the meantime don't stop the walk
+        boost::system::error_code status_ec;
+        if (!fs::is_directory(it->symlink_status(status_ec))) it.disable_recursion_pending();
+        this->check_file(it->path());
+        it.increment(ec);
+    }
+    if (ec) std::cerr << "Failed to rescan " << absolute_path.string() << ":\n\t" << ec.message() << std::endl;
+    this->report_hashing();
+    this->persist();
+}
+
+/**
+ * Allow to reschedule the operations failed since the last check, and to
+ * erase the files removed while their operation was in progress. It only
+ * works on the internal representation, without walking the watched directory.
+ *
+ * @return void
+ */
+void file_watcher::retry_failed() {
+    std::vector<fs::path> failed;
+    this->dir_ptr_->for_each([&failed](std::pair<fs::path, directory::c_resource> const &pair) {
+        if (pair.second.synced() == false) failed.push_back(pair.first);
+    });
+    fs::path const &root = this->dir_ptr_->path();
+    for (auto const &relative_path : failed) {
+        if (fs::exists(root / relative_path)) this->check_file(root / relative_path);
+        else this->check_erased(relative_path);
+    }
+    auto unsettled = std::move(this->unsettled_);
+    this->unsettled_.clear();
+    for (auto const &relative_path : unsettled) {
+        if (!fs::exists(root / relative_path)) this->check_erased(relative_path);
+    }
+    this->erase_deferred();
+}
+
+/**
+ * Allow to process a buffer of inotify events, scheduling the operations
+ * only for the changed paths. If the kernel event queue overflowed, the
+ * whole watched directory is rescanned.
+ *
+ * @param buffer the buffer containing the events
+ * @param length the buffer length
+ * @return void
+ */
+void file_watcher::handle_events(char const *buffer, size_t length) {
+    bool overflowed = false;
+    inotify_event const *event;
+    for (char const *ptr = buffer; ptr < buffer + length; ptr += sizeof(inotify_event) + event->len) {
+        event = reinterpret_cast<inotify_event const *>(ptr);
+        if (event->mask & IN_Q_OVERFLOW) {
+            overflowed = true;
+            continue;
+        }
+        if (event->mask & IN_IGNORED) {
+            this->watches_.erase(event->wd);
+            continue;
+        }
+        auto it = this->watches_.find(event->wd);
+        if (it == this->watches_.end() || event->len == 0) continue;
+        fs::path absolute_path = it->second / event->name;
+        try {
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    this->add_watches(absolute_path);
+                    this->rescan(absolute_path);
+                } else if (event->mask & IN_MOVED_FROM) {
+                    this->remove_watches(absolute_path);
+                    this->check_erased(this->relative(absolute_path));
                 }
+            } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                this->check_file(absolute_path);
+            } else if (event->mask & IN_CREATE) {
+                // a hard link (e.g. ln) is not written, so no IN_CLOSE_WRITE follows: the other
+                // created files are checked once closed, instead of sending them partially written
+                boost::system::error_code ec;
+                if (fs::hard_link_count(absolute_path, ec) > 1 && !ec) this->check_file(absolute_path);
+            } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                this->check_erased(this->relative(absolute_path));
             }
         }
+        catch (std::exception &ex) {
+            // the path has changed again in the meantime: a following event will handle it
+            std::cerr << "Failed to handle event on " << absolute_path.string() << ":\n\t" << ex.what() << std::endl;
+        }
+    }
+    if (overflowed) {
+        std::cout << " \u25CC inotify queue overflowed. Rescanning directory..." << std::endl;
+        this->rescan(this->dir_ptr_->path());
+    }
+    // the files moved within the events have been found: the other ones have been erased
+    this->erase_deferred();
+}
+
+/**
+ * Allow to watch the associated directory by rescanning it every
+ * wait_time milliseconds
+ *
+ * @return void
+ */
+void file_watcher::poll() {
+    std::this_thread::sleep_for(this->wait_time_);
+    // the whole directory is checked again, erased files included
+    this->unsettled_.clear();
+    this->rescan(this->dir_ptr_->path());
+    this->erase_deferred();
+}
+
+/**
+ * Allow to watch the associated directory by listening for inotify events.
+ * If no event is received for wait_time milliseconds, the failed operations
+ * are rescheduled. It returns only if the file_watcher has been stopped or
+ * it had to fall back to polling mode.
+ *
+ * @return void
+ */
+void file_watcher::listen() {
+    alignas(inotify_event) char buffer[EVENT_BUFFER_SIZE];
+    pollfd pfd{this->inotify_fd_, POLLIN, 0};
+    while (this->running_ && this->event_driven_) {
+        int ready = ::poll(&pfd, 1, static_cast<int>(this->wait_time_.count()));
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            std::cerr << "Failed to wait for inotify events. Falling back to polling..." << std::endl;
+            this->event_driven_ = false;
+        } else if (ready == 0) {
+            this->retry_failed();
+            this->persist();
+        } else {
+            ssize_t length = read(this->inotify_fd_, buffer, sizeof(buffer));
+            if (length > 0) this->handle_events(buffer, length);
+        }
     }
-}
\ No newline at end of file
+}
+
+/**
+ * Allow to start to watch the associated directory to sync
+ * it with the internal representation and the backup server directory
+ *
+ * @return void
+ */
+void file_watcher::start() {
+    this->scheduler_ptr_->sync();
+
+    if (this->event_driven_) this->listen();
+    while (this->running_) this->poll();
+}
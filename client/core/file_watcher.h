@@ -9,25 +9,94 @@
 #include <memory>
 #include <sstream>
 #include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
 #include "../../shared/directory/dir.h"
 #include "../directory/c_resource.h"
+#include "../directory/c_index.h"
 #include "scheduler.h"
 
 /**
  * This class allow to create a file_watcher given a specific
  * directory. If a specific resource is not synced, this class
  * uses the associated scheduler to schedule the appropriate
- * operation.
+ * operation. The directory can be watched by periodically
+ * rescanning it (polling mode) or by listening for Linux
+ * inotify events (event driven mode).
  */
 class file_watcher {
     std::chrono::milliseconds wait_time_;
     std::shared_ptr<directory::dir<directory::c_resource>> dir_ptr_;
     std::shared_ptr<scheduler> scheduler_ptr_;
+    // on-disk fingerprints and digests of the watched files
+    std::unique_ptr<directory::c_index> index_;
+    bool event_driven_;
     bool running_ = true;
+    // inotify instance file descriptor and watch descriptor -> absolute directory path map
+    int inotify_fd_ = -1;
+    std::unordered_map<int, boost::filesystem::path> watches_;
+    // number of digests taken from the fingerprint cache and actually computed
+    std::atomic<size_t> hits_ = 0;
+    std::atomic<size_t> misses_ = 0;
+    // erased files whose ERASE is deferred, since they may have been moved, and their paths by file size
+    std::unordered_map<boost::filesystem::path, directory::c_resource> erased_;
+    std::unordered_multimap<uintmax_t, boost::filesystem::path> erased_by_size_;
+    // erased files whose operation was still in progress, checked again by retry_failed()
+    std::unordered_set<boost::filesystem::path> unsettled_;
+
+    void scan(size_t threads);
+
+    void poll();
+
+    void listen();
+
+    void add_watches(boost::filesystem::path const &absolute_path);
+
+    void remove_watches(boost::filesystem::path const &absolute_path);
+
+    void handle_events(char const *buffer, size_t length);
+
+    void rescan(boost::filesystem::path const &absolute_path);
+
+    void check_erased(boost::filesystem::path const &relative_path);
+
+    void check_file(boost::filesystem::path const &absolute_path);
+
+    void compare_file(boost::filesystem::path const &absolute_path);
+
+    std::optional<std::pair<boost::filesystem::path, directory::c_resource>> moved_from(
+            boost::filesystem::path const &absolute_path,
+            directory::fingerprint const &fingerprint
+    );
+
+    void erase_deferred();
+
+    void retry_failed();
+
+    std::pair<std::string, directory::fingerprint> digest(
+            boost::filesystem::path const &absolute_path,
+            boost::filesystem::path const &relative_path,
+            std::optional<directory::c_resource> const &rsrc
+    );
+
+    void report_hashing();
+
+    void persist();
+
+    [[nodiscard]] bool ignored(boost::filesystem::path const &relative_path) const;
+
+    [[nodiscard]] boost::filesystem::path relative(boost::filesystem::path const &absolute_path) const;
+
 public:
     file_watcher(std::shared_ptr<directory::dir<directory::c_resource>> dir_ptr,
                  std::shared_ptr<scheduler> scheduler_ptr,
-                 std::chrono::milliseconds wait_time);
+                 std::chrono::milliseconds wait_time,
+                 bool event_driven = false,
+                 size_t scan_threads = 1);
+
+    ~file_watcher();
+
     void start();
 };
 
@@ -1,62 +1,117 @@
 #include "../../shared/utilities/tools.h"
+#include "../../shared/utilities/hasher.h"
+#include "../../shared/utilities/compression.h"
 #include <boost/function.hpp>
+#include <condition_variable>
+#include <iomanip>
+#include <thread>
 #include "scheduler.h"
 #include "../../shared/communication/tlv_view.h"
+#include "../../shared/communication/d_message.h"
 
 namespace fs = boost::filesystem;
 
+// maximum number of chunks listed in a CHUNKS message
+size_t const CHUNKS_PER_QUERY = 1024;
+
 /**
  * Construct a scheduler instance for a given watched directory
- * and a given connection instance.
+ * and a given connection pool.
  *
  * @param io_context io_context
  * @param dir_ptr the watched directory std::shared_ptr
- * @param connection_ptr the connection std::shared_ptr
+ * @param connections the std::shared_ptr of the connections that have to be used
+ * @param delta_min_size the minimum file size for sending updates as a delta, 0 to disable it
+ * @param dedup_min_size the minimum file size for sending only the chunks missing
+ * on the server on creation, 0 to disable it
+ * @param compress true if the file data has to be compressed, if the server supports it
  * @return a new constructed scheduler instance
  */
 scheduler::scheduler(
         boost::asio::io_context &io,
         std::shared_ptr<directory::dir<directory::c_resource>> dir_ptr,
-        std::shared_ptr<connection> connection_ptr
-) : dir_ptr_{std::move(dir_ptr)},
-    connection_ptr_{std::move(connection_ptr)},
-    io_{io} {}
+        std::vector<std::shared_ptr<connection>> connections,
+        size_t delta_min_size,
+        size_t dedup_min_size,
+        bool compress
+) : connections_{std::move(connections)},
+    dir_ptr_{std::move(dir_ptr)},
+    io_{io},
+    delta_min_size_{delta_min_size},
+    dedup_min_size_{dedup_min_size},
+    compress_{compress} {}
 
 /**
  * Construct a scheduler instance std::shared_ptr for a given watched directory
- * and a given connection instance.
+ * and a given connection pool.
  *
  * @param io_context io_context
  * @param dir_ptr the watched directory std::shared_ptr
- * @param connection_ptr the connection std::shared_ptr
+ * @param connections the std::shared_ptr of the connections that have to be used
+ * @param delta_min_size the minimum file size for sending updates as a delta, 0 to disable it
+ * @param dedup_min_size the minimum file size for sending only the chunks missing
+ * on the server on creation, 0 to disable it
+ * @param compress true if the file data has to be compressed, if the server supports it
  * @return a new constructed scheduler instance std::shared_ptr
  */
 std::shared_ptr<scheduler> scheduler::get_instance(
         boost::asio::io_context &io,
         std::shared_ptr<directory::dir<directory::c_resource>> dir_ptr,
-        std::shared_ptr<connection> connection_ptr
+        std::vector<std::shared_ptr<connection>> connections,
+        size_t delta_min_size,
+        size_t dedup_min_size,
+        bool compress
 ) {
     return std::shared_ptr<scheduler>(new scheduler{
             io,
             std::move(dir_ptr),
-            std::move(connection_ptr)
+            std::move(connections),
+            delta_min_size,
+            dedup_min_size,
+            compress
     });
 }
 
 /**
- * Allow to handle reconnection task sending the
+ * Allow to obtain the index of the connection used for the operations on a given file.
+ * The server keeps a separate view of the user files for each connection,
+ * so all the operations on the same file have to go through the same one.
+ *
+ * @param relative_path the relative path of the file
+ * @return the connection index
+ */
+size_t scheduler::connection_index(fs::path const &relative_path) const {
+    return std::hash<std::string>{}(relative_path.generic_path().string()) % this->connections_.size();
+}
+
+/**
+ * Allow to obtain the connection used for the operations on a given file.
+ *
+ * @param relative_path the relative path of the file
+ * @return the connection std::shared_ptr
+ */
+std::shared_ptr<connection> const &scheduler::connection_for(fs::path const &relative_path) const {
+    return this->connections_[this->connection_index(relative_path)];
+}
+
+/**
+ * Allow to handle reconnection task for one of the connections sending the
  * stored user auth information is the user is already
  * authenticated.
  *
+ * @param index the index of the connection that has to be reestablished
  * @return void
  */
-void scheduler::reconnect() {
-    this->connection_ptr_->connect();
+void scheduler::reconnect(size_t index) {
+    this->connections_[index]->connect();
     if (this->auth_data_.authenticated()) {
-        if (!this->auth(this->auth_data_) && !this->login()) {
+        if (!this->auth(this->auth_data_, index) && (index != 0 || !this->login())) {
             std::exit(EXIT_FAILURE);
         }
-        this->sync();
+        std::cout << " \u25CC Scheduling SYNC..." << std::endl;
+        // the operations in progress on the other connections are not affected
+        auto response = this->list(index);
+        if (response) this->reconcile(response.value(), index);
     }
 }
 
@@ -100,6 +155,144 @@ void scheduler::handle_create(
     }
 }
 
+/**
+ * Allow to ask the server which chunks of a file that has to be created are missing
+ * from its chunk store. The chunks are listed through multiple CHUNKS messages,
+ * each one sent once the reply to the previous one has been received.
+ *
+ * @param relative_path the relative path of the file that has to be created
+ * @param sign the sign of the file that has to be created
+ * @param chunks_ptr the file chunks
+ * @param first the index of the first chunk that has to be listed
+ * @return void
+ */
+void scheduler::query_chunks(
+        fs::path const &relative_path,
+        std::string const &sign,
+        std::shared_ptr<std::vector<communication::cdc_message::chunk>> const &chunks_ptr,
+        size_t first
+) {
+    size_t last = std::min(first + CHUNKS_PER_QUERY, chunks_ptr->size());
+    std::vector<uint8_t> hashes;
+    hashes.reserve((last - first) * cdc::HASH_SIZE);
+    for (size_t i = first; i < last; i++) {
+        auto const &hash = (*chunks_ptr)[i].hash;
+        hashes.insert(hashes.end(), hash.cbegin(), hash.cend());
+    }
+    communication::message request_msg{communication::MSG_TYPE::CHUNKS};
+    request_msg.add_TLV(communication::TLV_TYPE::ITEM, sign.size(), sign.c_str());
+    request_msg.add_TLV(communication::TLV_TYPE::HASHES, hashes.size(), reinterpret_cast<char const *>(hashes.data()));
+    request_msg.add_TLV(communication::TLV_TYPE::END);
+    this->connection_for(relative_path)->async_post(
+            request_msg,
+            boost::asio::bind_executor(
+                    this->io_,
+                    boost::bind(
+                            &scheduler::handle_chunks,
+                            this,
+                            relative_path,
+                            sign,
+                            chunks_ptr,
+                            first,
+                            boost::placeholders::_1
+                    )
+            )
+    );
+}
+
+/**
+ * Allow to handle CHUNKS message server response: once all the chunks have been
+ * listed, the file is created sending only the missing ones, or as a whole if
+ * the server doesn't keep a chunk store
+ *
+ * @param relative_path the relative path of the file related to the CHUNKS message
+ * @param sign the sign of the file related to the CHUNKS message
+ * @param chunks_ptr the file chunks
+ * @param first the index of the first chunk listed in the CHUNKS message
+ * @param response an optional containing the eventual server response
+ * @return void
+ */
+void scheduler::handle_chunks(
+        fs::path const &relative_path,
+        std::string const &sign,
+        std::shared_ptr<std::vector<communication::cdc_message::chunk>> const &chunks_ptr,
+        size_t first,
+        std::optional<communication::message> const &response
+) {
+    if (!response) {
+        auto rsrc_opt = this->dir_ptr_->rsrc(relative_path);
+        if (!rsrc_opt) std::exit(EXIT_FAILURE);
+        std::cout << " \u2717 CREATE on " << relative_path.string() << " failed. I'll retry..." << std::endl;
+        this->dir_ptr_->insert_or_assign(relative_path, rsrc_opt.value().synced(false));
+        return;
+    }
+    size_t last = std::min(first + CHUNKS_PER_QUERY, chunks_ptr->size());
+    communication::message const &response_msg = response.value();
+    communication::tlv_view s_view{response_msg};
+    bool result = response_msg.msg_type() == communication::MSG_TYPE::CHUNKS &&
+                  s_view.next_tlv() &&
+                  s_view.tlv_type() == communication::TLV_TYPE::ITEM &&
+                  sign == std::string{s_view.cbegin(), s_view.cend()} &&
+                  s_view.next_tlv() &&
+                  s_view.tlv_type() == communication::TLV_TYPE::MISSING &&
+                  s_view.length() == (last - first + 7) / 8;
+    if (result) {
+        auto missing = std::to_address(s_view.cbegin());
+        for (size_t i = first; i < last; i++) {
+            (*chunks_ptr)[i].missing = missing[(i - first) / 8] & (0x80 >> (i - first) % 8);
+        }
+        result = s_view.next_tlv() && s_view.tlv_type() == communication::TLV_TYPE::OK;
+    }
+
+    fs::path absolute_path{this->dir_ptr_->path() / relative_path};
+    // servers that don't keep a chunk store receive the file as a whole
+    if (!result) {
+        this->send_create(relative_path, sign, communication::f_message::get_instance(
+                communication::MSG_TYPE::CREATE,
+                absolute_path,
+                sign
+        ));
+    } else if (last < chunks_ptr->size()) {
+        this->query_chunks(relative_path, sign, chunks_ptr, last);
+    } else {
+        this->send_create(relative_path, sign, communication::cdc_message::get_instance(
+                communication::MSG_TYPE::CREATE,
+                absolute_path,
+                sign,
+                std::move(*chunks_ptr)
+        ));
+    }
+}
+
+/**
+ * Allow to send the content of a file that has to be created
+ *
+ * @param relative_path the relative path of the file that has to be created
+ * @param sign the sign of the file that has to be created
+ * @param f_msg the message carrying the file content, as a whole or as chunks
+ * @return void
+ */
+void scheduler::send_create(
+        fs::path const &relative_path,
+        std::string const &sign,
+        std::shared_ptr<communication::f_message> const &f_msg
+) {
+    f_msg->compression_type(this->auth_data_.compression_type());
+    this->connection_for(relative_path)->async_post(
+            f_msg,
+            boost::asio::bind_executor(
+                    this->io_,
+                    boost::bind(
+                            &scheduler::handle_create,
+                            this,
+                            relative_path,
+                            sign,
+                            boost::placeholders::_1
+                    )
+            )
+    );
+}
+
 /**
  * Allow to handle UPDATE message server response
  *
@@ -141,6 +334,102 @@ void scheduler::handle_update(
 
 }
 
+/**
+ * Allow to handle SIGNATURE message server response: the file is sent as a delta
+ * against the stored version signatures, or as a whole if they are not available
+ *
+ * @param relative_path the relative path of the file related to the SIGNATURE message
+ * @param sign the sign of the file related to the SIGNATURE message
+ * @param response an optional containing the eventual server response
+ * @return void
+ */
+void scheduler::handle_signature(
+        fs::path const &relative_path,
+        std::string const &sign,
+        std::optional<communication::message> const &response
+) {
+    if (!response) {
+        auto rsrc_opt = this->dir_ptr_->rsrc(relative_path);
+        if (!rsrc_opt) std::exit(EXIT_FAILURE);
+        std::cout << " \u2717 UPDATE on " << relative_path.string() << " failed. I'll retry..." << std::endl;
+        this->dir_ptr_->insert_or_assign(relative_path, rsrc_opt.value().synced(false));
+        return;
+    }
+    communication::message const &response_msg = response.value();
+    communication::tlv_view s_view{response_msg};
+    size_t block_size = 0;
+    std::vector<delta::block_signature> signatures;
+    bool result = response_msg.msg_type() == communication::MSG_TYPE::SIGNATURE &&
+                  s_view.next_tlv() &&
+                  s_view.tlv_type() == communication::TLV_TYPE::ITEM &&
+                  sign == std::string{s_view.cbegin(), s_view.cend()} &&
+                  s_view.next_tlv() &&
+                  s_view.tlv_type() == communication::TLV_TYPE::BLOCK_SIZE;
+    if (result) {
+        try {
+            block_size = std::stoul(std::string{s_view.cbegin(), s_view.cend()});
+        }
+        catch (std::exception &ex) {
+            result = false;
+        }
+    }
+    while (result && s_view.next_tlv() && s_view.tlv_type() == communication::TLV_TYPE::BLOCKS) {
+        auto length = s_view.length();
+        if (length % delta::SIGNATURE_SIZE != 0) result = false;
+        for (size_t i = 0; result && i < length; i += delta::SIGNATURE_SIZE) {
+            signatures.push_back(delta::unpack_signature(std::to_address(s_view.cbegin()) + i));
+        }
+    }
+    result = result && block_size > 0 && s_view.tlv_type() == communication::TLV_TYPE::OK;
+
+    fs::path absolute_path{this->dir_ptr_->path() / relative_path};
+    // servers that don't support deltas or don't have the file, receive it as a whole
+    if (result) {
+        this->send_update(relative_path, sign, communication::d_message::get_instance(
+                communication::MSG_TYPE::UPDATE,
+                absolute_path,
+                sign,
+                block_size,
+                signatures
+        ));
+    } else {
+        this->send_update(relative_path, sign, communication::f_message::get_instance(
+                communication::MSG_TYPE::UPDATE,
+                absolute_path,
+                sign
+        ));
+    }
+}
+
+/**
+ * Allow to send the content of a file that has to be updated
+ *
+ * @param relative_path the relative path of the file that has to be updated
+ * @param sign the sign of the file that has to be updated
+ * @param f_msg the message carrying the file content, as a whole or as a delta
+ * @return void
+ */
+void scheduler::send_update(
+        fs::path const &relative_path,
+        std::string const &sign,
+        std::shared_ptr<communication::f_message> const &f_msg
+) {
+    f_msg->compression_type(this->auth_data_.compression_type());
+    this->connection_for(relative_path)->async_post(
+            f_msg,
+            boost::asio::bind_executor(
+                    this->io_,
+                    boost::bind(
+                            &scheduler::handle_update,
+                            this,
+                            relative_path,
+                            sign,
+                            boost::placeholders::_1
+                    )
+            )
+    );
+}
+
 /**
  * Allow to handle ERASE message server response
  *
@@ -178,6 +467,52 @@ void scheduler::handle_erase(
     }
 }
 
+/**
+ * Allow to handle CLONE message server response. Once the moved file has been
+ * copied on the server, the file it has been moved from is erased. If the server
+ * can't copy it, the moved file is uploaded as usual.
+ *
+ * @param source_path the relative path of the file that has been moved
+ * @param relative_path the relative path of the file related to the CLONE message
+ * @param sign the sign of the file related to the CLONE message
+ * @param response an optional containing the eventual server response
+ * @return void
+ */
+void scheduler::handle_clone(
+        fs::path const &source_path,
+        fs::path const &relative_path,
+        std::string const &sign,
+        std::optional<communication::message> const &response
+) {
+    auto source_rsrc_opt = this->dir_ptr_->rsrc(source_path);
+    auto rsrc_opt = this->dir_ptr_->rsrc(relative_path);
+    if (!source_rsrc_opt || !rsrc_opt) std::exit(EXIT_FAILURE);
+    directory::c_resource source_rsrc = source_rsrc_opt.value();
+    directory::c_resource rsrc = rsrc_opt.value();
+    if (!response) {
+        std::cout << " \u2717 MOVE on " << relative_path.string() << " failed. I'll retry..." << std::endl;
+        this->dir_ptr_->insert_or_assign(source_path, source_rsrc.synced(false));
+        this->dir_ptr_->insert_or_assign(relative_path, rsrc.synced(false));
+        return;
+    }
+    communication::message const &response_msg = response.value();
+    communication::tlv_view s_view{response_msg};
+    if (response_msg.msg_type() == communication::MSG_TYPE::CLONE &&
+        s_view.next_tlv() &&
+        s_view.tlv_type() == communication::TLV_TYPE::ITEM &&
+        sign == std::string{s_view.cbegin(), s_view.cend()} &&
+        s_view.next_tlv() &&
+        s_view.tlv_type() == communication::TLV_TYPE::OK) {
+        std::cout << " \u2713 MOVE from " << source_path.string() << " to " << relative_path.string()
+                  << " done." << std::endl;
+        this->dir_ptr_->insert_or_assign(relative_path, rsrc.synced(true).exist_on_server(true));
+    } else {
+        std::cout << " \u2717 MOVE on " << relative_path.string() << " failed. Uploading it..." << std::endl;
+        this->create(relative_path, rsrc.digest(), rsrc.fingerprint());
+    }
+    this->erase(source_path, source_rsrc.digest());
+}
+
 /**
  * Allow to start the login procedure
  *
@@ -210,9 +545,13 @@ bool scheduler::login() {
         auth_data usr{username, password};
         if (this->auth(usr)) {
             this->auth_data_ = usr;
+            // the other connections of the pool reuse the same credentials
+            for (size_t i = 1; i < this->connections_.size(); i++) {
+                if (!this->auth(this->auth_data_, i)) return false;
+            }
             return true;
         } else {
-            this->connection_ptr_->cancel_keepalive();
+            this->connections_[0]->cancel_keepalive();
             std::cout << "Authentication failed (attempts left " << --general_attempts << ")." << std::endl;
         }
     }
@@ -222,19 +561,34 @@ bool scheduler::login() {
 /**
  * Allow to try to authenticate a given user.
  *
- * @param username the client user username
- * @param password the client user password
+ * @param usr the client user authentication data
+ * @param index the index of the connection that has to be authenticated
  * @return true if the user has been successfully authenticated, false otherwise
  */
-bool scheduler::auth(auth_data &usr) {
+bool scheduler::auth(auth_data &usr, size_t index) {
     std::string const &username = usr.username();
     std::string const &password = usr.password();
     communication::message auth_msg{communication::MSG_TYPE::AUTH};
     auth_msg.add_TLV(communication::TLV_TYPE::USRN, username.size(), username.c_str());
     auth_msg.add_TLV(communication::TLV_TYPE::PSWD, password.size(), password.c_str());
+    // offering the supported digest types, ordered from the preferred one
+    for (auto digest_type : hasher::supported()) {
+        auto digest_type_str = std::to_string(digest_type);
+        auth_msg.add_TLV(communication::TLV_TYPE::DIGEST, digest_type_str.size(), digest_type_str.c_str());
+    }
+    if (this->compress_) {
+        for (auto compression_type : compression::supported()) {
+            auto compression_type_str = std::to_string(compression_type);
+            auth_msg.add_TLV(
+                    communication::TLV_TYPE::COMPRESSION,
+                    compression_type_str.size(),
+                    compression_type_str.c_str()
+            );
+        }
+    }
     auth_msg.add_TLV(communication::TLV_TYPE::END);
 
-    auto response = this->connection_ptr_->sync_post(auth_msg);
+    auto response = this->connections_[index]->sync_post(auth_msg);
     if (boost::indeterminate(response.first)) {
         std::cerr << "Connection has been lost during authentication" << std::endl;
         std::exit(EXIT_FAILURE);
@@ -243,6 +597,28 @@ bool scheduler::auth(auth_data &usr) {
         auto response_msg = response.second.value();
         communication::tlv_view view{response_msg};
         if (view.next_tlv() && view.tlv_type() == communication::TLV_TYPE::OK) {
+            // a server that doesn't send the chosen digest type only supports MD5,
+            // one that doesn't send the chosen compression type doesn't compress
+            auto digest_type = communication::DIGEST_TYPE::DIGEST_MD5;
+            auto compression_type = communication::COMPRESSION_TYPE::COMPRESSION_NONE;
+            while (view.next_tlv() && view.tlv_type() != communication::TLV_TYPE::END) {
+                if (view.tlv_type() == communication::TLV_TYPE::DIGEST) {
+                    digest_type = static_cast<communication::DIGEST_TYPE>(
+                            std::stoi(std::string{view.cbegin(), view.cend()})
+                    );
+                } else if (view.tlv_type() == communication::TLV_TYPE::COMPRESSION) {
+                    compression_type = static_cast<communication::COMPRESSION_TYPE>(
+                            std::stoi(std::string{view.cbegin(), view.cend()})
+                    );
+                }
+            }
+            // the stored digests are valid only for the digest type negotiated at first
+            if (usr.authenticated() && usr.digest_type() != digest_type) {
+                std::cerr << "The server changed the digest type" << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+            usr.digest_type(digest_type);
+            usr.compression_type(compression_type);
             usr.authenticated(true);
             return true;
         } else return false;
@@ -250,13 +626,29 @@ bool scheduler::auth(auth_data &usr) {
 
 }
 
-bool scheduler::retrieve(std::string const &sign) {
+/**
+ * Getter for the digest type negotiated with the server.
+ *
+ * @return the negotiated digest type
+ */
+communication::DIGEST_TYPE scheduler::digest_type() const {
+    return this->auth_data_.digest_type();
+}
+
+/**
+ * Allow to retrieve a file from the server, writing it in the watched directory
+ *
+ * @param sign the sign of the file that has to be retrieved
+ * @param index the index of the connection that has to be used
+ * @return true if the file has been successfully retrieved or it already exists, false otherwise
+ */
+bool scheduler::retrieve(std::string const &sign, size_t index) {
     auto splitted_sign = tools::split_sign(sign);
     fs::path const &relative_path = splitted_sign.first;
     std::string const &digest = splitted_sign.second;
     fs::path absolute_path = this->dir_ptr_->path() / relative_path;
     if (fs::exists(absolute_path)) {
-        std::string c_digest = tools::MD5_hash(absolute_path, relative_path);
+        std::string c_digest = tools::file_hash(absolute_path, relative_path, this->digest_type());
         if (c_digest == digest) {
             std::cout << " \u2713 RETRIEVE on " << relative_path.string() << " skipped (already exists)." << std::endl;
             return true;
@@ -276,7 +668,7 @@ bool scheduler::retrieve(std::string const &sign) {
     communication::message retrieve_request{communication::MSG_TYPE::RETRIEVE};
     retrieve_request.add_TLV(communication::TLV_TYPE::ITEM, sign.size(), sign.c_str());
     retrieve_request.add_TLV(communication::TLV_TYPE::END);
-    auto response = this->connection_ptr_->sync_post(retrieve_request);
+    auto response = this->connections_[index]->sync_post(retrieve_request);
     if (boost::indeterminate(response.first) || response.first == false) {
         std::cout << " \u2717 RETRIEVE on " << relative_path.string() << " failed." << std::endl;
         return false;
@@ -297,10 +689,22 @@ bool scheduler::retrieve(std::string const &sign) {
             return false;
         }
 
+        static thread_local std::vector<char> decompressed;
         while (view.next_tlv() && view.tlv_type() == communication::TLV_TYPE::ITEM &&
                sign == std::string{view.cbegin(), view.cend()} &&
-               view.next_tlv() && view.tlv_type() == communication::TLV_TYPE::CONTENT) {
-            std::copy(view.cbegin(), view.cend(), std::ostreambuf_iterator<char>(ofs));
+               view.next_tlv() && (view.tlv_type() == communication::TLV_TYPE::CONTENT ||
+                                   view.tlv_type() == communication::TLV_TYPE::ZCONTENT)) {
+            if (view.tlv_type() == communication::TLV_TYPE::ZCONTENT) {
+                if (!compression::decompress(
+                        this->auth_data_.compression_type(),
+                        std::to_address(view.cbegin()),
+                        view.length(),
+                        decompressed
+                )) {
+                    break;
+                }
+                ofs.write(decompressed.data(), static_cast<std::streamsize>(decompressed.size()));
+            } else std::copy(view.cbegin(), view.cend(), std::ostreambuf_iterator<char>(ofs));
         }
         if (view.tlv_type() != communication::TLV_TYPE::END) {
             std::cout << " \u2717 RETRIEVE on " << relative_path.string() << " failed." << std::endl;
@@ -308,7 +712,7 @@ bool scheduler::retrieve(std::string const &sign) {
         }
         ofs.close();
         // Comparing server file digest with the sent digest
-        std::string c_digest = tools::MD5_hash(absolute_path, relative_path);
+        std::string c_digest = tools::file_hash(absolute_path, relative_path, this->digest_type());
         if (c_digest != digest) {
             remove(absolute_path, ec);  // if digests doesn't match, remove created file
             if (ec) std::exit(EXIT_FAILURE);
@@ -327,22 +731,30 @@ bool scheduler::retrieve(std::string const &sign) {
 }
 
 /**
- * Allow to handle a RESTORE operation.
+ * Allow to handle a RESTORE operation. The files are retrieved in parallel,
+ * one at a time on each connection, by a worker thread for each connection
+ * that also writes them on disk. The progress is periodically reported.
  *
+ * @param prefix only the files under this relative path are restored
  * @return void
  */
-void scheduler::restore() {
+void scheduler::restore(fs::path const &prefix) {
     communication::message request_msg{communication::MSG_TYPE::LIST};
     request_msg.add_TLV(communication::TLV_TYPE::END);
     std::cout << " \u25CC Scheduling RESTORE..." << std::endl;
 
-    auto response = this->connection_ptr_->sync_post(request_msg);
-    if (boost::indeterminate(response.first) || response.first == false) {
-        std::cout << " \u2717 Failed to obtain server file list." << std::endl;
-        std::exit(EXIT_FAILURE);
+    // all the connections have to list the server files before retrieving them
+    std::optional<communication::message> list_msg;
+    for (auto const &connection_ptr : this->connections_) {
+        auto response = connection_ptr->sync_post(request_msg);
+        if (boost::indeterminate(response.first) || response.first == false) {
+            std::cout << " \u2717 Failed to obtain server file list." << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        if (!list_msg) list_msg = response.second;
     }
 
-    auto response_msg = response.second.value();
+    auto response_msg = list_msg.value();
     communication::tlv_view s_view{response_msg};
     communication::MSG_TYPE s_msg_type = response_msg.msg_type();
     if (s_msg_type != communication::MSG_TYPE::LIST ||
@@ -351,39 +763,126 @@ void scheduler::restore() {
         std::cerr << " \u2717 RESTORE failed." << std::endl;
         std::exit(EXIT_FAILURE);
     }
+
+    std::string prefix_str = ("/" / prefix.relative_path()).generic_path().string();
+    if (prefix_str.size() > 1 && prefix_str.back() == '/') prefix_str.pop_back();
+    std::vector<std::string> signs;
     do {
         if (s_view.tlv_type() == communication::TLV_TYPE::ITEM) {
-            this->retrieve(std::string{s_view.cbegin(), s_view.cend()});
+            std::string sign{s_view.cbegin(), s_view.cend()};
+            std::string path = tools::split_sign(sign).first.generic_path().string();
+            if (prefix_str == "/" || path == prefix_str ||
+                (path.size() > prefix_str.size() && path.compare(0, prefix_str.size(), prefix_str) == 0 &&
+                 path[prefix_str.size()] == '/')) {
+                signs.push_back(std::move(sign));
+            }
         }
     } while (s_view.next_tlv());
+
+    std::atomic<size_t> next = 0;
+    std::atomic<size_t> retrieved = 0;
+    std::atomic<size_t> failed = 0;
+    std::atomic<uintmax_t> bytes = 0;
+    std::mutex m;
+    std::condition_variable cv;
+    size_t running = this->connections_.size();
+    std::vector<std::thread> workers;
+    workers.reserve(this->connections_.size());
+    for (size_t i = 0; i < this->connections_.size(); i++) {
+        workers.emplace_back([&, i]() {
+            size_t j;
+            while ((j = next++) < signs.size()) {
+                if (this->retrieve(signs[j], i)) {
+                    boost::system::error_code ec;
+                    uintmax_t size = fs::file_size(this->dir_ptr_->path() / tools::split_sign(signs[j]).first, ec);
+                    if (!ec) bytes += size;
+                    retrieved++;
+                } else failed++;
+            }
+            std::unique_lock ul{m};
+            if (--running == 0) cv.notify_one();
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto report = [&]() {
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::ostringstream oss;
+        oss << " \u25CC Restored " << retrieved + failed << " of " << signs.size() << " files ("
+            << std::fixed << std::setprecision(1) << bytes / (1024.0 * 1024.0) / std::max(seconds, 0.001)
+            << " MB/s)" << std::endl;
+        std::cout << oss.str();
+    };
+    {
+        std::unique_lock ul{m};
+        while (!cv.wait_for(ul, std::chrono::seconds{1}, [&running]() { return running == 0; })) {
+            report();
+        }
+    }
+    for (auto &worker : workers) worker.join();
+    report();
+    if (failed) {
+        std::cerr << " \u2717 RESTORE failed for " << failed << " files." << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
     std::cout << " \u2713 RESTORE done." << std::endl;
 }
 
 /**
- * Allow to handle a SYNC operation.
+ * Allow to obtain the server file list through one of the connections.
+ * The server accepts the other requests on a connection only after it.
  *
- * @return void
+ * @param index the index of the connection that has to be used
+ * @return an std::optional containing the LIST response or std::nullopt
+ * if the connection has been lost and has been already reestablished
  */
-void scheduler::sync() {
+std::optional<communication::message> scheduler::list(size_t index) {
     communication::message request_msg{communication::MSG_TYPE::LIST};
     request_msg.add_TLV(communication::TLV_TYPE::END);
-    std::cout << " \u25CC Scheduling SYNC..." << std::endl;
 
-    auto response = this->connection_ptr_->sync_post(request_msg);
+    auto response = this->connections_[index]->sync_post(request_msg);
     if (boost::indeterminate(response.first)) {
-        return this->reconnect();
+        this->reconnect(index);
+        return std::nullopt;
     } else if (response.first == false) std::exit(EXIT_FAILURE); // response not obtained
 
     auto response_msg = response.second.value();
-
     communication::tlv_view s_view{response_msg};
-    communication::MSG_TYPE s_msg_type = response_msg.msg_type();
-    if (s_msg_type != communication::MSG_TYPE::LIST ||
+    if (response_msg.msg_type() != communication::MSG_TYPE::LIST ||
         !s_view.next_tlv() ||
         s_view.tlv_type() == communication::TLV_TYPE::ERROR) {
         std::cerr << "Failed to sync server state" << std::endl;
         std::exit(EXIT_FAILURE);
     }
+    return response_msg;
+}
+
+/**
+ * Allow to handle a SYNC operation.
+ *
+ * @return void
+ */
+void scheduler::sync() {
+    std::cout << " \u25CC Scheduling SYNC..." << std::endl;
+    // all the connections have to list the server files, but only one list is used
+    for (size_t i = 1; i < this->connections_.size(); i++) {
+        if (!this->list(i)) return;
+    }
+    auto response = this->list(0);
+    if (response) this->reconcile(response.value());
+}
+
+/**
+ * Allow to schedule the operations needed to align the server
+ * with the watched directory.
+ *
+ * @param response_msg the LIST response containing the server file list
+ * @param index if specified, only the files handled by the connection with this index are considered
+ * @return void
+ */
+void scheduler::reconcile(communication::message const &response_msg, std::optional<size_t> index) {
+    communication::tlv_view s_view{response_msg};
+    s_view.next_tlv();
 
     auto s_dir_ptr = directory::dir<directory::c_resource>::get_instance("S_DIR");
 
@@ -394,6 +893,7 @@ void scheduler::sync() {
             auto splitted_sign = tools::split_sign(s_sign);
             fs::path const &relative_path = splitted_sign.first;
             std::string s_digest = splitted_sign.second;
+            if (index && this->connection_index(relative_path) != index.value()) continue;
             s_dir_ptr->insert_or_assign(relative_path, directory::c_resource{
                     boost::indeterminate, // unused field for server dir
                     true,   // unused field for server dir
@@ -403,8 +903,7 @@ void scheduler::sync() {
                 this->erase(relative_path, s_digest);
             } else {
                 auto rsrc = this->dir_ptr_->rsrc(relative_path).value();
-                std::string const &c_digest = rsrc.digest();
-                if (rsrc.digest() != s_digest) this->update(relative_path, c_digest);
+                if (!rsrc.digest_equals(s_digest)) this->update(relative_path, rsrc.digest(), rsrc.fingerprint());
                 else this->dir_ptr_->insert_or_assign(relative_path, rsrc.synced(true).exist_on_server(true));
 
             }
@@ -412,9 +911,10 @@ void scheduler::sync() {
     } while (s_view.next_tlv());
 
     // Checking for server elements that should be created
-    this->dir_ptr_->for_each([this, &s_dir_ptr](std::pair<fs::path, directory::c_resource> const &pair) {
+    this->dir_ptr_->for_each([this, &s_dir_ptr, &index](std::pair<fs::path, directory::c_resource> const &pair) {
+        if (index && this->connection_index(pair.first) != index.value()) return;
         if (!s_dir_ptr->contains(pair.first)) {
-            this->create(pair.first, pair.second.digest());
+            this->create(pair.first, pair.second.digest(), pair.second.fingerprint());
         };
     });
     std::cout << " \u2713 SYNC done." << std::endl;
@@ -424,16 +924,22 @@ void scheduler::sync() {
  * Allow to schedule a CREATE operation through the associated connection
  *
  * @param relative_path the relative path of the file that has to be created
- * @param sign the sign of the file that has to be created
+ * @param digest the digest of the file that has to be created
+ * @param fingerprint the fingerprint of the file observed when digest was computed
  *
  * @return void
  */
-void scheduler::create(fs::path const &relative_path, std::string const &digest) {
-    boost::asio::post(this->io_, [this, relative_path, digest]() {
+void scheduler::create(
+        fs::path const &relative_path,
+        std::string const &digest,
+        directory::fingerprint const &fingerprint
+) {
+    boost::asio::post(this->io_, [this, relative_path, digest, fingerprint]() {
         directory::c_resource rsrc = directory::c_resource{
                 boost::indeterminate,
                 false,
-                digest
+                digest,
+                fingerprint
         };
         std::ostringstream oss;
         oss << " \u25CC Scheduling CREATE for " << relative_path.string() << "..." << std::endl;
@@ -441,25 +947,25 @@ void scheduler::create(fs::path const &relative_path, std::string const &digest)
         this->dir_ptr_->insert_or_assign(relative_path, rsrc);
 
         std::string sign = tools::create_sign(relative_path, digest);
-        auto f_msg = communication::f_message::get_instance(
+        fs::path absolute_path{this->dir_ptr_->path() / relative_path};
+
+        // for large files, the server is asked first which chunks it already has
+        boost::system::error_code ec;
+        auto file_size = fs::file_size(absolute_path, ec);
+        if (this->dedup_min_size_ > 0 && !ec && file_size >= this->dedup_min_size_) {
+            try {
+                auto chunks_ptr = std::make_shared<std::vector<communication::cdc_message::chunk>>(
+                        communication::cdc_message::split(absolute_path)
+                );
+                if (!chunks_ptr->empty()) return this->query_chunks(relative_path, sign, chunks_ptr, 0);
+            }
+            catch (fs::filesystem_error &ex) {}
+        }
+        this->send_create(relative_path, sign, communication::f_message::get_instance(
                 communication::MSG_TYPE::CREATE,
-                this->dir_ptr_->path() / relative_path,
+                absolute_path,
                 sign
-        );
-
-        this->connection_ptr_->async_post(
-                f_msg,
-                boost::asio::bind_executor(
-                        this->io_,
-                        boost::bind(
-                                &scheduler::handle_create,
-                                this,
-                                relative_path,
-                                sign,
-                                boost::placeholders::_1
-                        )
-                )
-        );
+        ));
     });
 }
 
@@ -467,16 +973,22 @@ void scheduler::create(fs::path const &relative_path, std::string const &digest)
  * Allow to schedule a UPDATE operation through the associated connection
  *
  * @param relative_path the relative path of the file that has to be updated
- * @param sign the sign of the file that has to be updated
+ * @param digest the digest of the file that has to be updated
+ * @param fingerprint the fingerprint of the file observed when digest was computed
  *
  * @return void
  */
-void scheduler::update(fs::path const &relative_path, std::string const &digest) {
-    boost::asio::post(this->io_, [this, relative_path, digest]() {
+void scheduler::update(
+        fs::path const &relative_path,
+        std::string const &digest,
+        directory::fingerprint const &fingerprint
+) {
+    boost::asio::post(this->io_, [this, relative_path, digest, fingerprint]() {
         directory::c_resource rsrc = directory::c_resource{
                 boost::indeterminate,
                 true,
-                digest
+                digest,
+                fingerprint
         };
         std::ostringstream oss;
         oss << " \u25CC Scheduling UPDATE for " << relative_path.string() << "..." << std::endl;
@@ -484,25 +996,35 @@ void scheduler::update(fs::path const &relative_path, std::string const &digest)
         this->dir_ptr_->insert_or_assign(relative_path, rsrc);
 
         std::string sign = tools::create_sign(relative_path, digest);
-        auto f_msg = communication::f_message::get_instance(
+        fs::path absolute_path{this->dir_ptr_->path() / relative_path};
+
+        // large files are sent as a delta against the stored version, whose signatures are asked first
+        boost::system::error_code ec;
+        auto file_size = fs::file_size(absolute_path, ec);
+        if (this->delta_min_size_ > 0 && !ec && file_size >= this->delta_min_size_) {
+            communication::message request_msg{communication::MSG_TYPE::SIGNATURE};
+            request_msg.add_TLV(communication::TLV_TYPE::ITEM, sign.size(), sign.c_str());
+            request_msg.add_TLV(communication::TLV_TYPE::END);
+            this->connection_for(relative_path)->async_post(
+                    request_msg,
+                    boost::asio::bind_executor(
+                            this->io_,
+                            boost::bind(
+                                    &scheduler::handle_signature,
+                                    this,
+                                    relative_path,
+                                    sign,
+                                    boost::placeholders::_1
+                            )
+                    )
+            );
+            return;
+        }
+        this->send_update(relative_path, sign, communication::f_message::get_instance(
                 communication::MSG_TYPE::UPDATE,
-                this->dir_ptr_->path() / relative_path,
+                absolute_path,
                 sign
-        );
-
-        this->connection_ptr_->async_post(
-                f_msg,
-                boost::asio::bind_executor(
-                        this->io_,
-                        boost::bind(
-                                &scheduler::handle_update,
-                                this,
-                                relative_path,
-                                sign,
-                                boost::placeholders::_1
-                        )
-                )
-        );
+        ));
     });
 }
 
@@ -530,7 +1052,7 @@ void scheduler::erase(fs::path const &relative_path, std::string const &digest)
         communication::message request_msg{communication::MSG_TYPE::ERASE};
         request_msg.add_TLV(communication::TLV_TYPE::ITEM, sign.size(), sign.c_str());
         request_msg.add_TLV(communication::TLV_TYPE::END);
-        this->connection_ptr_->async_post(
+        this->connection_for(relative_path)->async_post(
                 request_msg,
                 boost::asio::bind_executor(
                         this->io_,
@@ -546,3 +1068,63 @@ void scheduler::erase(fs::path const &relative_path, std::string const &digest)
     });
 }
 
+/**
+ * Allow to schedule a MOVE operation: the server copies the file that has been
+ * moved, instead of receiving its content again, and then it is erased. Each
+ * operation is sent through the connection associated to the file it affects.
+ *
+ * @param source_path the relative path of the file that has been moved
+ * @param source_digest the digest of the file that has been moved
+ * @param relative_path the relative path the file has been moved to
+ * @param digest the digest of the moved file
+ * @param fingerprint the fingerprint of the moved file observed when digest was computed
+ *
+ * @return void
+ */
+void scheduler::move(
+        fs::path const &source_path,
+        std::string const &source_digest,
+        fs::path const &relative_path,
+        std::string const &digest,
+        directory::fingerprint const &fingerprint
+) {
+    boost::asio::post(this->io_, [this, source_path, source_digest, relative_path, digest, fingerprint]() {
+        std::ostringstream oss;
+        oss << " \u25CC Scheduling MOVE from " << source_path.string() << " to " << relative_path.string()
+            << "..." << std::endl;
+        std::cout << oss.str();
+        // the moved file is not erased until it has been copied
+        this->dir_ptr_->insert_or_assign(source_path, directory::c_resource{
+                boost::indeterminate,
+                true,
+                source_digest
+        });
+        this->dir_ptr_->insert_or_assign(relative_path, directory::c_resource{
+                boost::indeterminate,
+                false,
+                digest,
+                fingerprint
+        });
+
+        std::string sign = tools::create_sign(relative_path, digest);
+        std::string source_sign = tools::create_sign(source_path, source_digest);
+        communication::message request_msg{communication::MSG_TYPE::CLONE};
+        request_msg.add_TLV(communication::TLV_TYPE::ITEM, sign.size(), sign.c_str());
+        request_msg.add_TLV(communication::TLV_TYPE::SOURCE, source_sign.size(), source_sign.c_str());
+        request_msg.add_TLV(communication::TLV_TYPE::END);
+        this->connection_for(relative_path)->async_post(
+                request_msg,
+                boost::asio::bind_executor(
+                        this->io_,
+                        boost::bind(
+                                &scheduler::handle_clone,
+                                this,
+                                source_path,
+                                relative_path,
+                                sign,
+                                boost::placeholders::_1
+                        )
+                )
+        );
+    });
+}
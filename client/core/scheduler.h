@@ -6,70 +6,150 @@
 #include "../../shared/directory/dir.h"
 #include "../directory/c_resource.h"
 #include "auth_data.h"
+#include "../../shared/communication/cdc_message.h"
 
 /*
  * The scheduler instance will use the connection abstraction
  * to communicate with the server, and a thread pool for constructing
  * in parallel multiple request message. It also manages the user information
- * for reconnection.
+ * for reconnection. Operations are spread over a pool of connections
+ * according to the hash of the file path.
  */
 
 class scheduler {
-    std::shared_ptr<connection> connection_ptr_;
+    std::vector<std::shared_ptr<connection>> connections_;
     std::shared_ptr<directory::dir<directory::c_resource>> dir_ptr_;
     boost::asio::io_context &io_;
     // user authentication data
     auth_data auth_data_;
+    // minimum file size for sending updates as a delta, 0 if disabled
+    size_t delta_min_size_;
+    // minimum file size for sending only the chunks missing on the server on creation, 0 if disabled
+    size_t dedup_min_size_;
+    // true if the file data has to be compressed, if the server supports it
+    bool compress_;
 
     scheduler(
             boost::asio::io_context &io,
             std::shared_ptr<directory::dir<directory::c_resource>> dir_ptr,
-            std::shared_ptr<connection> connection_ptr
+            std::vector<std::shared_ptr<connection>> connections,
+            size_t delta_min_size,
+            size_t dedup_min_size,
+            bool compress
     );
 
+    [[nodiscard]] size_t connection_index(boost::filesystem::path const &relative_path) const;
+
+    std::shared_ptr<connection> const &connection_for(boost::filesystem::path const &relative_path) const;
+
+    std::optional<communication::message> list(size_t index);
+
+    void reconcile(communication::message const &response_msg, std::optional<size_t> index = std::nullopt);
+
     void handle_create(
             boost::filesystem::path const &relative_path,
             std::string const &sign,
             std::optional<communication::message> const &response
     );
 
+    void handle_chunks(
+            boost::filesystem::path const &relative_path,
+            std::string const &sign,
+            std::shared_ptr<std::vector<communication::cdc_message::chunk>> const &chunks_ptr,
+            size_t first,
+            std::optional<communication::message> const &response
+    );
+
+    void query_chunks(
+            boost::filesystem::path const &relative_path,
+            std::string const &sign,
+            std::shared_ptr<std::vector<communication::cdc_message::chunk>> const &chunks_ptr,
+            size_t first
+    );
+
+    void send_create(
+            boost::filesystem::path const &relative_path,
+            std::string const &sign,
+            std::shared_ptr<communication::f_message> const &f_msg
+    );
+
     void handle_update(
             boost::filesystem::path const &relative_path,
             std::string const &sign,
             std::optional<communication::message> const &response
     );
 
+    void handle_signature(
+            boost::filesystem::path const &relative_path,
+            std::string const &sign,
+            std::optional<communication::message> const &response
+    );
+
+    void send_update(
+            boost::filesystem::path const &relative_path,
+            std::string const &sign,
+            std::shared_ptr<communication::f_message> const &f_msg
+    );
+
     void handle_erase(
             boost::filesystem::path const &relative_path,
             std::string const &sign,
             std::optional<communication::message> const &response
     );
 
+    void handle_clone(
+            boost::filesystem::path const &source_path,
+            boost::filesystem::path const &relative_path,
+            std::string const &sign,
+            std::optional<communication::message> const &response
+    );
+
 public:
     static std::shared_ptr<scheduler> get_instance(
             boost::asio::io_context &io,
             std::shared_ptr<directory::dir<directory::c_resource>> dir_ptr,
-            std::shared_ptr<connection> connection_ptr
+            std::vector<std::shared_ptr<connection>> connections,
+            size_t delta_min_size = 0,
+            size_t dedup_min_size = 0,
+            bool compress = false
     );
 
-    void reconnect();
+    void reconnect(size_t index);
 
     bool login();
 
-    bool auth(auth_data &usr);
+    bool auth(auth_data &usr, size_t index = 0);
+
+    [[nodiscard]] communication::DIGEST_TYPE digest_type() const;
 
-    bool retrieve(std::string const& sign);
+    bool retrieve(std::string const& sign, size_t index = 0);
 
-    void restore();
+    void restore(boost::filesystem::path const &prefix = "/");
 
     void sync();
 
-    void create(boost::filesystem::path const &relative_path, std::string const &digest);
+    void create(
+            boost::filesystem::path const &relative_path,
+            std::string const &digest,
+            directory::fingerprint const &fingerprint = {}
+    );
 
-    void update(boost::filesystem::path const &relative_path, std::string const &digest);
+    void update(
+            boost::filesystem::path const &relative_path,
+            std::string const &digest,
+            directory::fingerprint const &fingerprint = {}
+    );
 
     void erase(boost::filesystem::path const &relative_path, std::string const &digest);
 
+    void move(
+            boost::filesystem::path const &source_path,
+            std::string const &source_digest,
+            boost::filesystem::path const &relative_path,
+            std::string const &digest,
+            directory::fingerprint const &fingerprint = {}
+    );
+
 };
 
 
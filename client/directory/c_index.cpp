@@ -0,0 +1,183 @@
+#include "c_index.h"
+#include "../../shared/directory/index_log.h"
+
+using namespace directory;
+using namespace index_log;
+namespace fs = boost::filesystem;
+
+std::string const c_index::STATE_DIR = ".remote_backup";
+
+namespace {
+    char const MAGIC[] = "RBM1IDX";
+    uint8_t const VERSION = 1;
+}
+
+/**
+ * Construct a c_index instance for a given watched directory. The index
+ * file is placed in the STATE_DIR directory of the watched directory.
+ *
+ * @param root the watched directory path
+ * @param digest_type the digest type of the stored digests
+ * @return a new constructed c_index instance
+ */
+c_index::c_index(fs::path const &root, communication::DIGEST_TYPE digest_type)
+        : path_{root / STATE_DIR / "index"}, digest_type_{digest_type} {}
+
+/**
+ * Allow to read the index content. If the index doesn't exist or has been
+ * created for another digest type, an empty content is returned. A truncated
+ * last record, due to an interrupted write, is dropped. After load the index
+ * is open for appending new records.
+ *
+ * @return the stored resources, with their synced field set to indeterminate
+ */
+std::unordered_map<fs::path, c_resource> c_index::load() {
+    std::unique_lock ul{this->m_};
+    std::unordered_map<fs::path, c_resource> content;
+    this->records_ = 0;
+    fs::ifstream ifs{this->path_, std::ios_base::binary};
+    bool valid = ifs && read_header(ifs, MAGIC, VERSION, this->digest_type_);
+    std::streamoff valid_length = valid ? static_cast<std::streamoff>(ifs.tellg()) : 0;
+    if (valid) {
+        RECORD_TYPE record_type;
+        std::string path, digest;
+        fingerprint fp;
+        while (read_record(ifs, record_type, path)) {
+            if (record_type == RECORD_TYPE::ERASE) {
+                content.erase(path);
+            } else if (read_digest(ifs, digest) && read_value(ifs, fp.size) && read_value(ifs, fp.mtime_ns) &&
+                       read_value(ifs, fp.ctime_ns) && read_value(ifs, fp.inode)) {
+                content.insert_or_assign(path, c_resource{boost::indeterminate, false, digest, fp});
+            } else break;
+            valid_length = ifs.tellg();
+            this->records_++;
+        }
+    }
+    ifs.close();
+
+    if (!valid || needs_compaction(this->records_, content.size())) {
+        this->rewrite([this, &content]() {
+            for (auto const &[relative_path, rsrc] : content) this->write_put(relative_path, rsrc);
+            this->records_ = content.size();
+        });
+    } else {
+        // dropping the truncated tail, if any
+        fs::resize_file(this->path_, valid_length);
+        this->open();
+    }
+    return content;
+}
+
+/**
+ * Allow to replace the index file with a new one whose records are
+ * written by the provided function. The index lock must be held.
+ *
+ * @param write_content the function writing the records of the new index
+ * @return void
+ */
+void c_index::rewrite(std::function<void()> const &write_content) {
+    fs::create_directories(this->path_.parent_path());
+    fs::path temp_path{this->path_};
+    temp_path += ".temp";
+    this->ofs_.close();
+    this->ofs_.open(temp_path, std::ios_base::binary | std::ios_base::trunc);
+    write_header(this->ofs_, MAGIC, VERSION, this->digest_type_);
+    write_content();
+    this->ofs_.close();
+    fs::rename(temp_path, this->path_);
+    this->open();
+}
+
+/**
+ * Allow to open the index file for appending new records
+ *
+ * @return void
+ */
+void c_index::open() {
+    this->ofs_.open(this->path_, std::ios_base::binary | std::ios_base::app);
+    if (!this->ofs_) {
+        throw fs::filesystem_error{"Failed to open index", this->path_,
+                                   boost::system::errc::make_error_code(boost::system::errc::io_error)};
+    }
+}
+
+/**
+ * Allow to write a put record
+ *
+ * @param relative_path the resource relative path
+ * @param rsrc the resource
+ * @return void
+ */
+void c_index::write_put(fs::path const &relative_path, c_resource const &rsrc) {
+    fingerprint const &fp = rsrc.fingerprint();
+    write_record(this->ofs_, RECORD_TYPE::PUT, relative_path.string());
+    write_digest(this->ofs_, rsrc.digest());
+    write_value(this->ofs_, fp.size);
+    write_value(this->ofs_, fp.mtime_ns);
+    write_value(this->ofs_, fp.ctime_ns);
+    write_value(this->ofs_, fp.inode);
+}
+
+/**
+ * Allow to write an erase record
+ *
+ * @param relative_path the erased resource relative path
+ * @return void
+ */
+void c_index::write_erase(fs::path const &relative_path) {
+    write_record(this->ofs_, RECORD_TYPE::ERASE, relative_path.string());
+}
+
+/**
+ * Allow to store the fingerprint and the digest of a resource
+ *
+ * @param relative_path the resource relative path
+ * @param rsrc the resource
+ * @return void
+ */
+void c_index::put(fs::path const &relative_path, c_resource const &rsrc) {
+    std::unique_lock ul{this->m_};
+    this->write_put(relative_path, rsrc);
+    this->records_++;
+}
+
+/**
+ * Allow to remove a resource from the index
+ *
+ * @param relative_path the resource relative path
+ * @return void
+ */
+void c_index::erase(fs::path const &relative_path) {
+    std::unique_lock ul{this->m_};
+    this->write_erase(relative_path);
+    this->records_++;
+}
+
+/**
+ * Allow to write on disk the buffered records
+ *
+ * @return void
+ */
+void c_index::flush() {
+    std::unique_lock ul{this->m_};
+    this->ofs_.flush();
+}
+
+/**
+ * Allow to replace the index content with the content of the provided
+ * directory if the index contains too many stale records.
+ *
+ * @param dir the directory whose content has to be stored
+ * @return void
+ */
+void c_index::compact(dir<c_resource> const &dir) {
+    std::unique_lock ul{this->m_};
+    if (!needs_compaction(this->records_, dir.size())) return;
+    this->rewrite([this, &dir]() {
+        this->records_ = 0;
+        dir.for_each([this](std::pair<fs::path, c_resource> const &pair) {
+            this->write_put(pair.first, pair.second);
+            this->records_++;
+        });
+    });
+}
@@ -0,0 +1,55 @@
+#ifndef REMOTE_BACKUP_M1_CLIENT_INDEX_H
+#define REMOTE_BACKUP_M1_CLIENT_INDEX_H
+
+#include <mutex>
+#include <functional>
+#include <unordered_map>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include "../../shared/directory/dir.h"
+#include "../../shared/communication/types.h"
+#include "c_resource.h"
+
+namespace directory {
+    /*
+     * This class provides an on-disk index of the watched directory
+     * resources, storing for each path the fingerprint and the digest
+     * of the file. It allows to avoid hashing again, after a restart,
+     * the files that didn't change. The index is an append-only
+     * log of put and erase records that is compacted when it
+     * contains too many stale records.
+     */
+    class c_index {
+        boost::filesystem::path path_;
+        communication::DIGEST_TYPE digest_type_;
+        boost::filesystem::ofstream ofs_;
+        size_t records_ = 0;
+        std::mutex m_;
+
+        void open();
+
+        void rewrite(std::function<void()> const &write_content);
+
+        void write_put(boost::filesystem::path const &relative_path, c_resource const &rsrc);
+
+        void write_erase(boost::filesystem::path const &relative_path);
+
+    public:
+        static std::string const STATE_DIR;
+
+        c_index(boost::filesystem::path const &root, communication::DIGEST_TYPE digest_type);
+
+        std::unordered_map<boost::filesystem::path, c_resource> load();
+
+        void put(boost::filesystem::path const &relative_path, c_resource const &rsrc);
+
+        void erase(boost::filesystem::path const &relative_path);
+
+        void flush();
+
+        void compact(dir<c_resource> const &dir);
+    };
+}
+
+
+#endif //REMOTE_BACKUP_M1_CLIENT_INDEX_H
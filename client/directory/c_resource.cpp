@@ -1,23 +1,44 @@
 #include "c_resource.h"
+#include <sys/stat.h>
 #include <boost/logic/tribool_io.hpp>
 
 using namespace directory;
 
+/**
+ * Allow to obtain the fingerprint of a file
+ *
+ * @param absolute_path the file absolute path
+ * @return an std::optional containing the file fingerprint or std::nullopt if the file can't be accessed
+ */
+std::optional<fingerprint> fingerprint::of(boost::filesystem::path const &absolute_path) {
+    struct stat st{};
+    if (stat(absolute_path.c_str(), &st) == -1) return std::nullopt;
+    return fingerprint{
+            static_cast<uintmax_t>(st.st_size),
+            st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec,
+            st.st_ctim.tv_sec * 1000000000LL + st.st_ctim.tv_nsec,
+            static_cast<uintmax_t>(st.st_ino)
+    };
+}
+
 /**
  * Construct a resource instance setting up all its field
  *
  * @param synced value specifying if client is synced with server on this resource
  * @param exist_on_server value specifying if the client knows that this resource exist on server
  * @param digest the resource digest
+ * @param fingerprint the file fingerprint observed when digest was computed
  * @return a new constructed resource instance
  */
 c_resource::c_resource(
         boost::logic::tribool synced,
         bool exist_on_server,
-        std::string digest)
+        std::string digest,
+        directory::fingerprint fingerprint)
         : synced_{synced}
         , exist_on_server_{exist_on_server}
-        , digest_{std::move(digest)} {}
+        , digest_{digest}
+        , fingerprint_{fingerprint} {}
 
 /**
 * Setter for synced field.
@@ -66,7 +87,7 @@ c_resource &c_resource::exist_on_server(bool exist_on_server) {
 * @return the resource on which it has been applied
 */
 c_resource &c_resource::digest(std::string digest) {
-    this->digest_ = std::move(digest);
+    this->digest_ = directory::digest{digest};
     return *this;
 }
 
@@ -75,8 +96,38 @@ c_resource &c_resource::digest(std::string digest) {
 *
 * @return the digest field value
 */
-[[nodiscard]] std::string const& c_resource::digest() const {
-    return this->digest_;
+[[nodiscard]] std::string c_resource::digest() const {
+    return this->digest_.str();
+}
+
+/**
+* Compare the digest field with a digest string representation.
+*
+* @param digest the digest string representation
+* @return true if the digest field value is equal to digest, false otherwise
+*/
+[[nodiscard]] bool c_resource::digest_equals(std::string const &digest) const {
+    return this->digest_ == digest;
+}
+
+/**
+* Setter for fingerprint field.
+*
+* @param fingerprint the new fingerprint field value
+* @return the resource on which it has been applied
+*/
+c_resource &c_resource::fingerprint(directory::fingerprint const &fingerprint) {
+    this->fingerprint_ = fingerprint;
+    return *this;
+}
+
+/**
+* Getter for fingerprint field.
+*
+* @return the fingerprint field value
+*/
+[[nodiscard]] directory::fingerprint const& c_resource::fingerprint() const {
+    return this->fingerprint_;
 }
 
 std::ostream &directory::operator<<(std::ostream &os, directory::c_resource const &rsrc) {
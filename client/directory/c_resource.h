@@ -2,9 +2,12 @@
 #define REMOTE_BACKUP_M1_CLIENT_RESOURCE_H
 
 #include <string>
+#include <optional>
 #include <boost/logic/tribool.hpp>
+#include <boost/filesystem/path.hpp>
 #include <utility>
 #include <iostream>
+#include "../../shared/directory/digest.h"
 
 /*
  * synced:
@@ -17,9 +20,27 @@
  *      false:          the client knows that the resource doesn't exist on server
  *
  * digest: digest value of resource
+ *
+ * fingerprint: file metadata observed when digest was computed
  */
 
 namespace directory {
+    /*
+     * This struct collects the file metadata that change whenever
+     * the file content changes. If the fingerprint of a file is equal
+     * to the stored one, the stored digest is still valid.
+     */
+    struct fingerprint {
+        uintmax_t size = 0;
+        int64_t mtime_ns = 0;
+        int64_t ctime_ns = 0;
+        uintmax_t inode = 0;
+
+        static std::optional<fingerprint> of(boost::filesystem::path const &absolute_path);
+
+        bool operator==(fingerprint const &other) const = default;
+    };
+
     /*
      * This class represent details about a directory object with respect to the client vision
      * of the resource state on server
@@ -27,9 +48,15 @@ namespace directory {
     class c_resource {
         boost::logic::tribool synced_;
         bool exist_on_server_;
-        std::string digest_;
+        directory::digest digest_;
+        directory::fingerprint fingerprint_;
     public:
-        c_resource(boost::logic::tribool synced, bool exist_on_server, std::string digest);
+        c_resource(
+                boost::logic::tribool synced,
+                bool exist_on_server,
+                std::string digest,
+                directory::fingerprint fingerprint = {}
+        );
 
         // setters and getters section
 
@@ -43,7 +70,13 @@ namespace directory {
 
         c_resource& digest(std::string digest);
 
-        [[nodiscard]] std::string const& digest() const;
+        [[nodiscard]] std::string digest() const;
+
+        [[nodiscard]] bool digest_equals(std::string const &digest) const;
+
+        c_resource& fingerprint(directory::fingerprint const &fingerprint);
+
+        [[nodiscard]] directory::fingerprint const& fingerprint() const;
     };
     // TODO cancellare l'operazione di redirezione
     std::ostream& operator<<(std::ostream& os, directory::c_resource const& rsrc);
@@ -30,9 +30,31 @@ po::variables_map parse_options(int argc, char const *const argv[]) {
                 ("delay,D",
                  po::value<size_t>()->default_value(5000),
                  "set file watcher refresh rate in milliseconds")
+                ("connections,C",
+                 po::value<size_t>()->default_value(2),
+                 "set the number of connections to the server")
+                ("window,W",
+                 po::value<size_t>()->default_value(8),
+                 "set the maximum number of file chunks sent without waiting for the server reply")
+                ("delta-min-size",
+                 po::value<size_t>()->default_value(1024 * 1024),
+                 "set the minimum file size in bytes for sending updates as a delta (0 disables it)")
+                ("dedup-min-size",
+                 po::value<size_t>()->default_value(1024 * 1024),
+                 "set the minimum file size in bytes for sending only the chunks "
+                 "missing from the server chunk store on creation (0 disables it)")
+                ("compress,Z",
+                 po::bool_switch()->default_value(false),
+                 "compress the file data exchanged with the server, if the server supports it")
+                ("inotify,I",
+                 po::bool_switch()->default_value(false),
+                 "watch the directory through inotify events instead of polling")
                 ("restore,R",
                  po::bool_switch()->default_value(false),
-                 "start in restore mode");
+                 "start in restore mode")
+                ("restore-prefix",
+                 po::value<fs::path>()->default_value(fs::path{"/"}),
+                 "restore only the files under the given path, relative to the watched directory");
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -68,6 +90,36 @@ po::variables_map parse_options(int argc, char const *const argv[]) {
             std::cout << "--threads option set to default value: "
                       << vm["threads"].as<size_t>() << std::endl;
         }
+        auto connections = vm["connections"];
+        auto connections_val = connections.as<size_t>();
+        if (connections.defaulted() || connections_val == 0 || connections_val > 16) {
+            if (connections_val == 0) {
+                vm.at("connections").value() = size_t{1};
+            } else if (connections_val > 16) {
+                vm.at("connections").value() = size_t{16};
+            }
+            std::cout << "--connections option set to default value: "
+                      << vm["connections"].as<size_t>() << std::endl;
+        }
+        auto window = vm["window"];
+        auto window_val = window.as<size_t>();
+        if (window.defaulted() || window_val == 0 || window_val > 64) {
+            if (window_val == 0) {
+                vm.at("window").value() = size_t{1};
+            } else if (window_val > 64) {
+                vm.at("window").value() = size_t{64};
+            }
+            std::cout << "--window option set to default value: "
+                      << vm["window"].as<size_t>() << std::endl;
+        }
+        if (vm["delta-min-size"].defaulted()) {
+            std::cout << "--delta-min-size option set to default value: "
+                      << vm["delta-min-size"].as<size_t>() << std::endl;
+        }
+        if (vm["dedup-min-size"].defaulted()) {
+            std::cout << "--dedup-min-size option set to default value: "
+                      << vm["dedup-min-size"].as<size_t>() << std::endl;
+        }
         if (vm["delay"].defaulted()) {
             std::cout << "--delay option set to default value: "
                       << vm["delay"].as<size_t>() << std::endl;
@@ -91,7 +143,14 @@ int main(int argc, char const *const argv[]) {
         std::string service = vm["service"].as<std::string>();
         size_t thread_pool_size = vm["threads"].as<size_t>();
         size_t delay = vm["delay"].as<size_t>();
+        size_t window = vm["window"].as<size_t>();
+        size_t connections_size = vm["connections"].as<size_t>();
+        size_t delta_min_size = vm["delta-min-size"].as<size_t>();
+        size_t dedup_min_size = vm["dedup-min-size"].as<size_t>();
         bool restore = vm["restore"].as<bool>();
+        fs::path restore_prefix = vm["restore-prefix"].as<fs::path>();
+        bool inotify = vm["inotify"].as<bool>();
+        bool compress = vm["compress"].as<bool>();
 
         // Constructing an abstraction for the watched directory
         auto watched_dir_ptr = directory::dir<directory::c_resource>::get_instance(path_to_watch, true);
@@ -99,18 +158,30 @@ int main(int argc, char const *const argv[]) {
         // Allowing generic SSL/TLS version
         boost::asio::ssl::context ctx{boost::asio::ssl::context::sslv23};
         ctx.load_verify_file("../files/certs/ca.pem");
-        // Constructing an abstraction for handling SSL connection task
-        auto connection_ptr = connection::get_instance(io_context, ctx);
+        // Constructing an abstraction for handling SSL connection task for each pooled connection
+        std::vector<std::shared_ptr<connection>> connections;
+        connections.reserve(connections_size);
+        for (size_t i = 0; i < connections_size; i++) {
+            connections.push_back(connection::get_instance(io_context, ctx, window));
+        }
         // Constructing an abstraction for scheduling async task and managing communication
-        // with server through the connection
-        auto scheduler_ptr = scheduler::get_instance(io_context, watched_dir_ptr, connection_ptr);
-        connection_ptr->set_reconnection_handler([scheduler_ptr]() {
-            scheduler_ptr->reconnect();
-        });
-
-        // Performing server connection
-        connection_ptr->resolve(hostname, service);
-        connection_ptr->connect();
+        // with server through the connections
+        auto scheduler_ptr = scheduler::get_instance(
+                io_context,
+                watched_dir_ptr,
+                connections,
+                delta_min_size,
+                dedup_min_size,
+                compress
+        );
+        for (size_t i = 0; i < connections_size; i++) {
+            connections[i]->set_reconnection_handler([scheduler_ptr, i]() {
+                scheduler_ptr->reconnect(i);
+            });
+            // Performing server connection
+            connections[i]->resolve(hostname, service);
+            connections[i]->connect();
+        }
         // Starting login procedure
         if (!scheduler_ptr->login()) {
             std::cerr << "Authentication failed" << std::endl;
@@ -132,12 +203,18 @@ int main(int argc, char const *const argv[]) {
 
             // Constructing an abstraction for monitoring the filesystem and scheduling
             // server synchronizations through bind_scheduler
-            file_watcher fw{watched_dir_ptr, scheduler_ptr, std::chrono::milliseconds{delay}};
+            file_watcher fw{
+                    watched_dir_ptr,
+                    scheduler_ptr,
+                    std::chrono::milliseconds{delay},
+                    inotify,
+                    thread_pool_size
+            };
             // Starting specified directory local file watching
             fw.start();
             io_context.stop();
             for (auto &t : thread_pool) t.join();
-        } else scheduler_ptr->restore();
+        } else scheduler_ptr->restore(restore_prefix);
     }
     catch (fs::filesystem_error &e) {
         std::cerr << "Filesystem error from " << e.what() << std::endl;
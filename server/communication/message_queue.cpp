@@ -53,15 +53,49 @@ void message_queue::add_message(message const& msg) {
     this->msgs_queue_.push(msg);
 }
 
+/**
+ * Allow to append the remaining chunks of an f_message to the queue.
+ * Each chunk is read only when all the previous messages have been
+ * popped.
+ *
+ * @param f_msg_ptr the f_message whose next chunks have to be sent
+ * @return void
+ */
+void message_queue::add_f_message(std::shared_ptr<f_message> const &f_msg_ptr) {
+    this->f_msg_ptr_ = f_msg_ptr;
+}
+
 void message_queue::pop() {
     this->msgs_queue_.pop();
 }
 
 message message_queue::front() {
+    this->empty();
     return this->msgs_queue_.front();
 }
 
+/**
+ * Allow to know if there are other messages. If only the f_message
+ * chunks are left, the next one is read. If the file can't be read
+ * anymore, an error message closes the queue.
+ *
+ * @return true if there are no more messages, false otherwise
+ */
 bool message_queue::empty() {
+    if (this->msgs_queue_.empty() && this->f_msg_ptr_) {
+        try {
+            if (this->f_msg_ptr_->next_chunk()) {
+                this->msgs_queue_.emplace(this->f_msg_ptr_->raw_msg_ptr());
+            } else this->f_msg_ptr_.reset();
+        }
+        catch (std::exception &ex) {
+            this->f_msg_ptr_.reset();
+            this->msgs_queue_.emplace(this->msg_type_);
+            auto err_str = std::to_string(ERR_TYPE::ERR_RETRIEVE_FAILED);
+            this->add_TLV(TLV_TYPE::ERROR, err_str.size(), err_str.c_str());
+            this->add_TLV(TLV_TYPE::END);
+        }
+    }
     return this->msgs_queue_.empty();
 }
 
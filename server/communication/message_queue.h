@@ -2,6 +2,7 @@
 #define REMOTE_BACKUP_M1_CLIENT_MESSAGE_VECTOR_H
 
 #include "../../shared/communication/message.h"
+#include "../../shared/communication/f_message.h"
 #include <queue>
 
 namespace communication {
@@ -10,10 +11,13 @@ namespace communication {
      * with the same message type and to easily
      * maintain their dimension under the CHUNK_SIZE
      * value. It also keeps track of the presence
-     * of error TLV tag.
+     * of error TLV tag. The queue can end with an f_message
+     * whose chunks are read only when they are needed,
+     * so that a file is never entirely kept in memory.
      */
     class message_queue {
         std::queue<communication::message> msgs_queue_;
+        std::shared_ptr<f_message> f_msg_ptr_;
         MSG_TYPE msg_type_;
         ERR_TYPE err_type_;
     public:
@@ -22,6 +26,7 @@ namespace communication {
 
         void add_TLV(TLV_TYPE tlv_type, size_t length = 0, char const *buffer = nullptr);
         void add_message(message const& msg);
+        void add_f_message(std::shared_ptr<f_message> const &f_msg_ptr);
 
         void pop();
         message front();
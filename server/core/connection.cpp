@@ -1,4 +1,5 @@
 #include <boost/bind/bind.hpp>
+#include <array>
 #include <vector>
 #include "connection.h"
 
@@ -51,7 +52,9 @@ void connection::schedule_timeout() {
  * Allows to gracefully shutdown the client connection
  */
 void connection::shutdown() {
-    this->req_handler_ptr_->streams().erase_stream(this->user_);
+    this->req_handler_ptr_->streams().erase_streams(this->user_);
+    // the chunks no more referenced are kept until the end of the session, for the files moved in the meantime
+    if (this->user_.chunks()) this->user_.chunks()->sweep();
     this->timeout_timer_.cancel();
     this->logger_ptr_->log(this->user_, "Shutdown");
     boost::system::error_code ignored_ec;
@@ -81,7 +84,12 @@ void connection::log_write(boost::system::error_code const &e) {
             this->replies_.err_type(),
             !e
             ? communication::CONN_RES::CONN_OK
-            : communication::CONN_RES::CONN_ERR
+            : communication::CONN_RES::CONN_ERR,
+            this->bytes_in_,
+            this->bytes_out_,
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - this->request_time_
+            )
     );
 }
 
@@ -107,34 +115,26 @@ void connection::write_response(boost::system::error_code const &e) {
         this->log_write(e);
         return this->shutdown();
     }
-    this->header_ = this->replies_.front().size();
+    this->msg_ = this->replies_.front();
+    this->replies_.pop();
+    this->header_ = this->msg_.size();
+    this->bytes_out_ += sizeof(this->header_) + this->header_;
 //    std::cout << "<<<<<<<<<<<<RESPONSE>>>>>>>>>>>>" << std::endl;
 //    std::cout << "HEADER: " << this->header_ << std::endl;
+    this->logger_ptr_->log(this->user_, this->msg_, "TO");
+    // header and message are sent through a single write
+    std::array<boost::asio::const_buffer, 2> buffers{
+            boost::asio::buffer(&this->header_, sizeof(this->header_)),
+            this->msg_.buffer()
+    };
     boost::asio::async_write(
             this->socket_,
-            boost::asio::buffer(&this->header_, sizeof(this->header_)),
+            buffers,
             [self = shared_from_this()](boost::system::error_code const &e, size_t /**/) {
-                if (self->timed_out) return;
-                if (e) {
-                    self->log_write(e);
-                    return self->shutdown();
-                }
-                self->msg_ = self->replies_.front();
-                self->replies_.pop();
-                std::cout << "TO\t";
-                self->logger_ptr_->log(self->user_, self->msg_);
-
-                boost::asio::async_write(
-                        self->socket_,
-                        self->msg_.buffer(),
-                        boost::bind(
-                                self->replies_.empty()
-                                ? &connection::handle_completion
-                                : &connection::write_response,
-                                self->shared_from_this(),
-                                boost::asio::placeholders::error
-                        )
-                );
+                // the next reply is checked (and possibly read from file) only once the
+                // previous one has been sent, so replies are produced at the client pace
+                if (!e && self->replies_.empty()) self->handle_completion(e);
+                else self->write_response(e);
             }
     );
 }
@@ -148,6 +148,9 @@ void connection::handle_request(boost::system::error_code const &e) {
         this->log_read();
         return this->shutdown();
     }
+    this->request_time_ = std::chrono::steady_clock::now();
+    this->bytes_in_ = sizeof(this->header_) + this->header_;
+    this->bytes_out_ = 0;
     try {
         this->timeout_timer_.cancel();
         this->msg_ = communication::message{
@@ -163,8 +166,7 @@ void connection::handle_request(boost::system::error_code const &e) {
 
 //    std::cout << "<<<<<<<<<<<<REQUEST>>>>>>>>>>>>" << std::endl;
 //    std::cout << this->msg_;
-    std::cout << "FROM\t";
-    this->logger_ptr_->log(this->user_, this->msg_);
+    this->logger_ptr_->log(this->user_, this->msg_, "FROM");
 
     this->req_handler_ptr_->handle_request(
             this->msg_,
@@ -194,6 +196,10 @@ void connection::read_request(boost::system::error_code const &e) {
                     self->log_read();
                     return self->shutdown();
                 }
+                if (self->header_ > self->buffer_.size()) {
+                    std::cerr << "Request exceeding the maximum message size" << std::endl;
+                    return self->shutdown();
+                }
                 self->schedule_timeout();
                 boost::asio::async_read(
                         self->socket_,
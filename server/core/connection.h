@@ -37,6 +37,10 @@ class connection : public boost::enable_shared_from_this<connection>, private bo
     communication::message msg_;
     // store the processed replies for a given request
     communication::message_queue replies_;
+    // request receipt time and bytes exchanged for the current request, used for logging
+    std::chrono::steady_clock::time_point request_time_;
+    size_t bytes_in_ = 0;
+    size_t bytes_out_ = 0;
 
     // This timer is used to manage user disconnection that are not automatically detected
     boost::asio::steady_timer timeout_timer_;
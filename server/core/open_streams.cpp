@@ -7,32 +7,104 @@ namespace fs = boost::filesystem;
  * doesn't exist, a new created one. The stream is stored
  * internally.
  *
- * @param user the user to identify the requested stream
- * @param path the path referring to the file the user wants to handle
+ * @param user the user session to identify the requested stream
+ * @param stream_id the id of the requested stream among the user session ones
+ * @param path the path referring to the file the user wants to handle: the data
+ * is written on a temporary file next to it, named after the session and the stream
+ * @param digest_type the digest type used to hash the data written on a new created stream
  * @return a pair composed of the following two parts:
  * @return - an iterator to the opened stream
  * @return - a bool indicating if the stream is already opened and simply retrieved or created and retrieved
  */
 get_stream_result open_streams::get_stream(
-        user const &user,
-        fs::path const &path
+        user &user,
+        uint32_t stream_id,
+        fs::path const &path,
+        communication::DIGEST_TYPE digest_type
 ) {
     std::unique_lock ul{this->m_};
-    return this->streams_.emplace(
-            user,
-            std::make_shared<fs::ofstream>(path, std::ios_base::binary | std::ios_base::app)
-    );
+    auto &user_streams = this->streams_[user.session_id()];
+    auto it = user_streams.find(stream_id);
+    if (it != user_streams.end()) return {it, false};
+    fs::path temp_path{path};
+    temp_path += '.' + std::to_string(user.session_id()) + '.' + std::to_string(stream_id) + ".temp";
+    // a leftover of a previous run may still have an encoding attribute, that truncating it doesn't drop
+    boost::system::error_code ec;
+    fs::remove(temp_path, ec);
+    return user_streams.emplace(stream_id, open_stream{
+            temp_path,
+            std::make_shared<fs::ofstream>(temp_path, std::ios_base::binary | std::ios_base::trunc),
+            hasher::get_instance(digest_type)
+    });
 }
 
 /*
- * Allows to retrieve an already opened stream or, if it
- * doesn't exist, a new created one. The stream is stored
- * internally.
+ * Allows to remove a stream.
+ *
+ * @param user the user session identifying the stream that has to be removed
+ * @param stream_id the id of the stream that has to be removed among the user session ones
+ * @return void
+ */
+void open_streams::erase_stream(user &user, uint32_t stream_id) {
+    std::unique_lock ul{this->m_};
+    auto it = this->streams_.find(user.session_id());
+    if (it == this->streams_.end()) return;
+    it->second.erase(stream_id);
+    if (it->second.empty()) this->streams_.erase(it);
+}
+
+/*
+ * Allows to mark a stream as failed, removing its temporary file. The
+ * stream is kept until its last chunk, so that the chunks sent before
+ * the client received the failure are not taken for a new upload. A
+ * stream failed on its first chunk is created already failed.
+ *
+ * @param user the user session identifying the stream that failed
+ * @param stream_id the id of the stream that failed among the user session ones
+ * @param is_last true if the failure has been detected on the last chunk of the stream
+ * @return void
+ */
+void open_streams::fail_stream(user &user, uint32_t stream_id, bool is_last) {
+    std::unique_lock ul{this->m_};
+    if (is_last && !this->streams_.count(user.session_id())) return;
+    auto it = this->streams_.try_emplace(user.session_id()).first;
+    auto stream_it = it->second.find(stream_id);
+    if (stream_it == it->second.end()) {
+        if (is_last) return;
+        stream_it = it->second.emplace(stream_id, open_stream{}).first;
+    }
+    open_stream &stream = stream_it->second;
+    if (!stream.failed) {
+        if (stream.ofs_ptr) stream.ofs_ptr->close();
+        boost::system::error_code ec;
+        fs::remove(stream.temp_path, ec);
+        stream.ofs_ptr.reset();
+        stream.hasher_ptr.reset();
+        stream.failed = true;
+    }
+    if (is_last) {
+        it->second.erase(stream_it);
+        if (it->second.empty()) this->streams_.erase(it);
+    }
+}
+
+/*
+ * Allows to remove all the streams opened during a user session,
+ * leaving untouched the ones of the other sessions of the same user.
+ * The temporary files of the uploads that have not been completed
+ * are removed.
  *
- * @param user the user identifying the stream that has to be removed
+ * @param user the user session whose streams have to be removed
  * @return void
  */
-void open_streams::erase_stream(user const &user) {
+void open_streams::erase_streams(user &user) {
     std::unique_lock ul{this->m_};
-    this->streams_.erase(user);
+    auto it = this->streams_.find(user.session_id());
+    if (it == this->streams_.end()) return;
+    boost::system::error_code ec;
+    for (auto &[stream_id, stream] : it->second) {
+        if (stream.ofs_ptr) stream.ofs_ptr->close();
+        fs::remove(stream.temp_path, ec);
+    }
+    this->streams_.erase(it);
 }
\ No newline at end of file
@@ -3,23 +3,51 @@
 
 #include <unordered_map>
 #include "user.h"
+#include "../../shared/utilities/hasher.h"
 
+/*
+ * An upload in progress: the path and the stream of the temporary file
+ * that is being written and the running hash of the data written so far.
+ * The temporary file is private to the stream and it is renamed into
+ * place only once the upload has been verified. A failed upload is kept
+ * until its last chunk, so that the chunks already sent are rejected.
+ */
+struct open_stream {
+    boost::filesystem::path temp_path;
+    std::shared_ptr<boost::filesystem::ofstream> ofs_ptr;
+    std::shared_ptr<hasher> hasher_ptr;
+    bool failed = false;
+};
 
 typedef std::pair<
-        std::unordered_map<user, std::shared_ptr<boost::filesystem::ofstream>>::iterator,
+        std::unordered_map<uint32_t, open_stream>::iterator,
         bool
 > get_stream_result;
 
 /*
  * This class allows handle open streams in a cuncurrent
- * way.
+ * way. Each user session can have multiple uploads in progress,
+ * identified by the stream id chosen by the client. Stream ids
+ * are chosen independently by each client connection, so the
+ * streams of different sessions of the same user are kept apart.
  */
 class open_streams {
-    std::unordered_map<user, std::shared_ptr<boost::filesystem::ofstream>> streams_;
+    // session id -> (stream id -> open stream) map
+    std::unordered_map<uint64_t, std::unordered_map<uint32_t, open_stream>> streams_;
     std::mutex m_;
 public:
-    get_stream_result get_stream(user const &user, boost::filesystem::path const &path);
-    void erase_stream(user const &user);
+    get_stream_result get_stream(
+            user &user,
+            uint32_t stream_id,
+            boost::filesystem::path const &path,
+            communication::DIGEST_TYPE digest_type
+    );
+
+    void erase_stream(user &user, uint32_t stream_id);
+
+    void fail_stream(user &user, uint32_t stream_id, bool is_last);
+
+    void erase_streams(user &user);
 };
 
 
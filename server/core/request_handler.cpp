@@ -1,9 +1,22 @@
 #include "request_handler.h"
 #include "../../shared/utilities/tools.h"
+#include "../../shared/utilities/hasher.h"
 #include "../../shared/communication/f_message.h"
+#include "../../shared/utilities/delta.h"
+#include "../../shared/utilities/cdc.h"
+#include "../../shared/utilities/compression.h"
 #include <boost/filesystem.hpp>
+#include <algorithm>
+#include <optional>
 #include <utility>
 #include <boost/algorithm/hex.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+// linux/fs.h is not included since its BLOCK_SIZE macro clashes with the TLV type
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
 
 namespace fs = boost::filesystem;
 namespace comm = communication;
@@ -14,13 +27,19 @@ namespace comm = communication;
  *
  * @param backup_root the backup root folder of all client backups
  * @param credentials_path the user credentials file path to authenticate them.
+ * @param dedup true if the received files have to be stored in the user chunk stores
+ * @param compress true if the received files have to be stored compressed
  * @return void
  */
 request_handler::request_handler(
         fs::path backup_root,
-        fs::path credentials_path
+        fs::path credentials_path,
+        bool dedup,
+        bool compress
 ) : backup_root_{std::move(backup_root)},
-    credentials_path_{std::move(credentials_path)} {}
+    credentials_path_{std::move(credentials_path)},
+    dedup_{dedup},
+    compress_{compress} {}
 
 /**
  * An helper to finalize the response. It adds
@@ -44,6 +63,151 @@ void close_response(
     replies.add_TLV(comm::TLV_TYPE::END);
 }
 
+/**
+ * An helper to copy a range of a stored file version
+ * into the file that is being received.
+ *
+ * @param is the stored file version stream
+ * @param offset the range offset
+ * @param length the range length
+ * @param ofs the received file stream
+ * @param hasher the running hash of the received file
+ * @return true if the whole range has been copied, false otherwise
+ */
+bool copy_range(std::istream &is, uint64_t offset, uint64_t length, fs::ofstream &ofs, hasher &hasher) {
+    static thread_local std::vector<char> buffer(comm::message_queue::CHUNK_SIZE);
+    is.clear();
+    is.seekg(static_cast<std::streamoff>(offset));
+    while (length > 0) {
+        auto to_read = static_cast<std::streamsize>(std::min<uint64_t>(length, buffer.size()));
+        if (!is.read(buffer.data(), to_read)) return false;
+        ofs.write(buffer.data(), to_read);
+        hasher.update(buffer.data(), to_read);
+        length -= to_read;
+    }
+    return true;
+}
+
+/**
+ * An helper to write the data TLVs of a CREATE or UPDATE request: CONTENT TLVs
+ * carry new data, ZCONTENT TLVs compressed new data, CHUNK TLVs refer to chunks
+ * of the user chunk store and COPY TLVs to ranges of the stored version of the file.
+ *
+ * @param msg_view tlv_view of the request message, positioned on the first data TLV
+ * @param user the client session information
+ * @param stored_path the path of the stored version of the file, empty if there is none
+ * @param ofs the received file stream
+ * @param hasher the running hash of the received file
+ * @return true if all the data has been written, false if a TLV refers to missing or invalid data
+ */
+bool write_data(
+        comm::tlv_view &msg_view,
+        user &user,
+        fs::path const &stored_path,
+        fs::ofstream &ofs,
+        hasher &hasher
+) {
+    static thread_local std::vector<char> chunk;
+    std::unique_ptr<std::istream> stored_is_ptr;
+    do {
+        if (msg_view.tlv_type() == comm::TLV_TYPE::CONTENT) {
+            ofs.write(reinterpret_cast<char const *>(std::to_address(msg_view.cbegin())), msg_view.length());
+            hasher.update(std::to_address(msg_view.cbegin()), msg_view.length());
+        } else if (msg_view.tlv_type() == comm::TLV_TYPE::ZCONTENT) {
+            if (!compression::decompress(
+                    user.compression_type(),
+                    std::to_address(msg_view.cbegin()),
+                    msg_view.length(),
+                    chunk
+            )) {
+                return false;
+            }
+            ofs.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            hasher.update(chunk.data(), chunk.size());
+        } else if (msg_view.tlv_type() == comm::TLV_TYPE::CHUNK) {
+            if (msg_view.length() != cdc::HASH_SIZE) return false;
+            cdc::hash_type hash;
+            std::copy(msg_view.cbegin(), msg_view.cend(), hash.begin());
+            if (!user.chunks()->read(hash, chunk)) return false;
+            ofs.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+            hasher.update(chunk.data(), chunk.size());
+        } else if (msg_view.tlv_type() == comm::TLV_TYPE::COPY) {
+            if (stored_path.empty() || msg_view.length() != delta::COPY_SIZE) return false;
+            auto [offset, length] = delta::unpack_copy(std::to_address(msg_view.cbegin()));
+            if (!stored_is_ptr) stored_is_ptr = user.chunks()->open(stored_path);
+            if (!copy_range(*stored_is_ptr, offset, length, ofs, hasher)) return false;
+        } else break;
+    } while (msg_view.next_tlv());
+    return true;
+}
+
+/**
+ * An helper to compute the digest of a stored file, that can be kept
+ * as a manifest in the user chunk store or compressed.
+ *
+ * @param user the client session information
+ * @param absolute_path the stored file absolute path
+ * @param relative_path the stored file relative path
+ * @return the stored file digest
+ */
+std::string stored_file_hash(user &user, fs::path const &absolute_path, fs::path const &relative_path) {
+    if (!directory::chunk_store::encoded(absolute_path)) {
+        return tools::file_hash(absolute_path, relative_path, user.digest_type());
+    }
+    static thread_local std::vector<char> buffer(comm::message_queue::CHUNK_SIZE);
+    auto hash = hasher::get_instance(user.digest_type());
+    std::string relative_path_str{relative_path.generic_path().string()};
+    hash->update(relative_path_str.c_str(), relative_path_str.size());
+    auto is_ptr = user.chunks()->open(absolute_path);
+    while (is_ptr->read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || is_ptr->gcount() > 0) {
+        hash->update(buffer.data(), is_ptr->gcount());
+    }
+    if (is_ptr->bad()) {
+        throw fs::filesystem_error{"Failed to read file", absolute_path, boost::system::error_code{}};
+    }
+    return hash->digest();
+}
+
+/**
+ * An helper to check if a relative path sent by a client
+ * refers to a file outside the user directory.
+ *
+ * @param relative_path the relative path
+ * @return true if the path contains parent directory components, false otherwise
+ */
+bool outside_dir(fs::path const &relative_path) {
+    return std::any_of(relative_path.begin(), relative_path.end(), [](fs::path const &component) {
+        return component == "..";
+    });
+}
+
+/**
+ * An helper to copy a stored file. The copy shares the data of the
+ * stored file (reflink) if the filesystem supports it, otherwise the
+ * data is copied by the kernel, without passing through user space.
+ * The encoding of the stored file is copied too.
+ *
+ * @param source_path the stored file absolute path
+ * @param absolute_path the copy absolute path
+ * @return true if the file has been copied, false otherwise
+ */
+bool clone_file(fs::path const &source_path, fs::path const &absolute_path) {
+    int source_fd = ::open(source_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (source_fd == -1) return false;
+    int fd = ::open(absolute_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    bool cloned = fd != -1 && ioctl(fd, FICLONE, source_fd) == 0;
+    if (fd != -1 && !cloned) {
+        ssize_t copied;
+        while ((copied = copy_file_range(source_fd, nullptr, fd, nullptr, comm::message_queue::CHUNK_SIZE, 0)) > 0);
+        cloned = copied == 0;
+    }
+    if (fd != -1 && close(fd) == -1) cloned = false;
+    close(source_fd);
+    return cloned && directory::chunk_store::set_encoding(
+            absolute_path,
+            directory::chunk_store::encoding(source_path)
+    );
+}
 
 /**
  * Handle authentication task given specific user data
@@ -71,13 +235,55 @@ void request_handler::handle_auth(
 
     password = std::string{msg_view.cbegin(), msg_view.cend()};
 
+    // the client can list the digest and compression types it supports, ordered from the preferred one
+    auto digest_type = comm::DIGEST_TYPE::DIGEST_MD5;
+    auto const &supported = hasher::supported();
+    bool negotiated = false;
+    auto compression_type = comm::COMPRESSION_TYPE::COMPRESSION_NONE;
+    auto const &supported_compressions = compression::supported();
+    while (msg_view.next_tlv()) {
+        try {
+            int offered = std::stoi(std::string{msg_view.cbegin(), msg_view.cend()});
+            if (msg_view.tlv_type() == comm::TLV_TYPE::DIGEST && !negotiated &&
+                std::find(supported.cbegin(), supported.cend(), offered) != supported.cend()) {
+                digest_type = static_cast<comm::DIGEST_TYPE>(offered);
+                negotiated = true;
+            } else if (msg_view.tlv_type() == comm::TLV_TYPE::COMPRESSION &&
+                       compression_type == comm::COMPRESSION_TYPE::COMPRESSION_NONE &&
+                       std::find(supported_compressions.cbegin(), supported_compressions.cend(), offered) !=
+                       supported_compressions.cend()) {
+                compression_type = static_cast<comm::COMPRESSION_TYPE>(offered);
+            }
+        }
+        catch (std::exception &ex) {}
+    }
+
     if (tools::verify_password(this->credentials_path_, username, password)) {
         std::string user_id = tools::MD5_hash(username);
         user.id(user_id)
                 .username(username)
                 .dir(this->backup_root_.generic_path() / user_id)
+                .index(this->backup_root_.generic_path() / (user_id + ".index"))
+                .chunks(this->backup_root_.generic_path() / (user_id + ".chunks"), this->compress_)
+                .digest_type(digest_type)
+                .compression_type(compression_type)
                 .auth(true);
-        return close_response(replies, comm::TLV_TYPE::OK);
+        replies.add_TLV(comm::TLV_TYPE::OK);
+        // a client that didn't list any digest type uses MD5
+        if (negotiated) {
+            auto digest_type_str = std::to_string(digest_type);
+            replies.add_TLV(comm::TLV_TYPE::DIGEST, digest_type_str.size(), digest_type_str.c_str());
+        }
+        // a client that didn't list any compression type doesn't compress the file data
+        if (compression_type != comm::COMPRESSION_TYPE::COMPRESSION_NONE) {
+            auto compression_type_str = std::to_string(compression_type);
+            replies.add_TLV(
+                    comm::TLV_TYPE::COMPRESSION,
+                    compression_type_str.size(),
+                    compression_type_str.c_str()
+            );
+        }
+        replies.add_TLV(comm::TLV_TYPE::END);
     } else return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_AUTH_FAILED);
 }
 
@@ -93,26 +299,37 @@ void request_handler::handle_list(
         user &user
 ) {
     auto user_dir = user.dir();
+    auto user_index = user.index();
     fs::path const &user_dir_path = user_dir->path();
     size_t user_dir_path_length = user_dir_path.size();
 
     try {
-        for (auto &de : fs::recursive_directory_iterator(user_dir_path)) {
-            fs::path const &absolute_path = de.path();
-            if (fs::is_regular_file(absolute_path)) {
-                fs::path relative_path{absolute_path.generic_path().string().substr(user_dir_path_length)};
-                std::string digest = tools::MD5_hash(absolute_path, relative_path);
-                if (!user_dir->insert_or_assign(relative_path, directory::s_resource{
-                        true,
-                        digest
-                })) {
-                    user_dir->clear();
-                    return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_LIST_FAILED);
+        // the index avoids reading all the stored files: they are hashed only if it is missing or
+        // it has been built for another digest type
+        auto content = user_index->load(user.digest_type());
+        if (!content || !fs::is_directory(user_dir_path)) {
+            content.emplace();
+            for (auto &de : fs::recursive_directory_iterator(user_dir_path)) {
+                fs::path const &absolute_path = de.path();
+                // the temporary files of the uploads in progress are not stored files yet
+                if (fs::is_regular_file(absolute_path) && absolute_path.extension() != ".temp") {
+                    fs::path relative_path{absolute_path.generic_path().string().substr(user_dir_path_length)};
+                    content->emplace(relative_path, stored_file_hash(user, absolute_path, relative_path));
                 }
-
-                std::string sign = tools::create_sign(relative_path, digest);
-                replies.add_TLV(comm::TLV_TYPE::ITEM, sign.size(), sign.c_str());
             }
+            user_index->reset(user.digest_type(), content.value());
+        }
+        for (auto const &[relative_path, digest] : content.value()) {
+            if (!user_dir->insert_or_assign(relative_path, directory::s_resource{
+                    true,
+                    digest
+            })) {
+                user_dir->clear();
+                return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_LIST_FAILED);
+            }
+
+            std::string sign = tools::create_sign(relative_path, digest);
+            replies.add_TLV(comm::TLV_TYPE::ITEM, sign.size(), sign.c_str());
         }
         user.synced(true);
         close_response(replies, comm::TLV_TYPE::OK);
@@ -132,12 +349,14 @@ void request_handler::handle_list(
  * @param msg_view tlv_view of the request message containing file data
  * @param replies container for server responses
  * @param user the client session information
+ * @param stream_id the id of the stream the file is uploaded on
  * @return void
  */
 void request_handler::handle_create(
         comm::tlv_view &msg_view,
         comm::message_queue &replies,
-        user &user
+        user &user,
+        uint32_t stream_id
 ) {
     // Check if request contains file metadata
     if (msg_view.tlv_type() != comm::TLV_TYPE::ITEM) {
@@ -148,17 +367,23 @@ void request_handler::handle_create(
     fs::path &c_relative_path = splitted_c_sign.first;
     std::string c_digest = splitted_c_sign.second;
     auto user_dir = user.dir();
+    // a chunk rejected before reaching its stream fails the whole upload
+    bool is_last = msg_view.verify_end();
 
     replies.add_TLV(comm::TLV_TYPE::ITEM, c_sign.size(), c_sign.c_str());
 
-    // Check if request contains file content
-    if (!msg_view.next_tlv() || msg_view.tlv_type() != comm::TLV_TYPE::CONTENT) {
+    // Check if request contains file content, either whole or as chunks references
+    if (!msg_view.next_tlv() || (msg_view.tlv_type() != comm::TLV_TYPE::CONTENT &&
+                                 msg_view.tlv_type() != comm::TLV_TYPE::ZCONTENT &&
+                                 msg_view.tlv_type() != comm::TLV_TYPE::CHUNK)) {
+        this->streams_.fail_stream(user, stream_id, is_last);
         return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CREATE_NO_CONTENT);
     }
 
     auto rsrc = user_dir->rsrc(c_relative_path);
     // if the resource already exists on server and already synced
     if (rsrc && rsrc.value().synced()) {
+        this->streams_.fail_stream(user, stream_id, is_last);
         return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CREATE_ALREADY_EXIST);
     }
 
@@ -167,25 +392,41 @@ void request_handler::handle_create(
     // creating necessary directories for containing the file that has to be created
     create_directories(absolute_path.parent_path(), ec);
     if (ec) {
+        this->streams_.fail_stream(user, stream_id, is_last);
         return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CREATE_FAILED);
     }
 
+    fs::path temp_path;
     std::shared_ptr<fs::ofstream> ofs_ptr;
-    bool is_last;
+    std::shared_ptr<hasher> hasher_ptr;
+    bool written = true;
     try {
-        auto result = this->streams_.get_stream(user, absolute_path);
-        // file stream ptr
-        ofs_ptr = result.first->second;
+        auto result = this->streams_.get_stream(user, stream_id, absolute_path, user.digest_type());
+        // the chunks sent before the client received the failure of the upload are rejected
+        if (result.first->second.failed) {
+            this->streams_.fail_stream(user, stream_id, is_last);
+            return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CREATE_FAILED);
+        }
+        // file stream ptr and running hash of the written data
+        temp_path = result.first->second.temp_path;
+        ofs_ptr = result.first->second.ofs_ptr;
+        hasher_ptr = result.first->second.hasher_ptr;
+        // file digests cover the relative path followed by the file content
+        if (result.second) {
+            std::string relative_path_str{c_relative_path.generic_path().string()};
+            hasher_ptr->update(relative_path_str.c_str(), relative_path_str.size());
+        }
         if (!ofs_ptr || !*ofs_ptr) {
+            this->streams_.fail_stream(user, stream_id, is_last);
+            user_dir->erase(c_relative_path);
             return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CREATE_FAILED);
         }
 
         // writing file data
-        std::copy(msg_view.cbegin(), msg_view.cend(), std::ostreambuf_iterator<char>(*ofs_ptr));
+        written = write_data(msg_view, user, fs::path{}, *ofs_ptr, *hasher_ptr);
         ofs_ptr->flush();
 
         bool is_first = result.second;
-        is_last = msg_view.verify_end();
 
         // updating resource parameters on user dir view
         if (is_first) {
@@ -199,30 +440,35 @@ void request_handler::handle_create(
         }
     } catch (fs::filesystem_error &ex) {
         std::cerr << "Filesystem error from " << ex.what() << std::endl;
+        this->streams_.fail_stream(user, stream_id, is_last);
+        user_dir->erase(c_relative_path);
         return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CREATE_FAILED);
     }
 
-    if (is_last) {
+    // a reference to a chunk missing from the store ends the creation
+    if (is_last || !written) {
         ofs_ptr->close();
-        this->streams_.erase_stream(user);
-        std::string s_digest;
-        try {
-            // Comparing server file digest with the sent digest
-            s_digest = tools::MD5_hash(absolute_path, c_relative_path);
-            if (s_digest != c_digest) {
-                remove(absolute_path, ec);  // if digests doesn't match, remove created file
-                if (ec) std::exit(EXIT_FAILURE);
-                user_dir->erase(c_relative_path);
-                return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CREATE_NO_MATCH);
-            }
-        }
-        catch (fs::filesystem_error &ex) {
-            std::cerr << "Failed to access to file:\n\t" << absolute_path << std::endl;
-            remove(absolute_path, ec);
-            if (ec) std::exit(EXIT_FAILURE);
+        written = written && static_cast<bool>(*ofs_ptr);
+        // the digest of the received data has been computed while writing it
+        std::string s_digest = hasher_ptr->digest();
+        // Comparing server file digest with the sent digest
+        if (!written || s_digest != c_digest) {
+            // the received file is removed
+            this->streams_.fail_stream(user, stream_id, is_last);
             user_dir->erase(c_relative_path);
-            return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CREATE_FAILED);
+            return close_response(
+                    replies,
+                    comm::TLV_TYPE::ERROR,
+                    written ? comm::ERR_TYPE::ERR_CREATE_NO_MATCH : comm::ERR_TYPE::ERR_CREATE_FAILED
+            );
         }
+        this->streams_.erase_stream(user, stream_id);
+        // if the file can't be replaced by its manifest or compressed, it is kept as it is
+        if (this->dedup_) user.chunks()->store(temp_path);
+        if (this->compress_) user.chunks()->compress(temp_path);
+        rename(temp_path, absolute_path, ec);
+        if (ec) std::exit(EXIT_FAILURE);
+        user.index()->put(user.digest_type(), c_relative_path, s_digest);
     }
     return close_response(replies, comm::TLV_TYPE::OK);
 }
@@ -233,12 +479,14 @@ void request_handler::handle_create(
  * @param msg_view tlv_view of the request message containing file data
  * @param replies container for server responses
  * @param user the client session information
+ * @param stream_id the id of the stream the file is uploaded on
  * @return void
  */
 void request_handler::handle_update(
         comm::tlv_view &msg_view,
         comm::message_queue &replies,
-        user &user
+        user &user,
+        uint32_t stream_id
 ) {
     // Check if request contains file metadata
     if (msg_view.tlv_type() != comm::TLV_TYPE::ITEM) {
@@ -249,41 +497,67 @@ void request_handler::handle_update(
     fs::path &c_relative_path = splitted_c_sign.first;
     std::string c_digest = splitted_c_sign.second;
     auto user_dir = user.dir();
+    // a chunk rejected before reaching its stream fails the whole upload
+    bool is_last = msg_view.verify_end();
 
     replies.add_TLV(comm::TLV_TYPE::ITEM, c_sign.size(), c_sign.c_str());
 
-    // Check if request contains file content
-    if (!msg_view.next_tlv() || msg_view.tlv_type() != comm::TLV_TYPE::CONTENT) {
+    // Check if request contains file content, either whole, as a delta or as chunks references
+    if (!msg_view.next_tlv() || (msg_view.tlv_type() != comm::TLV_TYPE::CONTENT &&
+                                 msg_view.tlv_type() != comm::TLV_TYPE::ZCONTENT &&
+                                 msg_view.tlv_type() != comm::TLV_TYPE::COPY &&
+                                 msg_view.tlv_type() != comm::TLV_TYPE::CHUNK)) {
+        this->streams_.fail_stream(user, stream_id, is_last);
         return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_UPDATE_NO_CONTENT);
     }
 
     auto rsrc = user_dir->rsrc(c_relative_path);
     // if the resource doesn't exist on server
-    if (!rsrc) return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_UPDATE_NOT_EXIST);
+    if (!rsrc) {
+        this->streams_.fail_stream(user, stream_id, is_last);
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_UPDATE_NOT_EXIST);
+    }
     // if the resource is already updated
-    if (rsrc.value().digest() == c_digest) {
+    if (rsrc.value().digest_equals(c_digest)) {
+        this->streams_.fail_stream(user, stream_id, is_last);
         return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_UPDATE_ALREADY_UPDATED);
     }
 
     fs::path absolute_path{user_dir->path() / c_relative_path};
-    fs::path temp_path{absolute_path};
-    temp_path += ".temp";
 
+    fs::path temp_path;
     std::shared_ptr<fs::ofstream> ofs_ptr;
+    std::shared_ptr<hasher> hasher_ptr;
     bool is_first;
-    bool is_last;
+    bool copied = true;
     try {
-        get_stream_result result = this->streams_.get_stream(user, temp_path);
-        // file stream ptr
-        ofs_ptr = result.first->second;
+        get_stream_result result = this->streams_.get_stream(user, stream_id, absolute_path, user.digest_type());
+        // the chunks sent before the client received the failure of the upload are rejected
+        if (result.first->second.failed) {
+            this->streams_.fail_stream(user, stream_id, is_last);
+            return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_UPDATE_FAILED);
+        }
+        // file stream ptr and running hash of the written data
+        temp_path = result.first->second.temp_path;
+        ofs_ptr = result.first->second.ofs_ptr;
+        hasher_ptr = result.first->second.hasher_ptr;
+        // file digests cover the relative path followed by the file content
+        if (result.second) {
+            std::string relative_path_str{c_relative_path.generic_path().string()};
+            hasher_ptr->update(relative_path_str.c_str(), relative_path_str.size());
+        }
         if (!ofs_ptr || !*ofs_ptr) {
+            this->streams_.fail_stream(user, stream_id, is_last);
+            // the old file is still there
+            user_dir->insert_or_assign(c_relative_path, directory::s_resource{
+                    true, rsrc.value().digest()
+            });
             return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_UPDATE_FAILED);
         }
         // writing file data
-        std::copy(msg_view.cbegin(), msg_view.cend(), std::ostreambuf_iterator<char>(*ofs_ptr));
+        copied = write_data(msg_view, user, absolute_path, *ofs_ptr, *hasher_ptr);
 
         is_first = result.second;
-        is_last = msg_view.verify_end();
 
         // updating resource parameters on user dir view
         if (is_first) {
@@ -297,37 +571,158 @@ void request_handler::handle_update(
         }
     } catch (fs::filesystem_error &ex) {
         std::cerr << "Filesystem error from " << ex.what() << std::endl;
+        this->streams_.fail_stream(user, stream_id, is_last);
+        user_dir->insert_or_assign(c_relative_path, directory::s_resource{
+                true, rsrc.value().digest()
+        });
         return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_UPDATE_FAILED);
     }
 
-    if (is_last) {
+    // a reference to ranges missing from the stored version or to chunks missing from the store ends the update
+    if (is_last || !copied) {
         ofs_ptr->close();
-        this->streams_.erase_stream(user);
+        bool written = copied && static_cast<bool>(*ofs_ptr);
+        // the digest of the received data has been computed while writing it
+        std::string s_digest = hasher_ptr->digest();
         boost::system::error_code ec;
-        remove(absolute_path, ec);
-        if (ec) std::exit(EXIT_FAILURE);
+        // Comparing server file digest with the sent digest before replacing the old file
+        if (!written || s_digest != c_digest) {
+            // the received file is removed
+            this->streams_.fail_stream(user, stream_id, is_last);
+            // the old file is still there
+            user_dir->insert_or_assign(c_relative_path, directory::s_resource{
+                    true, rsrc.value().digest()
+            });
+            return close_response(
+                    replies,
+                    comm::TLV_TYPE::ERROR,
+                    written ? comm::ERR_TYPE::ERR_UPDATE_NO_MATCH : comm::ERR_TYPE::ERR_UPDATE_FAILED
+            );
+        }
+        this->streams_.erase_stream(user, stream_id);
+        // the chunks of the replaced version are released only once it is not there anymore
+        auto stored_entries = directory::chunk_store::read_manifest(absolute_path);
+        if (this->dedup_) user.chunks()->store(temp_path);
+        if (this->compress_) user.chunks()->compress(temp_path);
         rename(temp_path, absolute_path, ec);
         if (ec) std::exit(EXIT_FAILURE);
-        std::string s_digest;
-        try {
-            // Comparing server file digest with the sent digest
-            s_digest = tools::MD5_hash(absolute_path, c_relative_path);
-            if (s_digest != c_digest) {
-                remove(absolute_path, ec);  // if digests doesn't match, remove created file
-                if (ec) std::exit(EXIT_FAILURE);
-                user_dir->erase(c_relative_path);
-                return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_UPDATE_NO_MATCH);
-            }
+        if (stored_entries) user.chunks()->release(stored_entries.value());
+        user.index()->put(user.digest_type(), c_relative_path, s_digest);
+    }
+    return close_response(replies, comm::TLV_TYPE::OK);
+}
+
+/**
+ * Handle signature task for a specific file: the signatures of the stored
+ * version blocks are sent, so that the file can be updated with a delta
+ *
+ * @param msg_view tlv_view of the request message
+ * @param replies container for server responses
+ * @param user the client session information
+ * @return void
+ */
+void request_handler::handle_signature(
+        comm::tlv_view &msg_view,
+        comm::message_queue &replies,
+        user &user
+) {
+    // Check if request contains file metadata
+    if (msg_view.tlv_type() != comm::TLV_TYPE::ITEM) {
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_SIGNATURE_NO_ITEM);
+    }
+    std::string c_sign{msg_view.cbegin(), msg_view.cend()};
+    fs::path c_relative_path = tools::split_sign(c_sign).first;
+    auto user_dir = user.dir();
+
+    replies.add_TLV(comm::TLV_TYPE::ITEM, c_sign.size(), c_sign.c_str());
+
+    // the stored version has to be complete
+    auto rsrc = user_dir->rsrc(c_relative_path);
+    if (!rsrc || !rsrc.value().synced()) {
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_SIGNATURE_NOT_EXIST);
+    }
+
+    fs::path absolute_path{user_dir->path() / c_relative_path};
+    auto is_ptr = user.chunks()->open(absolute_path);
+    is_ptr->seekg(0, std::ios_base::end);
+    auto file_size = static_cast<std::streamoff>(is_ptr->tellg());
+    is_ptr->seekg(0, std::ios_base::beg);
+    if (!*is_ptr || file_size < 0) {
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_SIGNATURE_FAILED);
+    }
+
+    size_t block_size = delta::block_size(file_size);
+    std::string block_size_str{std::to_string(block_size)};
+    replies.add_TLV(comm::TLV_TYPE::BLOCK_SIZE, block_size_str.size(), block_size_str.c_str());
+
+    // signatures are grouped in BLOCKS TLVs of about half a chunk; the last partial block
+    // is not signed, since it can only be matched at the end of the file
+    size_t const signatures_per_tlv = comm::message_queue::CHUNK_SIZE / 2 / delta::SIGNATURE_SIZE;
+    std::vector<uint8_t> block(block_size);
+    std::vector<uint8_t> packed(signatures_per_tlv * delta::SIGNATURE_SIZE);
+    size_t packed_count = 0;
+    delta::rolling_checksum checksum;
+    while (is_ptr->read(reinterpret_cast<char *>(block.data()), static_cast<std::streamsize>(block_size))) {
+        checksum.reset(block.data(), block_size);
+        delta::pack_signature(
+                delta::block_signature{checksum.value(), delta::strong_checksum(block.data(), block_size)},
+                &packed[packed_count++ * delta::SIGNATURE_SIZE]
+        );
+        if (packed_count == signatures_per_tlv) {
+            replies.add_TLV(comm::TLV_TYPE::BLOCKS, packed.size(), reinterpret_cast<char const *>(packed.data()));
+            packed_count = 0;
         }
-        catch (fs::filesystem_error &ex) {
-            std::cerr << "Failed to access to file:\n\t" << absolute_path << std::endl;
-            remove(absolute_path, ec);
-            if (ec) std::exit(EXIT_FAILURE);
-            user_dir->erase(c_relative_path);
-            return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_UPDATE_FAILED);
+    }
+    if (is_ptr->bad()) return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_SIGNATURE_FAILED);
+    if (packed_count > 0) {
+        replies.add_TLV(
+                comm::TLV_TYPE::BLOCKS,
+                packed_count * delta::SIGNATURE_SIZE,
+                reinterpret_cast<char const *>(packed.data())
+        );
+    }
+    close_response(replies, comm::TLV_TYPE::OK);
+}
+
+/**
+ * Handle chunks task for a specific file: the client lists the hashes of the file
+ * chunks and the ones missing from the user chunk store are replied, so that only
+ * them have to be sent in the following CREATE
+ *
+ * @param msg_view tlv_view of the request message
+ * @param replies container for server responses
+ * @param user the client session information
+ * @return void
+ */
+void request_handler::handle_chunks(
+        comm::tlv_view &msg_view,
+        comm::message_queue &replies,
+        user &user
+) {
+    // Check if request contains file metadata
+    if (msg_view.tlv_type() != comm::TLV_TYPE::ITEM) {
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CHUNKS_NO_ITEM);
+    }
+    std::string c_sign{msg_view.cbegin(), msg_view.cend()};
+    replies.add_TLV(comm::TLV_TYPE::ITEM, c_sign.size(), c_sign.c_str());
+    if (!this->dedup_) return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CHUNKS_FAILED);
+
+    // a bit for each listed chunk, in the same order, set if the chunk is missing
+    std::vector<uint8_t> missing;
+    size_t count = 0;
+    cdc::hash_type hash;
+    while (msg_view.next_tlv() && msg_view.tlv_type() == comm::TLV_TYPE::HASHES) {
+        if (msg_view.length() % cdc::HASH_SIZE != 0) {
+            return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CHUNKS_FAILED);
+        }
+        for (auto it = msg_view.cbegin(); it != msg_view.cend(); it += cdc::HASH_SIZE, count++) {
+            std::copy_n(it, cdc::HASH_SIZE, hash.begin());
+            if (count % 8 == 0) missing.push_back(0);
+            if (!user.chunks()->contains(hash)) missing.back() |= 0x80 >> (count % 8);
         }
     }
-    return close_response(replies, comm::TLV_TYPE::OK);
+    replies.add_TLV(comm::TLV_TYPE::MISSING, missing.size(), reinterpret_cast<char const *>(missing.data()));
+    close_response(replies, comm::TLV_TYPE::OK);
 }
 
 /**
@@ -358,20 +753,23 @@ void request_handler::handle_erase(
     auto rsrc = user_dir->rsrc(c_relative_path);
 
     // if the resource doesn't exist on server or has a different digest
-    if (!rsrc || rsrc.value().digest() != c_digest) {
+    if (!rsrc || !rsrc.value().digest_equals(c_digest)) {
         return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_ERASE_NO_MATCH);
     }
 
     fs::path absolute_path{user_dir->path() / c_relative_path};
     fs::path tmp{absolute_path};
     boost::system::error_code ec;
+    auto stored_entries = directory::chunk_store::read_manifest(absolute_path);
     // delete the file
     remove(tmp, ec);
     if (ec) {
         close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_ERASE_FAILED);
     }
     else {
+        if (stored_entries) user.chunks()->release(stored_entries.value());
         user_dir->erase(c_relative_path);
+        user.index()->erase(user.digest_type(), c_relative_path);
         close_response(replies, comm::TLV_TYPE::OK);
     }
     // deleting all empty directories that contained the deleted file
@@ -382,6 +780,90 @@ void request_handler::handle_erase(
     }
 }
 
+/**
+ * Handle clone task for a specific file: the file is obtained copying a
+ * stored file with the same content, so that its content doesn't have
+ * to be uploaded again. The copy of a manifest refers to the same chunks.
+ * The stored file could be handled by another session, so it is read
+ * from the filesystem and the digest of the copy is verified as usual.
+ *
+ * @param msg_view tlv_view of the request message
+ * @param replies container for server responses
+ * @param user the client session information
+ * @return void
+ */
+void request_handler::handle_clone(
+        comm::tlv_view &msg_view,
+        comm::message_queue &replies,
+        user &user
+) {
+    // Check if request contains file metadata
+    if (msg_view.tlv_type() != comm::TLV_TYPE::ITEM) {
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CLONE_NO_ITEM);
+    }
+    std::string c_sign{msg_view.cbegin(), msg_view.cend()};
+    auto splitted_c_sign = tools::split_sign(c_sign);
+    fs::path &c_relative_path = splitted_c_sign.first;
+    std::string c_digest = splitted_c_sign.second;
+    auto user_dir = user.dir();
+
+    replies.add_TLV(comm::TLV_TYPE::ITEM, c_sign.size(), c_sign.c_str());
+
+    // Check if request contains the metadata of the file that has to be copied
+    if (!msg_view.next_tlv() || msg_view.tlv_type() != comm::TLV_TYPE::SOURCE) {
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CLONE_NO_SOURCE);
+    }
+    fs::path source_relative_path = tools::split_sign(std::string{msg_view.cbegin(), msg_view.cend()}).first;
+
+    if (outside_dir(source_relative_path) || outside_dir(c_relative_path)) {
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CLONE_NOT_EXIST);
+    }
+    if (user_dir->contains(c_relative_path)) {
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CLONE_ALREADY_EXIST);
+    }
+    // only the files already received can be copied, not the ones that are being uploaded
+    auto source_rsrc = user_dir->rsrc(source_relative_path);
+    if (!source_rsrc || !source_rsrc.value().synced()) {
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CLONE_NOT_EXIST);
+    }
+
+    fs::path source_path{user_dir->path() / source_relative_path};
+    fs::path absolute_path{user_dir->path() / c_relative_path};
+    boost::system::error_code ec;
+    if (!fs::is_regular_file(source_path, ec)) {
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CLONE_NOT_EXIST);
+    }
+    // creating necessary directories for containing the file that has to be created
+    create_directories(absolute_path.parent_path(), ec);
+    if (ec || !clone_file(source_path, absolute_path)) {
+        remove(absolute_path, ec);
+        return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_CLONE_FAILED);
+    }
+    auto stored_entries = directory::chunk_store::read_manifest(absolute_path);
+    if (stored_entries) user.chunks()->retain(stored_entries.value());
+
+    // the digest covers the relative path too, so it is computed on the copy
+    std::string s_digest;
+    try {
+        s_digest = stored_file_hash(user, absolute_path, c_relative_path);
+    } catch (fs::filesystem_error &ex) {
+        std::cerr << "Filesystem error from " << ex.what() << std::endl;
+    }
+    if (s_digest != c_digest) {
+        remove(absolute_path, ec);  // if digests doesn't match, remove created file
+        if (ec) std::exit(EXIT_FAILURE);
+        if (stored_entries) user.chunks()->release(stored_entries.value());
+        return close_response(
+                replies,
+                comm::TLV_TYPE::ERROR,
+                s_digest.empty() ? comm::ERR_TYPE::ERR_CLONE_FAILED : comm::ERR_TYPE::ERR_CLONE_NO_MATCH
+        );
+    }
+    user_dir->insert_or_assign(c_relative_path, directory::s_resource{true, s_digest});
+    user.index()->put(user.digest_type(), c_relative_path, s_digest);
+    close_response(replies, comm::TLV_TYPE::OK);
+}
+
 void handle_retrieve(
         comm::tlv_view &msg_view,
         comm::message_queue &replies,
@@ -397,18 +879,17 @@ void handle_retrieve(
     auto user_dir = user.dir();
     auto f_msg = communication::f_message::get_instance(
             communication::MSG_TYPE::RETRIEVE,
-            user_dir->path() / c_relative_path,
+            user.chunks()->open(user_dir->path() / c_relative_path),
             c_sign
     );
+    f_msg->compression_type(user.compression_type());
     try {
         replies = comm::message_queue {communication::MSG_TYPE::RETRIEVE};
-        while (f_msg->next_chunk()) {
-            replies.add_message(communication::message{
-                    std::make_shared<std::vector<uint8_t>>(
-                            f_msg->raw_msg_ptr()->cbegin(),
-                            f_msg->raw_msg_ptr()->cend()
-                    )
-            });
+        // the first chunk is read immediately to report errors on opening the file,
+        // the other ones only while the previous ones are sent
+        if (f_msg->next_chunk()) {
+            replies.add_message(communication::message{f_msg->raw_msg_ptr()});
+            replies.add_f_message(f_msg);
         }
     }
     catch (std::exception& ex) {
@@ -437,6 +918,22 @@ void request_handler::handle_request(
     if (!msg_view.next_tlv()) {
         return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_NO_CONTENT);
     }
+    // a leading STREAM TLV identifies the transfer the request belongs to: it is echoed in
+    // the reply, so that the client can interleave multiple transfers on the same connection
+    uint32_t stream_id = 0;
+    if (msg_view.tlv_type() == comm::TLV_TYPE::STREAM) {
+        std::string stream_id_str{msg_view.cbegin(), msg_view.cend()};
+        replies.add_TLV(comm::TLV_TYPE::STREAM, stream_id_str.size(), stream_id_str.c_str());
+        try {
+            stream_id = std::stoul(stream_id_str);
+        }
+        catch (std::exception &ex) {
+            return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_NO_CONTENT);
+        }
+        if (!msg_view.next_tlv()) {
+            return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_NO_CONTENT);
+        }
+    }
     if (!user.auth()) {
         if (c_msg_type == comm::MSG_TYPE::AUTH) {
             return handle_auth(msg_view, replies, user);
@@ -448,11 +945,17 @@ void request_handler::handle_request(
             } else return close_response(replies, comm::TLV_TYPE::ERROR, comm::ERR_TYPE::ERR_MSG_TYPE_REJECTED);
         } else {
             if (c_msg_type == comm::MSG_TYPE::CREATE) {
-                return handle_create(msg_view, replies, user);
+                return handle_create(msg_view, replies, user, stream_id);
             } else if (c_msg_type == comm::MSG_TYPE::UPDATE) {
-                return handle_update(msg_view, replies, user);
+                return handle_update(msg_view, replies, user, stream_id);
+            } else if (c_msg_type == comm::MSG_TYPE::SIGNATURE) {
+                return handle_signature(msg_view, replies, user);
+            } else if (c_msg_type == comm::MSG_TYPE::CHUNKS) {
+                return handle_chunks(msg_view, replies, user);
             } else if (c_msg_type == comm::MSG_TYPE::ERASE) {
                 return handle_erase(msg_view, replies, user);
+            } else if (c_msg_type == comm::MSG_TYPE::CLONE) {
+                return handle_clone(msg_view, replies, user);
             } else if (c_msg_type == comm::MSG_TYPE::RETRIEVE) {
                 return handle_retrieve(msg_view, replies, user);
             } else if (c_msg_type == comm::MSG_TYPE::KEEP_ALIVE) {
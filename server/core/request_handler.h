@@ -23,6 +23,10 @@ class request_handler : private boost::noncopyable {
     boost::filesystem::path backup_root_;
     boost::filesystem::path credentials_path_;
     open_streams streams_;
+    // true if the received files are stored in the user chunk stores
+    bool dedup_;
+    // true if the received files are stored compressed
+    bool compress_;
 
     void handle_auth(communication::tlv_view &msg_view,
                      communication::message_queue &replies,
@@ -33,9 +37,19 @@ class request_handler : private boost::noncopyable {
 
     void handle_create(communication::tlv_view &msg_view,
                        communication::message_queue &replies,
-                       user &user);
+                       user &user,
+                       uint32_t stream_id);
 
     void handle_update(communication::tlv_view &msg_view,
+                       communication::message_queue &replies,
+                       user &user,
+                       uint32_t stream_id);
+
+    void handle_signature(communication::tlv_view &msg_view,
+                          communication::message_queue &replies,
+                          user &user);
+
+    void handle_chunks(communication::tlv_view &msg_view,
                        communication::message_queue &replies,
                        user &user);
 
@@ -43,11 +57,17 @@ class request_handler : private boost::noncopyable {
                       communication::message_queue &replies,
                       user &user);
 
+    void handle_clone(communication::tlv_view &msg_view,
+                      communication::message_queue &replies,
+                      user &user);
+
 public:
     // Handle a request and produce a reply.
     explicit request_handler(
             boost::filesystem::path backup_root,
-            boost::filesystem::path credentials_path
+            boost::filesystem::path credentials_path,
+            bool dedup = false,
+            bool compress = false
     );
 
     void handle_request(
@@ -2,6 +2,7 @@
 #include <boost/thread/thread.hpp>
 #include <boost/bind/bind.hpp>
 #include <vector>
+#include <pthread.h>
 
 namespace fs = boost::filesystem;
 
@@ -19,10 +20,16 @@ server::server(boost::program_options::variables_map const &vm)
           acceptor_{io_},
           ctx_{boost::asio::ssl::context::sslv23}, // set generic ssl/tls version
           new_connection_ptr_{},
-          logger_ptr_{std::make_shared<logger>(vm["logger-file"].as<fs::path>())},
+          logger_ptr_{std::make_shared<logger>(
+                  vm["logger-file"].as<fs::path>(),
+                  static_cast<LOG_LEVEL>(vm["verbosity"].as<unsigned>()),
+                  vm.count("access-log") ? vm["access-log"].as<fs::path>() : fs::path{}
+          )},
           req_handler_ptr_{std::make_shared<request_handler>(
                   vm["backup-root"].as<fs::path>(),
-                  vm["credentials-file"].as<fs::path>()
+                  vm["credentials-file"].as<fs::path>(),
+                  vm["dedup"].as<bool>(),
+                  vm["compress-at-rest"].as<bool>()
           )} {
     // Register to handle the signals that indicate when the server should exit.
     this->signals_.add(SIGINT);
@@ -32,6 +39,13 @@ server::server(boost::program_options::variables_map const &vm)
 #endif // defined(SIGQUIT)
     this->signals_.async_wait(boost::bind(&server::handle_stop, this));
 
+    if (vm["per-core"].as<bool>()) {
+        for (size_t i = 1; i < this->thread_pool_size_; i++) {
+            this->ios_.emplace_back(std::make_unique<boost::asio::io_context>(1));
+            this->work_guards_.emplace_back(boost::asio::make_work_guard(*this->ios_.back()));
+        }
+    }
+
     std::string address = vm["address"].as<std::string>();
     std::string service = vm["service"].as<std::string>();
     // Open the acceptor with the option to reuse the address (i.e. SO_REUSEADDR).
@@ -68,14 +82,41 @@ void server::run() {
     // Create a pool of threads to run all of the io_contexts.
     std::vector<std::thread> threads;
     threads.reserve(this->thread_pool_size_);
-    for (int i = 0; i < this->thread_pool_size_; i++) {
-        threads.emplace_back(boost::bind(&boost::asio::io_context::run, &io_));
+    if (this->ios_.empty()) {
+        for (int i = 0; i < this->thread_pool_size_; i++) {
+            threads.emplace_back(boost::bind(&boost::asio::io_context::run, &io_));
+        }
+    } else {
+        // per-core mode: a thread for each io_context, pinned to a core
+        unsigned cores = std::max(std::thread::hardware_concurrency(), 1U);
+        for (size_t i = 0; i < this->thread_pool_size_; i++) {
+            auto &io = i == 0 ? this->io_ : *this->ios_[i - 1];
+            threads.emplace_back(boost::bind(&boost::asio::io_context::run, &io));
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(i % cores, &cpu_set);
+            if (pthread_setaffinity_np(threads.back().native_handle(), sizeof(cpu_set), &cpu_set) != 0) {
+                std::cerr << "Failed to pin thread " << i << " to core " << i % cores << std::endl;
+            }
+        }
     }
 
     // Wait for all threads in the pool to exit.
     for (auto &t: threads) t.join();
 }
 
+/**
+ * Allow to obtain the io_context on which the next connection has
+ * to be served. In per-core mode the io_contexts are used round-robin.
+ *
+ * @return the io_context for the next connection
+ */
+boost::asio::io_context &server::next_io_context() {
+    if (this->ios_.empty()) return this->io_;
+    size_t index = this->next_io_++ % (this->ios_.size() + 1);
+    return index == 0 ? this->io_ : *this->ios_[index - 1];
+}
+
 /**
  * This method allows to start accept on a new created
  * SSL socket
@@ -84,7 +125,7 @@ void server::run() {
  */
 void server::start_accept() {
     this->new_connection_ptr_.reset(new connection(
-            this->io_,
+            this->next_io_context(),
             this->ctx_,
             this->logger_ptr_,
             this->req_handler_ptr_
@@ -112,4 +153,5 @@ void server::handle_accept(const boost::system::error_code &e) {
 
 void server::handle_stop() {
     this->io_.stop();
+    for (auto &io : this->ios_) io->stop();
 }
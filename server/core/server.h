@@ -4,6 +4,7 @@
 
 #include <string>
 #include <vector>
+#include <utility>
 #include <boost/asio.hpp>
 #include <boost/asio/ssl.hpp>
 #include <boost/noncopyable.hpp>
@@ -16,10 +17,17 @@
  * This class provides an abstraction of the entire
  * backup server. A thread pool is used to manage
  * all incoming connection with an async approach.
+ * In per-core mode each thread runs its own io_context,
+ * pinned to a core, and accepted connections are
+ * distributed round-robin between the io_contexts.
  */
 class server : private boost::noncopyable {
     std::size_t thread_pool_size_;
     boost::asio::io_context io_;
+    // per-core mode io_contexts other than io_, kept running by their work guards
+    std::vector<std::unique_ptr<boost::asio::io_context>> ios_;
+    std::vector<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work_guards_;
+    size_t next_io_ = 0;
     boost::asio::ssl::context ctx_;
     /// The signal_set is used to register for process termination notifications.
     boost::asio::signal_set signals_;
@@ -34,6 +42,8 @@ public:
     void run();
 
 private:
+    boost::asio::io_context &next_io_context();
+
     void start_accept();
     void handle_accept(const boost::system::error_code &e);
     void handle_stop();
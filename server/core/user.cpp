@@ -1,4 +1,13 @@
 #include "user.h"
+#include <atomic>
+
+namespace {
+    std::atomic<uint64_t> next_session_id{1};
+}
+
+user::user() : session_id_{next_session_id++} {}
+
+uint64_t user::session_id() const { return this->session_id_; }
 
 std::string const &user::id() const { return this->id_; }
 
@@ -41,6 +50,24 @@ user &user::synced(bool is_synced) {
     return *this;
 }
 
+communication::DIGEST_TYPE user::digest_type() const {
+    return this->digest_type_;
+}
+
+user &user::digest_type(communication::DIGEST_TYPE digest_type) {
+    this->digest_type_ = digest_type;
+    return *this;
+}
+
+communication::COMPRESSION_TYPE user::compression_type() const {
+    return this->compression_type_;
+}
+
+user &user::compression_type(communication::COMPRESSION_TYPE compression_type) {
+    this->compression_type_ = compression_type;
+    return *this;
+}
+
 std::shared_ptr<directory::dir<directory::s_resource>> user::dir() {
     return this->dir_ptr_;
 }
@@ -49,6 +76,25 @@ user &user::dir(boost::filesystem::path const &absolute_path) {
     this->dir_ptr_ = directory::dir<directory::s_resource>::get_instance(absolute_path);
     return *this;
 }
+
+std::shared_ptr<directory::s_index> user::index() {
+    return this->index_ptr_;
+}
+
+user &user::index(boost::filesystem::path const &index_path) {
+    this->index_ptr_ = directory::s_index::get_instance(index_path);
+    return *this;
+}
+
+std::shared_ptr<directory::chunk_store> user::chunks() {
+    return this->chunks_ptr_;
+}
+
+user &user::chunks(boost::filesystem::path const &store_path, bool compress) {
+    this->chunks_ptr_ = directory::chunk_store::get_instance(store_path, this->dir_ptr_->path(), compress);
+    return *this;
+}
+
 bool user::operator==(user const &other) const {
     return this->id_ == other.id_;
 }
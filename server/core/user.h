@@ -3,18 +3,31 @@
 
 #include "../../shared/directory/dir.h"
 #include "../directory/s_resource.h"
+#include "../directory/s_index.h"
+#include "../directory/chunk_store.h"
+#include "../../shared/communication/types.h"
 
 /*
  * This class is used to
  */
 class user {
+    // id of the session, unique among all the sessions of the server
+    uint64_t session_id_;
     std::string id_;
     std::string username_;
     std::string ip_;
-    bool is_auth_;
-    bool is_synced_;
+    bool is_auth_ = false;
+    bool is_synced_ = false;
+    communication::DIGEST_TYPE digest_type_ = communication::DIGEST_TYPE::DIGEST_MD5;
+    communication::COMPRESSION_TYPE compression_type_ = communication::COMPRESSION_TYPE::COMPRESSION_NONE;
     std::shared_ptr<directory::dir<directory::s_resource>> dir_ptr_;
+    std::shared_ptr<directory::s_index> index_ptr_;
+    std::shared_ptr<directory::chunk_store> chunks_ptr_;
 public:
+    user();
+
+    [[nodiscard]] uint64_t session_id() const;
+
     [[nodiscard]] std::string const &id() const;
 
     user &id(std::string const &id);
@@ -35,9 +48,27 @@ public:
 
     user &synced(bool is_synced);
 
+    [[nodiscard]] communication::DIGEST_TYPE digest_type() const;
+
+    user &digest_type(communication::DIGEST_TYPE digest_type);
+
+    [[nodiscard]] communication::COMPRESSION_TYPE compression_type() const;
+
+    user &compression_type(communication::COMPRESSION_TYPE compression_type);
+
     std::shared_ptr<directory::dir<directory::s_resource>> dir();
 
     user &dir(boost::filesystem::path const &absolute_path);
+
+    std::shared_ptr<directory::s_index> index();
+
+    user &index(boost::filesystem::path const &index_path);
+
+    std::shared_ptr<directory::chunk_store> chunks();
+
+    // the user directory has to be set before
+    user &chunks(boost::filesystem::path const &store_path, bool compress = false);
+
     bool operator==(user const &other) const;
 };
 
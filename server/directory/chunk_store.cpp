@@ -0,0 +1,664 @@
+#include "chunk_store.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <istream>
+#include <sstream>
+#include <sys/xattr.h>
+#include <boost/filesystem/fstream.hpp>
+#include "../../shared/utilities/compression.h"
+
+using namespace directory;
+namespace fs = boost::filesystem;
+
+namespace {
+    char const MAGIC[] = "RBM1MNF";
+    uint8_t const VERSION = 1;
+    size_t const HEADER_SIZE = sizeof(MAGIC) + sizeof(VERSION);
+    size_t const ENTRY_SIZE = cdc::HASH_SIZE + sizeof(uint32_t);
+    // compressed stored files: a header with the file size, the frames and the frame index
+    char const FRAMES_MAGIC[] = "RBM1CMP";
+    uint8_t const FRAMES_VERSION = 1;
+    size_t const FRAMES_HEADER_SIZE = sizeof(FRAMES_MAGIC) + sizeof(FRAMES_VERSION) + sizeof(uint64_t);
+    size_t const FRAME_ENTRY_SIZE = sizeof(uint64_t) + sizeof(uint32_t);
+    size_t const FRAME_SIZE = compression::MAX_SIZE;
+    // extended attribute recording the encoding of stored files and chunks
+    char const ENCODING_ATTRIBUTE[] = "user.remote_backup.encoding";
+
+    template<typename T>
+    void write_value(std::ostream &os, T value) {
+        os.write(reinterpret_cast<char const *>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    bool read_value(std::istream &is, T &value) {
+        return static_cast<bool>(is.read(reinterpret_cast<char *>(&value), sizeof(value)));
+    }
+
+    /*
+     * A stream buffer providing the content of a stored file split in segments,
+     * loading one segment at time through read_segment(). It supports seeking.
+     */
+    class segment_buf : public std::streambuf {
+        std::vector<char> segment_;
+        // offset of the loaded segment and index of the next one
+        uint64_t base_ = 0;
+        size_t next_ = 0;
+
+        bool load(size_t index) {
+            if (!this->read_segment(index, this->segment_) ||
+                this->segment_.size() != this->offsets_[index + 1] - this->offsets_[index]) {
+                this->segment_.clear();
+                this->setg(nullptr, nullptr, nullptr);
+                return false;
+            }
+            this->setg(this->segment_.data(), this->segment_.data(), this->segment_.data() + this->segment_.size());
+            this->base_ = this->offsets_[index];
+            this->next_ = index + 1;
+            return true;
+        }
+
+    protected:
+        // offset of each segment in the file, followed by the file size
+        std::vector<uint64_t> offsets_;
+
+        virtual bool read_segment(size_t index, std::vector<char> &data) = 0;
+
+        int_type underflow() override {
+            if (this->gptr() < this->egptr()) return traits_type::to_int_type(*this->gptr());
+            if (this->next_ + 1 >= this->offsets_.size() || !this->load(this->next_)) return traits_type::eof();
+            return traits_type::to_int_type(*this->gptr());
+        }
+
+        pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+            off_type base;
+            if (dir == std::ios_base::beg) base = 0;
+            else if (dir == std::ios_base::end) base = static_cast<off_type>(this->offsets_.back());
+            else base = static_cast<off_type>(this->base_) + (this->gptr() - this->eback());
+            return this->seekpos(pos_type(base + off), which);
+        }
+
+        pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+            auto position = static_cast<off_type>(pos);
+            if (!(which & std::ios_base::in) || position < 0 ||
+                static_cast<uint64_t>(position) > this->offsets_.back()) {
+                return pos_type(off_type(-1));
+            }
+            if (static_cast<uint64_t>(position) == this->offsets_.back()) {
+                this->setg(this->segment_.data(), this->segment_.data(), this->segment_.data());
+                this->base_ = this->offsets_.back();
+                this->next_ = this->offsets_.size() - 1;
+                return pos;
+            }
+            auto it = std::upper_bound(this->offsets_.cbegin(), this->offsets_.cend(), position);
+            size_t index = std::distance(this->offsets_.cbegin(), it) - 1;
+            if (this->segment_.empty() || this->base_ != this->offsets_[index]) {
+                if (!this->load(index)) return pos_type(off_type(-1));
+            }
+            this->setg(this->eback(), this->eback() + (position - this->base_), this->egptr());
+            return pos;
+        }
+    };
+
+    /*
+     * A stream buffer providing the content of a manifest, one chunk at time
+     */
+    class manifest_buf : public segment_buf {
+        std::shared_ptr<chunk_store const> store_ptr_;
+        std::vector<manifest_entry> entries_;
+
+    protected:
+        bool read_segment(size_t index, std::vector<char> &data) override {
+            return this->store_ptr_->read(this->entries_[index].hash, data);
+        }
+
+    public:
+        manifest_buf(std::shared_ptr<chunk_store const> store_ptr, std::vector<manifest_entry> entries)
+                : store_ptr_{std::move(store_ptr)}, entries_{std::move(entries)} {
+            this->offsets_.reserve(this->entries_.size() + 1);
+            uint64_t offset = 0;
+            for (auto const &entry : this->entries_) {
+                this->offsets_.push_back(offset);
+                offset += entry.length;
+            }
+            this->offsets_.push_back(offset);
+        }
+    };
+
+    /*
+     * A compressed stored file: the file size and the position in the
+     * stored file of each frame, FRAME_SIZE bytes of the file content
+     */
+    struct frames {
+        uint64_t size;
+        std::vector<std::pair<uint64_t, uint32_t>> entries;
+    };
+
+    /**
+     * Allow to read the header and the frame index of a compressed stored file
+     *
+     * @param is the stored file stream
+     * @param path the stored file path
+     * @return an std::optional containing the frames, or std::nullopt if the file is not compressed
+     */
+    std::optional<frames> read_frames(std::istream &is, fs::path const &path) {
+        char magic[sizeof(FRAMES_MAGIC)];
+        uint8_t version;
+        frames f{};
+        if (!is.read(magic, sizeof(magic)) || std::memcmp(magic, FRAMES_MAGIC, sizeof(FRAMES_MAGIC)) != 0 ||
+            !read_value(is, version) || version != FRAMES_VERSION || !read_value(is, f.size)) {
+            return std::nullopt;
+        }
+        boost::system::error_code ec;
+        auto stored_size = fs::file_size(path, ec);
+        uint64_t count = (f.size + FRAME_SIZE - 1) / FRAME_SIZE;
+        if (ec || stored_size < FRAMES_HEADER_SIZE || (stored_size - FRAMES_HEADER_SIZE) / FRAME_ENTRY_SIZE < count) {
+            return std::nullopt;
+        }
+        uint64_t index_offset = stored_size - count * FRAME_ENTRY_SIZE;
+        is.seekg(static_cast<std::streamoff>(index_offset));
+        f.entries.resize(count);
+        for (auto &[offset, length] : f.entries) {
+            if (!read_value(is, offset) || !read_value(is, length) || length > FRAME_SIZE ||
+                offset < FRAMES_HEADER_SIZE || offset + length > index_offset) {
+                return std::nullopt;
+            }
+        }
+        return f;
+    }
+
+    /**
+     * Allow to write a frame of a compressed stored file. The frame is
+     * kept as it is if it doesn't shrink.
+     *
+     * @param data a pointer to the frame data
+     * @param length the frame data length
+     * @param os the compressed stored file stream
+     * @return the stored frame length
+     */
+    uint32_t write_frame(uint8_t const *data, size_t length, std::ostream &os) {
+        static thread_local std::vector<uint8_t> compressed(FRAME_SIZE);
+        size_t compressed_length = 0;
+        if (compression::compressible(data, length)) {
+            compressed_length = compression::compress(
+                    communication::COMPRESSION_TYPE::COMPRESSION_ZLIB, data, length, compressed.data(), length - 1
+            );
+        }
+        if (compressed_length == 0) {
+            os.write(reinterpret_cast<char const *>(data), static_cast<std::streamsize>(length));
+            return length;
+        }
+        os.write(reinterpret_cast<char const *>(compressed.data()), static_cast<std::streamsize>(compressed_length));
+        return compressed_length;
+    }
+
+    /**
+     * Allow to write the index at the end of a compressed stored file
+     *
+     * @param entries the position in the stored file of each frame
+     * @param os the compressed stored file stream
+     * @return void
+     */
+    void write_index(std::vector<std::pair<uint64_t, uint32_t>> const &entries, std::ostream &os) {
+        for (auto const &[offset, length] : entries) {
+            write_value(os, offset);
+            write_value(os, length);
+        }
+    }
+
+    /*
+     * A stream buffer providing the content of a compressed stored file, decompressing
+     * one frame at time. A frame is stored uncompressed if it is as long as its content.
+     */
+    class frame_buf : public segment_buf {
+        fs::ifstream ifs_;
+        std::vector<std::pair<uint64_t, uint32_t>> entries_;
+        std::vector<uint8_t> frame_;
+
+    protected:
+        bool read_segment(size_t index, std::vector<char> &data) override {
+            auto [offset, length] = this->entries_[index];
+            this->frame_.resize(length);
+            this->ifs_.clear();
+            this->ifs_.seekg(static_cast<std::streamoff>(offset));
+            if (!this->ifs_.read(reinterpret_cast<char *>(this->frame_.data()), length)) return false;
+            if (length == this->offsets_[index + 1] - this->offsets_[index]) {
+                data.assign(this->frame_.cbegin(), this->frame_.cend());
+                return true;
+            }
+            return compression::decompress(
+                    communication::COMPRESSION_TYPE::COMPRESSION_ZLIB, this->frame_.data(), length, data
+            );
+        }
+
+    public:
+        frame_buf(fs::path const &path, frames f)
+                : ifs_{path, std::ios_base::binary}, entries_{std::move(f.entries)} {
+            this->offsets_.reserve(this->entries_.size() + 1);
+            for (uint64_t offset = 0; offset < f.size; offset += FRAME_SIZE) this->offsets_.push_back(offset);
+            this->offsets_.push_back(f.size);
+        }
+    };
+
+    /*
+     * An input stream over a stream buffer it owns
+     */
+    template<typename B>
+    class owning_istream : public std::istream {
+        B buf_;
+    public:
+        template<typename... A>
+        explicit owning_istream(A &&... args) : std::istream{nullptr}, buf_{std::forward<A>(args)...} {
+            this->rdbuf(&this->buf_);
+        }
+    };
+}
+
+/**
+ * Construct a chunk_store instance for a given store directory
+ *
+ * @param path the store directory path
+ * @param dir_path the path of the user directory whose files refer to the store
+ * @param compress true if the chunks have to be stored compressed
+ * @return a new constructed chunk_store instance
+ */
+chunk_store::chunk_store(fs::path path, fs::path dir_path, bool compress)
+        : path_{std::move(path)}, dir_path_{std::move(dir_path)}, compress_{compress} {}
+
+/**
+ * Provide the chunk_store instance std::shared_ptr associated with a given store
+ * directory. The same instance is returned as long as someone is using it.
+ *
+ * @param path the store directory path
+ * @param dir_path the path of the user directory whose files refer to the store
+ * @param compress true if the chunks have to be stored compressed
+ * @return the chunk_store instance std::shared_ptr
+ */
+std::shared_ptr<chunk_store> chunk_store::get_instance(
+        fs::path const &path,
+        fs::path const &dir_path,
+        bool compress
+) {
+    static std::unordered_map<fs::path, std::weak_ptr<chunk_store>> instances;
+    static std::mutex m;
+    std::unique_lock ul{m};
+    auto &instance = instances[path];
+    auto instance_ptr = instance.lock();
+    if (!instance_ptr) {
+        instance_ptr = std::shared_ptr<chunk_store>(new chunk_store{path, dir_path, compress});
+        instance = instance_ptr;
+    }
+    return instance_ptr;
+}
+
+/**
+ * Allow to count the references to the stored chunks, reading all the
+ * manifests of the user directory. The chunks that are not referenced
+ * (e.g. written before a crash) are removed. It has to be called
+ * holding the store lock.
+ *
+ * @return void
+ */
+void chunk_store::load() {
+    if (this->loaded_) return;
+    boost::system::error_code ec;
+    if (fs::is_directory(this->dir_path_, ec)) {
+        for (fs::recursive_directory_iterator it{this->dir_path_, ec}, end; !ec && it != end; it.increment(ec)) {
+            // partially written files are not referring to the store yet
+            boost::system::error_code file_ec;
+            if (!fs::is_regular_file(it->path(), file_ec) || it->path().extension() == ".temp") continue;
+            auto entries = read_manifest(it->path());
+            if (!entries) continue;
+            for (auto const &entry : entries.value()) this->refs_[cdc::to_hex(entry.hash)]++;
+        }
+    }
+    if (fs::is_directory(this->path_, ec)) {
+        std::vector<fs::path> unreferenced;
+        for (fs::recursive_directory_iterator it{this->path_, ec}, end; !ec && it != end; it.increment(ec)) {
+            boost::system::error_code file_ec;
+            if (fs::is_regular_file(it->path(), file_ec) && !this->refs_.count(it->path().filename().string())) {
+                unreferenced.push_back(it->path());
+            }
+        }
+        for (auto const &path : unreferenced) fs::remove(path, ec);
+    }
+    this->loaded_ = true;
+}
+
+/**
+ * Allow to obtain the path of a chunk. Chunks are spread over
+ * subdirectories named after the first byte of their hash.
+ *
+ * @param hex the chunk hash hex representation
+ * @return the chunk path
+ */
+fs::path chunk_store::chunk_path(std::string const &hex) const {
+    return this->path_ / hex.substr(0, 2) / hex;
+}
+
+/**
+ * Allow to add a reference to a chunk, writing it if it is not already stored
+ *
+ * @param hash the chunk hash
+ * @param data a pointer to the chunk data
+ * @param length the chunk length
+ * @return true if the chunk is stored, false otherwise
+ */
+bool chunk_store::add(cdc::hash_type const &hash, uint8_t const *data, size_t length) {
+    std::unique_lock ul{this->m_};
+    this->load();
+    std::string hex = cdc::to_hex(hash);
+    auto it = this->refs_.find(hex);
+    if (it != this->refs_.end()) {
+        it->second++;
+        return true;
+    }
+    fs::path path = this->chunk_path(hex);
+    fs::path temp_path{path};
+    temp_path += ".temp";
+    boost::system::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    if (ec) return false;
+    // a leftover temporary file may still have an encoding attribute, that truncating it doesn't drop
+    fs::remove(temp_path, ec);
+    fs::ofstream ofs{temp_path, std::ios_base::binary | std::ios_base::trunc};
+    // a chunk is a single frame, so a compressed chunk is kept only if its frame shrinks
+    std::ostringstream frame;
+    if (this->compress_ && write_frame(data, length, frame) < length &&
+        set_encoding(temp_path, ENCODING::COMPRESSED)) {
+        ofs.write(FRAMES_MAGIC, sizeof(FRAMES_MAGIC));
+        write_value(ofs, FRAMES_VERSION);
+        write_value(ofs, static_cast<uint64_t>(length));
+        std::string const compressed = frame.str();
+        ofs.write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+        write_index({{FRAMES_HEADER_SIZE, static_cast<uint32_t>(compressed.size())}}, ofs);
+    } else ofs.write(reinterpret_cast<char const *>(data), static_cast<std::streamsize>(length));
+    ofs.close();
+    if (ofs) fs::rename(temp_path, path, ec);
+    if (!ofs || ec) {
+        fs::remove(temp_path, ec);
+        return false;
+    }
+    this->refs_.emplace(hex, 1);
+    return true;
+}
+
+/**
+ * Allow to read a manifest
+ *
+ * @param path the path of the stored file
+ * @return an std::optional containing the manifest entries, or std::nullopt if the file is not a manifest
+ */
+std::optional<std::vector<manifest_entry>> chunk_store::read_manifest(fs::path const &path) {
+    if (encoding(path) != ENCODING::MANIFEST) return std::nullopt;
+    fs::ifstream ifs{path, std::ios_base::binary};
+    char magic[sizeof(MAGIC)];
+    uint8_t version;
+    if (!ifs.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        !read_value(ifs, version) || version != VERSION) {
+        return std::nullopt;
+    }
+    boost::system::error_code ec;
+    auto size = fs::file_size(path, ec);
+    if (ec || (size - HEADER_SIZE) % ENTRY_SIZE != 0) return std::nullopt;
+    std::vector<manifest_entry> entries((size - HEADER_SIZE) / ENTRY_SIZE);
+    for (auto &entry : entries) {
+        if (!ifs.read(reinterpret_cast<char *>(entry.hash.data()), cdc::HASH_SIZE) ||
+            !read_value(ifs, entry.length) || entry.length == 0 || entry.length > cdc::MAX_SIZE) {
+            return std::nullopt;
+        }
+    }
+    return entries;
+}
+
+/**
+ * Allow to obtain the encoding of a stored file or a chunk,
+ * recorded in its extended attributes
+ *
+ * @param path the path of the stored file or the chunk
+ * @return the file encoding: a file without the encoding attribute is a plain file
+ */
+ENCODING chunk_store::encoding(fs::path const &path) {
+    uint8_t value;
+    if (getxattr(path.c_str(), ENCODING_ATTRIBUTE, &value, sizeof(value)) != sizeof(value) ||
+        value > static_cast<uint8_t>(ENCODING::COMPRESSED)) {
+        return ENCODING::PLAIN;
+    }
+    return static_cast<ENCODING>(value);
+}
+
+/**
+ * Allow to record the encoding of a stored file or a chunk in its extended attributes
+ *
+ * @param path the path of the stored file or the chunk
+ * @param encoding the file encoding
+ * @return true if the encoding has been recorded, false otherwise
+ */
+bool chunk_store::set_encoding(fs::path const &path, ENCODING encoding) {
+    if (encoding == ENCODING::PLAIN) {
+        return removexattr(path.c_str(), ENCODING_ATTRIBUTE) == 0 || errno == ENODATA || errno == ENOTSUP;
+    }
+    auto value = static_cast<uint8_t>(encoding);
+    return setxattr(path.c_str(), ENCODING_ATTRIBUTE, &value, sizeof(value), 0) == 0;
+}
+
+/**
+ * Allow to check if a stored file is a manifest or a compressed file,
+ * whose content has to be read through open()
+ *
+ * @param path the path of the stored file
+ * @return true if the stored file is not a plain file, false otherwise
+ */
+bool chunk_store::encoded(fs::path const &path) {
+    return encoding(path) != ENCODING::PLAIN;
+}
+
+/**
+ * Allow to open a stored file, either a manifest, a compressed file or a plain file.
+ * The content of a compressed file is decompressed while it is read.
+ *
+ * @param path the path of the stored file
+ * @return an input stream providing the file content
+ */
+std::unique_ptr<std::istream> chunk_store::open(fs::path const &path) const {
+    auto encoding = chunk_store::encoding(path);
+    if (encoding == ENCODING::MANIFEST) {
+        auto entries = read_manifest(path);
+        if (entries) {
+            return std::make_unique<owning_istream<manifest_buf>>(this->shared_from_this(), std::move(entries.value()));
+        }
+    }
+    auto ifs_ptr = std::make_unique<fs::ifstream>(path, std::ios_base::binary);
+    if (encoding == ENCODING::PLAIN) return ifs_ptr;
+    auto f = encoding == ENCODING::COMPRESSED ? read_frames(*ifs_ptr, path) : std::nullopt;
+    if (f) return std::make_unique<owning_istream<frame_buf>>(path, std::move(f.value()));
+    // a damaged encoded file provides no content
+    ifs_ptr->setstate(std::ios_base::badbit);
+    return ifs_ptr;
+}
+
+/**
+ * Allow to check if a chunk is stored
+ *
+ * @param hash the chunk hash
+ * @return true if the chunk is stored, false otherwise
+ */
+bool chunk_store::contains(cdc::hash_type const &hash) {
+    std::unique_lock ul{this->m_};
+    this->load();
+    return this->refs_.count(cdc::to_hex(hash)) > 0;
+}
+
+/**
+ * Allow to read a stored chunk
+ *
+ * @param hash the chunk hash
+ * @param data the vector the chunk data is assigned to
+ * @return true if the chunk has been read, false otherwise
+ */
+bool chunk_store::read(cdc::hash_type const &hash, std::vector<char> &data) const {
+    fs::path path = this->chunk_path(cdc::to_hex(hash));
+    fs::ifstream ifs{path, std::ios_base::binary};
+    if (!ifs) return false;
+    if (encoding(path) == ENCODING::COMPRESSED) {
+        auto f = read_frames(ifs, path);
+        if (!f || f->size > cdc::MAX_SIZE) return false;
+        frame_buf buf{path, std::move(f.value())};
+        data.resize(f->size);
+        return buf.sgetn(data.data(), static_cast<std::streamsize>(data.size())) == static_cast<std::streamsize>(data.size());
+    }
+    ifs.seekg(0, std::ios_base::end);
+    auto length = static_cast<std::streamoff>(ifs.tellg());
+    if (length < 0 || static_cast<size_t>(length) > cdc::MAX_SIZE) return false;
+    ifs.seekg(0, std::ios_base::beg);
+    data.resize(length);
+    return static_cast<bool>(ifs.read(data.data(), length));
+}
+
+/**
+ * Allow to replace a plain stored file with its manifest, adding its chunks
+ * to the store. Files smaller than a chunk are left as they are.
+ *
+ * @param path the path of the stored file
+ * @return true if the file has been replaced or left as it is, false if an error occurred
+ */
+bool chunk_store::store(fs::path const &path) {
+    boost::system::error_code ec;
+    auto size = fs::file_size(path, ec);
+    if (ec) return false;
+    if (size < cdc::MIN_SIZE) return true;
+
+    std::vector<manifest_entry> entries;
+    fs::ifstream ifs{path, std::ios_base::binary};
+    cdc::chunker chunker{ifs};
+    uint8_t const *data;
+    size_t length;
+    bool stored = static_cast<bool>(ifs);
+    while (stored && chunker.next(data, length)) {
+        auto hash = cdc::chunk_hash(data, length);
+        stored = this->add(hash, data, length);
+        if (stored) entries.push_back(manifest_entry{hash, static_cast<uint32_t>(length)});
+    }
+    stored = stored && !ifs.bad();
+    ifs.close();
+
+    if (stored) {
+        fs::path manifest_path{path};
+        manifest_path += ".manifest.temp";
+        fs::remove(manifest_path, ec);
+        fs::ofstream ofs{manifest_path, std::ios_base::binary | std::ios_base::trunc};
+        ofs.write(MAGIC, sizeof(MAGIC));
+        write_value(ofs, VERSION);
+        for (auto const &entry : entries) {
+            ofs.write(reinterpret_cast<char const *>(entry.hash.data()), cdc::HASH_SIZE);
+            write_value(ofs, entry.length);
+        }
+        ofs.close();
+        // the encoding is recorded before the manifest replaces the file, so it is never read as plain data
+        stored = static_cast<bool>(ofs) && set_encoding(manifest_path, ENCODING::MANIFEST);
+        if (stored) fs::rename(manifest_path, path, ec);
+        if (!stored || ec) {
+            stored = false;
+            fs::remove(manifest_path, ec);
+        }
+    }
+    // the chunks added for a file that is not replaced are not referenced
+    if (!stored) this->release(entries);
+    return stored;
+}
+
+/**
+ * Allow to replace a plain stored file with its compressed version, made of
+ * frames that can be decompressed independently, so that it can be read from
+ * any position. Manifests, already compressed files and files that don't
+ * shrink are left as they are.
+ *
+ * @param path the path of the stored file
+ * @return true if the file has been replaced or left as it is, false if an error occurred
+ */
+bool chunk_store::compress(fs::path const &path) {
+    boost::system::error_code ec;
+    auto size = fs::file_size(path, ec);
+    if (ec) return false;
+    if (size < compression::MIN_SIZE || encoded(path)) return true;
+
+    fs::path compressed_path{path};
+    compressed_path += ".compressed.temp";
+    fs::remove(compressed_path, ec);
+    fs::ifstream ifs{path, std::ios_base::binary};
+    fs::ofstream ofs{compressed_path, std::ios_base::binary | std::ios_base::trunc};
+    ofs.write(FRAMES_MAGIC, sizeof(FRAMES_MAGIC));
+    write_value(ofs, FRAMES_VERSION);
+    write_value(ofs, static_cast<uint64_t>(size));
+    std::vector<std::pair<uint64_t, uint32_t>> entries;
+    entries.reserve((size + FRAME_SIZE - 1) / FRAME_SIZE);
+    std::vector<uint8_t> frame(FRAME_SIZE);
+    uint64_t offset = FRAMES_HEADER_SIZE;
+    uint64_t remaining = size;
+    while (remaining > 0 && ifs && ofs) {
+        size_t length = std::min<uint64_t>(remaining, FRAME_SIZE);
+        if (!ifs.read(reinterpret_cast<char *>(frame.data()), static_cast<std::streamsize>(length))) break;
+        uint32_t stored_length = write_frame(frame.data(), length, ofs);
+        entries.emplace_back(offset, stored_length);
+        offset += stored_length;
+        remaining -= length;
+    }
+    ifs.close();
+    write_index(entries, ofs);
+    ofs.close();
+
+    bool compressed = remaining == 0 && static_cast<bool>(ofs) && set_encoding(compressed_path, ENCODING::COMPRESSED);
+    // the file is replaced only if it actually shrinks
+    bool shrunk = compressed && offset + entries.size() * FRAME_ENTRY_SIZE < size;
+    if (shrunk) fs::rename(compressed_path, path, ec);
+    if (!shrunk || ec) fs::remove(compressed_path, ec);
+    return compressed && !ec;
+}
+
+/**
+ * Allow to add the references of a copied manifest to its chunks.
+ * The chunks that are not referenced anymore are not removed until
+ * the next sweep(), so they can be referenced again in the meantime.
+ *
+ * @param entries the manifest entries
+ * @return void
+ */
+void chunk_store::retain(std::vector<manifest_entry> const &entries) {
+    std::unique_lock ul{this->m_};
+    this->load();
+    for (auto const &entry : entries) this->refs_[cdc::to_hex(entry.hash)]++;
+}
+
+/**
+ * Allow to remove the references of a manifest to its chunks.
+ * It has to be called once the manifest has been removed or replaced.
+ *
+ * @param entries the manifest entries
+ * @return void
+ */
+void chunk_store::release(std::vector<manifest_entry> const &entries) {
+    std::unique_lock ul{this->m_};
+    this->load();
+    for (auto const &entry : entries) {
+        std::string hex = cdc::to_hex(entry.hash);
+        auto it = this->refs_.find(hex);
+        if (it != this->refs_.end() && it->second > 0 && --it->second == 0) this->orphans_.insert(hex);
+    }
+}
+
+/**
+ * Allow to remove the chunks that are not referenced anymore
+ *
+ * @return void
+ */
+void chunk_store::sweep() {
+    std::unique_lock ul{this->m_};
+    boost::system::error_code ec;
+    for (auto const &hex : this->orphans_) {
+        auto it = this->refs_.find(hex);
+        if (it == this->refs_.end() || it->second > 0) continue;
+        fs::remove(this->chunk_path(hex), ec);
+        this->refs_.erase(it);
+    }
+    this->orphans_.clear();
+}
@@ -0,0 +1,105 @@
+#ifndef REMOTE_BACKUP_M1_SERVER_CHUNK_STORE_H
+#define REMOTE_BACKUP_M1_SERVER_CHUNK_STORE_H
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include "../../shared/directory/dir.h"
+#include "../../shared/utilities/cdc.h"
+
+namespace directory {
+    /*
+     * A chunk of a stored file: its hash and its length
+     */
+    struct manifest_entry {
+        cdc::hash_type hash;
+        uint32_t length;
+    };
+
+    /*
+     * The way a stored file or a chunk is kept on disk. It is recorded in an
+     * extended attribute of the file, never inferred from the file content.
+     */
+    enum class ENCODING : uint8_t {
+        PLAIN = 0,
+        MANIFEST = 1,
+        COMPRESSED = 2
+    };
+
+    /*
+     * This class provides a content-addressed store of the chunks of the
+     * files of a user. A stored file can be replaced by a manifest, the list
+     * of its content-defined chunks, whose data is kept once in the store
+     * however many files contain it. Each chunk is a file named after its
+     * hash and the store keeps track of the manifests referring to it: chunks
+     * no more referenced are removed by sweep(), so that the files erased and
+     * created again (e.g. moved) in the meantime can still use them.
+     * Stored files can also be compressed at rest by compress(), split in
+     * frames compressed independently and followed by their index, and the
+     * chunks are compressed in the same way if the store is set up to.
+     * Stored files are read through open(), which accepts manifests,
+     * compressed and plain files, decompressing one frame at time while
+     * reading. The encoding of a file is recorded in one of its extended
+     * attributes, so that a user file whose content looks like a manifest
+     * or a compressed file is still handled as a plain file. A single instance exists for each store directory, shared
+     * between all the user sessions.
+     */
+    class chunk_store : public std::enable_shared_from_this<chunk_store> {
+        boost::filesystem::path path_;
+        boost::filesystem::path dir_path_;
+        // chunk hash (hex) -> number of manifest entries referring to the chunk
+        std::unordered_map<std::string, size_t> refs_;
+        // chunks that are not referenced anymore
+        std::unordered_set<std::string> orphans_;
+        // true if the chunks are stored compressed
+        bool compress_;
+        bool loaded_ = false;
+        std::mutex m_;
+
+        chunk_store(boost::filesystem::path path, boost::filesystem::path dir_path, bool compress);
+
+        void load();
+
+        [[nodiscard]] boost::filesystem::path chunk_path(std::string const &hex) const;
+
+        bool add(cdc::hash_type const &hash, uint8_t const *data, size_t length);
+
+    public:
+        static std::shared_ptr<chunk_store> get_instance(
+                boost::filesystem::path const &path,
+                boost::filesystem::path const &dir_path,
+                bool compress = false
+        );
+
+        static std::optional<std::vector<manifest_entry>> read_manifest(boost::filesystem::path const &path);
+
+        static ENCODING encoding(boost::filesystem::path const &path);
+
+        static bool set_encoding(boost::filesystem::path const &path, ENCODING encoding);
+
+        static bool encoded(boost::filesystem::path const &path);
+
+        std::unique_ptr<std::istream> open(boost::filesystem::path const &path) const;
+
+        bool contains(cdc::hash_type const &hash);
+
+        bool read(cdc::hash_type const &hash, std::vector<char> &data) const;
+
+        bool store(boost::filesystem::path const &path);
+
+        bool compress(boost::filesystem::path const &path);
+
+        void retain(std::vector<manifest_entry> const &entries);
+
+        void release(std::vector<manifest_entry> const &entries);
+
+        void sweep();
+    };
+}
+
+
+#endif //REMOTE_BACKUP_M1_SERVER_CHUNK_STORE_H
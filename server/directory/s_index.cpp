@@ -0,0 +1,195 @@
+#include "s_index.h"
+#include "../../shared/directory/index_log.h"
+
+using namespace directory;
+using namespace index_log;
+namespace fs = boost::filesystem;
+
+namespace {
+    char const MAGIC[] = "RBM1SIX";
+    uint8_t const VERSION = 1;
+}
+
+/**
+ * Construct a s_index instance for a given index file
+ *
+ * @param path the index file path
+ * @return a new constructed s_index instance
+ */
+s_index::s_index(fs::path path) : path_{std::move(path)}, digest_type_{communication::DIGEST_TYPE::DIGEST_MD5} {}
+
+/**
+ * Provide the s_index instance std::shared_ptr associated with a given index
+ * file. The same instance is returned as long as someone is using it.
+ *
+ * @param path the index file path
+ * @return the s_index instance std::shared_ptr
+ */
+std::shared_ptr<s_index> s_index::get_instance(fs::path const &path) {
+    static std::unordered_map<fs::path, std::weak_ptr<s_index>> instances;
+    static std::mutex m;
+    std::unique_lock ul{m};
+    auto &instance = instances[path];
+    auto instance_ptr = instance.lock();
+    if (!instance_ptr) {
+        instance_ptr = std::shared_ptr<s_index>(new s_index{path});
+        instance = instance_ptr;
+    }
+    return instance_ptr;
+}
+
+/**
+ * Allow to read the index content. If the index doesn't exist or has been
+ * built for another digest type, std::nullopt is returned and the index
+ * has to be rebuilt through reset(). A truncated last record, due to an
+ * interrupted write, is dropped.
+ *
+ * @param digest_type the digest type of the requested digests
+ * @return an std::optional containing the relative path -> digest map
+ * or std::nullopt if the index is not valid
+ */
+std::optional<std::unordered_map<fs::path, std::string>> s_index::load(communication::DIGEST_TYPE digest_type) {
+    std::unique_lock ul{this->m_};
+    this->ofs_.close();
+    this->valid_ = false;
+    this->records_ = 0;
+    std::unordered_map<fs::path, std::string> content;
+    fs::ifstream ifs{this->path_, std::ios_base::binary};
+    if (!ifs || !read_header(ifs, MAGIC, VERSION, digest_type)) return std::nullopt;
+
+    std::streamoff valid_length = ifs.tellg();
+    RECORD_TYPE record_type;
+    std::string path, digest;
+    while (read_record(ifs, record_type, path)) {
+        if (record_type == RECORD_TYPE::ERASE) {
+            content.erase(path);
+        } else if (read_digest(ifs, digest)) {
+            content.insert_or_assign(path, digest);
+        } else break;
+        valid_length = ifs.tellg();
+        this->records_++;
+    }
+    ifs.close();
+
+    // the lock is held until the index is open again, so that no record is lost or cut off
+    if (needs_compaction(this->records_, content.size())) {
+        this->reset_locked(digest_type, content);
+    } else {
+        // dropping the truncated tail, if any
+        fs::resize_file(this->path_, valid_length);
+        this->digest_type_ = digest_type;
+        this->open();
+    }
+    return content;
+}
+
+/**
+ * Allow to replace the index content
+ *
+ * @param digest_type the digest type of the provided digests
+ * @param content the relative path -> digest map that has to be stored
+ * @return void
+ */
+void s_index::reset(
+        communication::DIGEST_TYPE digest_type,
+        std::unordered_map<fs::path, std::string> const &content
+) {
+    std::unique_lock ul{this->m_};
+    this->reset_locked(digest_type, content);
+}
+
+/**
+ * Allow to replace the index content. It has to be called holding the index lock.
+ *
+ * @param digest_type the digest type of the provided digests
+ * @param content the relative path -> digest map that has to be stored
+ * @return void
+ */
+void s_index::reset_locked(
+        communication::DIGEST_TYPE digest_type,
+        std::unordered_map<fs::path, std::string> const &content
+) {
+    fs::path temp_path{this->path_};
+    temp_path += ".temp";
+    this->ofs_.close();
+    this->ofs_.open(temp_path, std::ios_base::binary | std::ios_base::trunc);
+    write_header(this->ofs_, MAGIC, VERSION, digest_type);
+    for (auto const &[relative_path, digest] : content) this->write_put(relative_path, digest);
+    this->ofs_.close();
+    fs::rename(temp_path, this->path_);
+    this->digest_type_ = digest_type;
+    this->records_ = content.size();
+    this->open();
+}
+
+/**
+ * Allow to open the index file for appending new records
+ *
+ * @return void
+ */
+void s_index::open() {
+    this->ofs_.open(this->path_, std::ios_base::binary | std::ios_base::app);
+    this->valid_ = static_cast<bool>(this->ofs_);
+}
+
+/**
+ * Allow to drop the index, so that it is rebuilt by the next load().
+ * It has to be called holding the index lock.
+ *
+ * @return void
+ */
+void s_index::invalidate() {
+    this->ofs_.close();
+    this->valid_ = false;
+    boost::system::error_code ec;
+    fs::remove(this->path_, ec);
+}
+
+/**
+ * Allow to write a put record
+ *
+ * @param relative_path the file relative path
+ * @param digest the file digest
+ * @return void
+ */
+void s_index::write_put(fs::path const &relative_path, std::string const &digest) {
+    write_record(this->ofs_, RECORD_TYPE::PUT, relative_path.string());
+    write_digest(this->ofs_, digest);
+}
+
+/**
+ * Allow to store the digest of a file. The record is immediately written
+ * on disk. A digest of another type than the index one can't be stored,
+ * so the index is invalidated.
+ *
+ * @param digest_type the digest type of the session storing the digest
+ * @param relative_path the file relative path
+ * @param digest the file digest
+ * @return void
+ */
+void s_index::put(communication::DIGEST_TYPE digest_type, fs::path const &relative_path, std::string const &digest) {
+    std::unique_lock ul{this->m_};
+    if (!this->valid_) return;
+    if (digest_type != this->digest_type_) return this->invalidate();
+    this->write_put(relative_path, digest);
+    this->ofs_.flush();
+    this->records_++;
+}
+
+/**
+ * Allow to remove a file from the index. The record is immediately written
+ * on disk. The index is invalidated if the session uses another digest
+ * type than the index one, as for put().
+ *
+ * @param digest_type the digest type of the session removing the file
+ * @param relative_path the file relative path
+ * @return void
+ */
+void s_index::erase(communication::DIGEST_TYPE digest_type, fs::path const &relative_path) {
+    std::unique_lock ul{this->m_};
+    if (!this->valid_) return;
+    if (digest_type != this->digest_type_) return this->invalidate();
+    write_record(this->ofs_, RECORD_TYPE::ERASE, relative_path.string());
+    this->ofs_.flush();
+    this->records_++;
+}
@@ -0,0 +1,67 @@
+#ifndef REMOTE_BACKUP_M1_SERVER_INDEX_H
+#define REMOTE_BACKUP_M1_SERVER_INDEX_H
+
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include "../../shared/directory/dir.h"
+#include "../../shared/communication/types.h"
+
+namespace directory {
+    /*
+     * This class provides a persistent index of the files stored
+     * for a user, mapping each relative path to its digest. It allows
+     * to serve LIST requests without reading the stored files. The
+     * index is an append-only log of put and erase records, kept up to
+     * date by the CREATE, UPDATE and ERASE handlers. A single instance
+     * exists for each index file, shared between all the user sessions:
+     * the records of a session that uses another digest type than the
+     * index one invalidate the index, which is rebuilt by the next load.
+     */
+    class s_index {
+        boost::filesystem::path path_;
+        boost::filesystem::ofstream ofs_;
+        communication::DIGEST_TYPE digest_type_;
+        size_t records_ = 0;
+        bool valid_ = false;
+        std::mutex m_;
+
+        explicit s_index(boost::filesystem::path path);
+
+        void open();
+
+        void invalidate();
+
+        void reset_locked(
+                communication::DIGEST_TYPE digest_type,
+                std::unordered_map<boost::filesystem::path, std::string> const &content
+        );
+
+        void write_put(boost::filesystem::path const &relative_path, std::string const &digest);
+
+    public:
+        static std::shared_ptr<s_index> get_instance(boost::filesystem::path const &path);
+
+        std::optional<std::unordered_map<boost::filesystem::path, std::string>> load(
+                communication::DIGEST_TYPE digest_type
+        );
+
+        void reset(
+                communication::DIGEST_TYPE digest_type,
+                std::unordered_map<boost::filesystem::path, std::string> const &content
+        );
+
+        void put(
+                communication::DIGEST_TYPE digest_type,
+                boost::filesystem::path const &relative_path,
+                std::string const &digest
+        );
+
+        void erase(communication::DIGEST_TYPE digest_type, boost::filesystem::path const &relative_path);
+    };
+}
+
+
+#endif //REMOTE_BACKUP_M1_SERVER_INDEX_H
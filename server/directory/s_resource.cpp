@@ -10,7 +10,7 @@ using namespace directory;
  * @return a new constructed resource instance
  */
 s_resource::s_resource(bool synced, std::string digest)
-        : synced_{synced}, digest_{std::move(digest)} {}
+        : synced_{synced}, digest_{digest} {}
 
 /**
 * Setter for synced field.
@@ -39,7 +39,7 @@ s_resource &s_resource::synced(bool const &synced) {
 * @return the resource on which it has been applied
 */
 s_resource &s_resource::digest(std::string digest) {
-    this->digest_ = std::move(digest);
+    this->digest_ = directory::digest{digest};
     return *this;
 }
 
@@ -49,7 +49,17 @@ s_resource &s_resource::digest(std::string digest) {
 * @return the digest field value
 */
 [[nodiscard]] std::string s_resource::digest() const {
-    return this->digest_;
+    return this->digest_.str();
+}
+
+/**
+* Compare the digest field with a digest string representation.
+*
+* @param digest the digest string representation
+* @return true if the digest field value is equal to digest, false otherwise
+*/
+[[nodiscard]] bool s_resource::digest_equals(std::string const &digest) const {
+    return this->digest_ == digest;
 }
 
 std::ostream &directory::operator<<(std::ostream &os, s_resource const &rsrc) {
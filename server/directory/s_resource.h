@@ -4,6 +4,7 @@
 #include <string>
 #include <utility>
 #include <iostream>
+#include "../../shared/directory/digest.h"
 
 /*
  * synced:
@@ -21,7 +22,7 @@ namespace directory {
      */
     class s_resource {
         bool synced_;
-        std::string digest_;
+        directory::digest digest_;
     public:
         s_resource(bool synced, std::string digest);
 
@@ -34,6 +35,8 @@ namespace directory {
         s_resource &digest(std::string digest);
 
         [[nodiscard]] std::string digest() const;
+
+        [[nodiscard]] bool digest_equals(std::string const &digest) const;
     };
 
     std::ostream &operator<<(std::ostream &os, s_resource const &rsrc);
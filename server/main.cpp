@@ -32,9 +32,27 @@ po::variables_map parse_options(int argc, char const *const argv[]) {
                  po::value<fs::path>()->default_value(
                          fs::path{"../files/LOG.txt"}
                  ), "set the logger file path")
+                ("verbosity,V",
+                 po::value<unsigned>()->default_value(1),
+                 "set the logger verbosity (0: nothing, 1: communication results, 2: also message dumps)")
+                ("access-log",
+                 po::value<fs::path>(),
+                 "log communication results as binary records on the given file instead of the logger file")
                 ("threads,T",
                  po::value<size_t>()->default_value(8),
-                 "set worker thread pool size");
+                 "set worker thread pool size")
+                ("per-core",
+                 po::bool_switch()->default_value(false),
+                 "run an io_context for each worker thread, pinned to a core, "
+                 "distributing connections round-robin between them")
+                ("dedup",
+                 po::bool_switch()->default_value(false),
+                 "store the received files as lists of content-defined chunks, "
+                 "keeping a single copy of the chunks shared by the files of a user")
+                ("compress-at-rest",
+                 po::bool_switch()->default_value(false),
+                 "store the received files (and chunks) compressed, "
+                 "in frames that are decompressed while the files are read");
 
         po::variables_map vm;
         po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -90,6 +108,15 @@ po::variables_map parse_options(int argc, char const *const argv[]) {
                       << log_file_path.generic_path().string() << std::endl;
         }
 
+        if (vm["verbosity"].as<unsigned>() > LOG_LEVEL::LOG_MESSAGES) {
+            vm.at("verbosity").value() = static_cast<unsigned>(LOG_LEVEL::LOG_MESSAGES);
+            std::cout << "--verbosity option set to maximum value: "
+                      << vm["verbosity"].as<unsigned>() << std::endl;
+        } else if (vm["verbosity"].defaulted()) {
+            std::cout << "--verbosity option set to default value: "
+                      << vm["verbosity"].as<unsigned>() << std::endl;
+        }
+
         if (vm["threads"].defaulted()) {
             std::cout << "--threads option set to default value: "
                       << vm["threads"].as<size_t>() << std::endl;
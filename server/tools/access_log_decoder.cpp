@@ -0,0 +1,141 @@
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <boost/asio/ip/address_v6.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/program_options.hpp>
+#include "../utilities/access_log.h"
+
+namespace fs = boost::filesystem;
+namespace po = boost::program_options;
+using namespace communication;
+
+/*
+ * This tool decodes a binary access log written by the server
+ * (--access-log option) into text lines or CSV rows.
+ */
+
+po::variables_map parse_options(int argc, char const *const argv[]) {
+    try {
+        po::options_description desc("Access log decoder options");
+        desc.add_options()
+                ("help,h",
+                 "produce help message")
+                ("access-log,AL",
+                 po::value<fs::path>()->required(),
+                 "set the access log file path")
+                ("csv,C",
+                 po::bool_switch()->default_value(false),
+                 "produce CSV rows instead of text lines");
+        po::positional_options_description positional;
+        positional.add("access-log", 1);
+
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(positional).run(), vm);
+
+        if (vm.count("help")) {
+            std::cout << desc << std::endl;
+            std::exit(EXIT_SUCCESS);
+        }
+
+        po::notify(vm);
+        return vm;
+    }
+    catch (std::exception &ex) {
+        std::cout << "Error during options parsing:\n\t" << ex.what() << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/**
+ * Allow to obtain the ISO extended string representation of a UTC time
+ *
+ * @param time_us the time in microseconds since the epoch
+ * @return the time string representation
+ */
+std::string format_time(uint64_t time_us) {
+    std::time_t time = static_cast<std::time_t>(time_us / 1000000);
+    std::tm tm{};
+    gmtime_r(&time, &tm);
+    std::ostringstream oss;
+    oss << std::put_time(&tm, "%Y-%m-%dT%H:%M:%S") << '.'
+        << std::setw(6) << std::setfill('0') << time_us % 1000000;
+    return oss.str();
+}
+
+/**
+ * Allow to obtain the string representation of a record user id
+ *
+ * @param record the access log record
+ * @return the user id hex representation or an empty string if the user was not authenticated
+ */
+std::string format_user_id(access_log::record const &record) {
+    static char const hex_digits[] = "0123456789ABCDEF";
+    std::string id;
+    for (auto byte : record.user_id) {
+        id += hex_digits[byte >> 4];
+        id += hex_digits[byte & 0x0F];
+    }
+    return id.find_first_not_of('0') == std::string::npos ? std::string{} : id;
+}
+
+/**
+ * Allow to obtain the string representation of a record client address
+ *
+ * @param record the access log record
+ * @return the client address string representation
+ */
+std::string format_address(access_log::record const &record) {
+    boost::asio::ip::address_v6::bytes_type bytes;
+    std::copy(std::begin(record.address), std::end(record.address), bytes.begin());
+    boost::asio::ip::address_v6 address{bytes};
+    return address.is_v4_mapped()
+           ? boost::asio::ip::make_address_v4(boost::asio::ip::v4_mapped, address).to_string()
+           : address.to_string();
+}
+
+int main(int argc, char *argv[]) {
+    auto vm = parse_options(argc, argv);
+    auto path = vm["access-log"].as<fs::path>();
+    bool csv = vm["csv"].as<bool>();
+
+    fs::ifstream ifs{path, std::ios_base::binary};
+    if (!ifs) {
+        std::cerr << "Failed to open " << path.generic_path().string() << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!access_log::read_header(ifs)) {
+        std::cerr << path.generic_path().string() << " is not an access log" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (csv) std::cout << "time,user_id,address,msg_type,err_type,conn_res,bytes_in,bytes_out,latency_us\n";
+    access_log::record record{};
+    while (ifs.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+        auto msg_type_str = access_log::msg_type_str(static_cast<MSG_TYPE>(record.msg_type));
+        auto err_type_str = access_log::err_type_str(static_cast<ERR_TYPE>(record.err_type));
+        auto conn_res_str = access_log::conn_res_str(static_cast<CONN_RES>(record.conn_res));
+        std::string user_id = format_user_id(record);
+        if (csv) {
+            std::cout << format_time(record.time_us) << ',' << user_id << ',' << format_address(record) << ','
+                      << msg_type_str << ',' << err_type_str << ',' << conn_res_str << ','
+                      << record.bytes_in << ',' << record.bytes_out << ',' << record.latency_us << '\n';
+        } else {
+            std::cout << '[' << format_time(record.time_us) << "]["
+                      << user_id << (user_id.empty() ? "" : "@") << format_address(record) << "]["
+                      << "TYPE: " << msg_type_str
+                      << " RES: " << err_type_str
+                      << " CONN: " << conn_res_str
+                      << " IN: " << record.bytes_in
+                      << " OUT: " << record.bytes_out
+                      << " LATENCY: " << record.latency_us << "us]\n";
+        }
+    }
+    if (ifs.gcount() != 0) {
+        std::cerr << "Ignored a truncated record at the end of the access log" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
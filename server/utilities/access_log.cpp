@@ -0,0 +1,115 @@
+#include "access_log.h"
+#include <cstring>
+
+using namespace communication;
+
+char const access_log::MAGIC[8] = "RBM1ALG";
+uint8_t const access_log::VERSION = 1;
+
+/**
+ * Allow to obtain the string representation of a message type
+ *
+ * @param msg_type the message type
+ * @return the message type string representation
+ */
+char const *access_log::msg_type_str(MSG_TYPE msg_type) {
+    switch (msg_type) {
+        case NONE: return "-";
+        case CREATE: return "CREATE";
+        case UPDATE: return "UPDATE";
+        case ERASE: return "ERASE";
+        case LIST: return "LIST";
+        case AUTH: return "AUTH";
+        case RETRIEVE: return "RETRIEVE";
+        case KEEP_ALIVE: return "KEEP_ALIVE";
+        case SIGNATURE: return "SIGNATURE";
+        case CHUNKS: return "CHUNKS";
+        case CLONE: return "CLONE";
+        default: return "UNKNOWN";
+    }
+}
+
+/**
+ * Allow to obtain the string representation of an error type
+ *
+ * @param err_type the error type
+ * @return the error type string representation
+ */
+char const *access_log::err_type_str(ERR_TYPE err_type) {
+    switch (err_type) {
+        case ERR_NONE: return "OK";
+        case ERR_NO_CONTENT: return "ERR_NO_CONTENT";
+        case ERR_MSG_TYPE_REJECTED: return "ERR_MSG_TYPE_REJECTED";
+        case ERR_CREATE_NO_ITEM: return "ERR_CREATE_NO_ITEM";
+        case ERR_CREATE_NO_CONTENT: return "ERR_CREATE_NO_CONTENT";
+        case ERR_CREATE_ALREADY_EXIST: return "ERR_CREATE_ALREADY_EXIST";
+        case ERR_CREATE_FAILED: return "ERR_CREATE_FAILED";
+        case ERR_CREATE_NO_MATCH: return "ERR_CREATE_NO_MATCH";
+        case ERR_UPDATE_NO_ITEM: return "ERR_UPDATE_NO_ITEM";
+        case ERR_UPDATE_NO_CONTENT: return "ERR_UPDATE_NO_CONTENT";
+        case ERR_UPDATE_NOT_EXIST: return "ERR_UPDATE_NOT_EXIST";
+        case ERR_UPDATE_ALREADY_UPDATED: return "ERR_UPDATE_ALREADY_UPDATED";
+        case ERR_UPDATE_FAILED: return "ERR_UPDATE_FAILED";
+        case ERR_UPDATE_NO_MATCH: return "ERR_UPDATE_NO_MATCH";
+        case ERR_ERASE_NO_ITEM: return "ERR_ERASE_NO_ITEM";
+        case ERR_ERASE_NO_MATCH: return "ERR_ERASE_NO_MATCH";
+        case ERR_ERASE_FAILED: return "ERR_ERASE_FAILED";
+        case ERR_LIST_FAILED: return "ERR_LIST_FAILED";
+        case ERR_AUTH_NO_USRN: return "ERR_AUTH_NO_USRN";
+        case ERR_AUTH_NO_PSWD: return "ERR_AUTH_NO_PSWD";
+        case ERR_AUTH_FAILED: return "ERR_AUTH_FAILED";
+        case ERR_RETRIEVE_FAILED: return "ERR_RETRIEVE_FAILED";
+        case ERR_SIGNATURE_NO_ITEM: return "ERR_SIGNATURE_NO_ITEM";
+        case ERR_SIGNATURE_NOT_EXIST: return "ERR_SIGNATURE_NOT_EXIST";
+        case ERR_SIGNATURE_FAILED: return "ERR_SIGNATURE_FAILED";
+        case ERR_CHUNKS_NO_ITEM: return "ERR_CHUNKS_NO_ITEM";
+        case ERR_CHUNKS_FAILED: return "ERR_CHUNKS_FAILED";
+        case ERR_CLONE_NO_ITEM: return "ERR_CLONE_NO_ITEM";
+        case ERR_CLONE_NO_SOURCE: return "ERR_CLONE_NO_SOURCE";
+        case ERR_CLONE_NOT_EXIST: return "ERR_CLONE_NOT_EXIST";
+        case ERR_CLONE_ALREADY_EXIST: return "ERR_CLONE_ALREADY_EXIST";
+        case ERR_CLONE_NO_MATCH: return "ERR_CLONE_NO_MATCH";
+        case ERR_CLONE_FAILED: return "ERR_CLONE_FAILED";
+        default: return "UNKNOWN";
+    }
+}
+
+/**
+ * Allow to obtain the string representation of a communication result
+ *
+ * @param conn_res the communication result
+ * @return the communication result string representation
+ */
+char const *access_log::conn_res_str(CONN_RES conn_res) {
+    switch (conn_res) {
+        case CONN_NONE: return "-";
+        case CONN_OK: return "OK";
+        case CONN_ERR: return "ERR";
+        default: return "UNKNOWN";
+    }
+}
+
+/**
+ * Write the access log header on the given stream
+ *
+ * @param os the output stream
+ * @return true if the header has been written, false otherwise
+ */
+bool access_log::write_header(std::ostream &os) {
+    os.write(MAGIC, sizeof(MAGIC));
+    os.write(reinterpret_cast<char const *>(&VERSION), sizeof(VERSION));
+    return static_cast<bool>(os);
+}
+
+/**
+ * Read and check the access log header from the given stream
+ *
+ * @param is the input stream
+ * @return true if a valid header has been read, false otherwise
+ */
+bool access_log::read_header(std::istream &is) {
+    char magic[sizeof(MAGIC)];
+    uint8_t version;
+    return is.read(magic, sizeof(magic)) && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 &&
+           is.read(reinterpret_cast<char *>(&version), sizeof(version)) && version == VERSION;
+}
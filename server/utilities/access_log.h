@@ -0,0 +1,47 @@
+#ifndef REMOTE_BACKUP_M1_SERVER_ACCESS_LOG_H
+#define REMOTE_BACKUP_M1_SERVER_ACCESS_LOG_H
+
+#include <cstdint>
+#include <iostream>
+#include "../../shared/communication/types.h"
+
+/*
+ * The binary access log is made up of an header (the ACCESS_LOG_MAGIC
+ * string followed by a version byte) followed by fixed-size records,
+ * one for each communication result. Values are stored in host byte
+ * order, so the log has to be decoded on a machine with the same
+ * endianness.
+ */
+namespace access_log {
+    extern char const MAGIC[8];
+    extern uint8_t const VERSION;
+
+    /*
+     * A communication result record
+     */
+    struct record {
+        uint64_t time_us;           // UTC time in microseconds since the epoch
+        uint64_t bytes_in;          // request bytes, header included
+        uint64_t bytes_out;         // replies bytes, headers included
+        uint32_t latency_us;        // time elapsed between request receipt and last reply sending
+        uint16_t err_type;          // communication::ERR_TYPE
+        uint8_t msg_type;           // communication::MSG_TYPE
+        uint8_t conn_res;           // communication::CONN_RES
+        uint8_t user_id[16];        // binary user id, all zeros if the user is not authenticated
+        uint8_t address[16];        // client IPv6 address or IPv4-mapped IPv6 address
+    };
+    static_assert(sizeof(record) == 64, "access log records must be 64 bytes long");
+
+    char const *msg_type_str(communication::MSG_TYPE msg_type);
+
+    char const *err_type_str(communication::ERR_TYPE err_type);
+
+    char const *conn_res_str(communication::CONN_RES conn_res);
+
+    bool write_header(std::ostream &os);
+
+    bool read_header(std::istream &is);
+}
+
+
+#endif //REMOTE_BACKUP_M1_SERVER_ACCESS_LOG_H
@@ -1,68 +1,182 @@
 #include "logger.h"
+#include <cstring>
 #include "../../shared/communication/tlv_view.h"
 #include "../../shared/utilities/tools.h"
 
 namespace fs = boost::filesystem;
 using namespace communication;
 
+// number of ring buffer slots, it must be a power of two
+size_t const logger::RING_SIZE = 1 << 14;
+// maximum number of entries written through a single write
+size_t const logger::BATCH_SIZE = 1024;
+
 /**
- * Create a logger instance with a given log file path
+ * Create a logger instance with a given log file path and start its writer thread
  *
  * @param path the path on which the created logger has to log
+ * @param level the logger verbosity level
+ * @param access_log_path the path of the binary access log, empty to log communication results as text
  * @return void
  */
-logger::logger(fs::path const &path) : ofs_{fs::ofstream{path, std::ios_base::app}} {
-    this->msg_type_str_map_ = {
-            {NONE,       "-"},
-            {CREATE,     "CREATE"},
-            {UPDATE,     "UPDATE"},
-            {ERASE,      "ERASE"},
-            {AUTH,       "AUTH"},
-            {KEEP_ALIVE, "KEEP_ALIVE"},
-            {LIST,       "LIST"},
-            {RETRIEVE,   "RETRIEVE"}
-    };
+logger::logger(fs::path const &path, LOG_LEVEL level, fs::path const &access_log_path)
+        : ofs_{fs::ofstream{path, std::ios_base::app}},
+          level_{level},
+          ring_{std::make_unique<slot[]>(RING_SIZE)},
+          now_{std::time(nullptr)} {
+    for (size_t i = 0; i < RING_SIZE; i++) this->ring_[i].seq.store(i, std::memory_order_relaxed);
+
+    if (!access_log_path.empty()) {
+        boost::system::error_code ec;
+        bool is_new = !fs::exists(access_log_path, ec) || fs::file_size(access_log_path, ec) == 0;
+        if (!is_new) {
+            fs::ifstream ifs{access_log_path, std::ios_base::binary};
+            if (!access_log::read_header(ifs)) {
+                std::cerr << access_log_path.generic_path().string() << " is not an access log" << std::endl;
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        this->access_ofs_.open(access_log_path, std::ios_base::binary | std::ios_base::app);
+        if (!this->access_ofs_ || (is_new && !access_log::write_header(this->access_ofs_))) {
+            std::cerr << "Failed to open " << access_log_path.generic_path().string() << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+        this->access_ofs_.flush();
+    }
 
     this->tlv_type_str_map_ = {
-            {USRN,    "USRN"},
-            {PSWD,    "PSWD"},
-            {ITEM,    "ITEM"},
-            {END,     "END"},
-            {OK,      "OK"},
-            {ERROR,   "ERROR"},
-            {CONTENT, "CONTENT"}
+            {USRN,        "USRN"},
+            {PSWD,        "PSWD"},
+            {ITEM,        "ITEM"},
+            {END,         "END"},
+            {OK,          "OK"},
+            {ERROR,       "ERROR"},
+            {CONTENT,     "CONTENT"},
+            {DIGEST,      "DIGEST"},
+            {STREAM,      "STREAM"},
+            {BLOCK_SIZE,  "BLOCK_SIZE"},
+            {BLOCKS,      "BLOCKS"},
+            {COPY,        "COPY"},
+            {HASHES,      "HASHES"},
+            {MISSING,     "MISSING"},
+            {CHUNK,       "CHUNK"},
+            {SOURCE,      "SOURCE"},
+            {COMPRESSION, "COMPRESSION"},
+            {ZCONTENT,    "ZCONTENT"}
     };
 
-    this->err_type_str_map_ = {
-            {ERR_NONE,                   "OK"},
-            {ERR_NO_CONTENT,             "ERR_NO_CONTENT"},
-            {ERR_MSG_TYPE_REJECTED,      "ERR_MSG_TYPE_REJECTED"},
-            {ERR_CREATE_NO_ITEM,         "ERR_CREATE_NO_ITEM"},
-            {ERR_CREATE_NO_CONTENT,      "ERR_CREATE_NO_CONTENT"},
-            {ERR_CREATE_ALREADY_EXIST,   "ERR_CREATE_ALREADY_EXIST"},
-            {ERR_CREATE_FAILED,          "ERR_CREATE_FAILED"},
-            {ERR_CREATE_NO_MATCH,        "ERR_CREATE_NO_MATCH"},
-            {ERR_UPDATE_NO_ITEM,         "ERR_UPDATE_NO_ITEM"},
-            {ERR_UPDATE_NO_CONTENT,      "ERR_UPDATE_NO_CONTENT"},
-            {ERR_UPDATE_NOT_EXIST,       "ERR_UPDATE_NOT_EXIST"},
-            {ERR_UPDATE_ALREADY_UPDATED, "ERR_UPDATE_ALREADY_UPDATED"},
-            {ERR_UPDATE_FAILED,          "ERR_UPDATE_FAILED"},
-            {ERR_UPDATE_NO_MATCH,        "ERR_UPDATE_NO_MATCH"},
-            {ERR_ERASE_NO_ITEM,          "ERR_ERASE_NO_ITEM"},
-            {ERR_ERASE_NO_MATCH,         "ERR_ERASE_NO_MATCH"},
-            {ERR_ERASE_FAILED,           "ERR_ERASE_FAILED"},
-            {ERR_LIST_FAILED,            "ERR_LIST_FAILED"},
-            {ERR_AUTH_NO_USRN,           "ERR_AUTH_NO_USRN"},
-            {ERR_AUTH_NO_PSWD,           "ERR_AUTH_NO_PSWD"},
-            {ERR_AUTH_FAILED,            "ERR_AUTH_FAILED"},
-            {ERR_RETRIEVE_FAILED,        "ERR_RETRIEVE_FAILED"}
-    };
+    this->writer_ = std::thread{&logger::write, this};
+}
 
-    this->conn_res_str_map_ = {
-            {CONN_NONE, "-"},
-            {CONN_OK,   "OK"},
-            {CONN_ERR,  "ERR"}
-    };
+/**
+ * Stop the writer thread after all pending entries have been written
+ */
+logger::~logger() {
+    this->stopped_.store(true, std::memory_order_release);
+    if (this->writer_.joinable()) this->writer_.join();
+    this->ofs_.close();
+    if (this->access_ofs_.is_open()) this->access_ofs_.close();
+}
+
+/**
+ * Allow to push an entry into the ring buffer without blocking
+ *
+ * @param e the entry that has to be pushed
+ * @return true if the entry has been pushed, false if the ring buffer is full
+ */
+bool logger::push(entry &&e) {
+    size_t pos = this->head_.load(std::memory_order_relaxed);
+    for (;;) {
+        slot &s = this->ring_[pos & (RING_SIZE - 1)];
+        size_t seq = s.seq.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0) {
+            if (this->head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                s.value = std::move(e);
+                s.seq.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            this->dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else pos = this->head_.load(std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Allow the writer thread to pop the oldest entry from the ring buffer
+ *
+ * @param e the entry in which the popped one has to be moved
+ * @return true if an entry has been popped, false if the ring buffer is empty
+ */
+bool logger::pop(entry &e) {
+    slot &s = this->ring_[this->tail_ & (RING_SIZE - 1)];
+    if (s.seq.load(std::memory_order_acquire) != this->tail_ + 1) return false;
+    e = std::move(s.value);
+    s.seq.store(this->tail_ + RING_SIZE, std::memory_order_release);
+    this->tail_++;
+    return true;
+}
+
+/**
+ * Writer thread body: it refreshes the coarse clock and writes the pending
+ * entries in batches until the logger is destroyed
+ *
+ * @return void
+ */
+void logger::write() {
+    std::string file_batch;
+    std::string stdout_batch;
+    std::string access_batch;
+    std::time_t formatted_time = -1;
+    std::string time_str;
+    entry e;
+    for (;;) {
+        std::time_t now = std::time(nullptr);
+        this->now_.store(now, std::memory_order_relaxed);
+        bool stopped = this->stopped_.load(std::memory_order_acquire);
+        size_t popped = 0;
+        while (popped < BATCH_SIZE && this->pop(e)) {
+            popped++;
+            if (e.sink == entry::STDOUT) {
+                stdout_batch += e.text;
+                continue;
+            }
+            if (e.sink == entry::ACCESS_LOG) {
+                access_batch.append(reinterpret_cast<char const *>(&e.record), sizeof(e.record));
+                continue;
+            }
+            // entries are mostly ordered by time, so the formatted time is rarely rebuilt
+            if (e.time != formatted_time) {
+                formatted_time = e.time;
+                time_str = logger::get_time(e.time);
+            }
+            file_batch.append(1, '[').append(time_str).append(1, ']').append(e.text);
+        }
+        if (size_t dropped = this->dropped_.exchange(0, std::memory_order_relaxed)) {
+            file_batch.append(1, '[').append(logger::get_time(now)).append("][-][")
+                    .append(std::to_string(dropped)).append(" log entries dropped]\n");
+        }
+        if (!file_batch.empty()) {
+            this->ofs_.write(file_batch.data(), static_cast<std::streamsize>(file_batch.size()));
+            this->ofs_.flush();
+            file_batch.clear();
+        }
+        if (!access_batch.empty()) {
+            this->access_ofs_.write(access_batch.data(), static_cast<std::streamsize>(access_batch.size()));
+            this->access_ofs_.flush();
+            access_batch.clear();
+        }
+        if (!stdout_batch.empty()) {
+            std::cout.write(stdout_batch.data(), static_cast<std::streamsize>(stdout_batch.size()));
+            std::cout.flush();
+            stdout_batch.clear();
+        }
+        if (popped == 0) {
+            if (stopped) return;
+            std::this_thread::sleep_for(std::chrono::milliseconds{10});
+        }
+    }
 }
 
 /**
@@ -73,87 +187,128 @@ logger::logger(fs::path const &path) : ofs_{fs::ofstream{path, std::ios_base::ap
  * @return void
  */
 void logger::log(user const &usr, std::string const &message) {
-    std::string today = logger::get_time();
+    if (this->level_ < LOG_LEVEL::LOG_RESULTS) return;
     std::string const &username = usr.username();
-    std::string const &ip = usr.ip();
-
-    std::ostringstream log;
-    log << '[' << today << "]["
-        << username << (username.empty() ? "" : "@") << ip << "]["
-        << message << ']' << std::endl;
-
-    this->ofs_ << log.str();
+    std::string text;
+    text.reserve(username.size() + usr.ip().size() + message.size() + 8);
+    text.append(1, '[').append(username).append(username.empty() ? "" : "@").append(usr.ip())
+            .append("][").append(message).append("]\n");
+    this->push(entry{entry::LOG_FILE, this->now_.load(std::memory_order_relaxed), std::move(text)});
 }
 
-void logger::log(user const &usr, communication::message const &message) {
+/**
+ * Dump the given message exchanged with the given user on the standard output
+ *
+ * @param usr the user to whom the message refers
+ * @param message the message that has to be dumped
+ * @param direction the message direction (e.g. FROM or TO)
+ * @return void
+ */
+void logger::log(user const &usr, communication::message const &message, std::string const &direction) {
+    if (this->level_ < LOG_LEVEL::LOG_MESSAGES) return;
     std::ostringstream log;
-    auto msg_type_str = this->msg_type_str_map_.find(message.msg_type())->second;
-    log << usr.username() << ":" << msg_type_str << std::endl;
+    log << direction << '\t';
+    log << usr.username() << ":" << access_log::msg_type_str(message.msg_type()) << '\n';
     communication::tlv_view view{message};
     while (view.next_tlv()) {
         auto tlv_type_str = this->tlv_type_str_map_.find(view.tlv_type())->second;
         log << "\tT: " << tlv_type_str;
         log << "\tL: " << view.length();
-        if (view.tlv_type() != communication::TLV_TYPE::CONTENT) {
+        // binary values are not dumped
+        if (view.tlv_type() != communication::TLV_TYPE::CONTENT &&
+            view.tlv_type() != communication::TLV_TYPE::ZCONTENT &&
+            view.tlv_type() != communication::TLV_TYPE::BLOCKS &&
+            view.tlv_type() != communication::TLV_TYPE::COPY &&
+            view.tlv_type() != communication::TLV_TYPE::HASHES &&
+            view.tlv_type() != communication::TLV_TYPE::MISSING &&
+            view.tlv_type() != communication::TLV_TYPE::CHUNK) {
             std::string str{view.cbegin(), view.cend()};
-            if (view.tlv_type() == communication::ITEM) {
+            if (view.tlv_type() == communication::ITEM || view.tlv_type() == communication::SOURCE) {
                 str = tools::split_sign(str).first.string();
             } else if (view.tlv_type() == communication::ERROR) {
-                str = this->err_type_str_map_.find(
-                        static_cast<const ERR_TYPE>(stoi(str))
-                )->second;
+                str = access_log::err_type_str(static_cast<const ERR_TYPE>(stoi(str)));
             }
             log << "\tV: " << str;
         }
-        log << std::endl;
+        log << '\n';
     }
-    std::cout << log.str();
+    this->push(entry{entry::STDOUT, 0, log.str()});
 }
 
 /**
  * Log the result of a communication instance for the given user in the format
  * [today][username@ip][TYPE: MSG_TYPE RES: ERR_TYPE  CON: OK|ERR]
-
+ * or as a binary record if the access log has been provided
  *
  * @param usr the user to whom the message refers
  * @param msg_type the message type of the communication instance
  * @param message_result the message processing result
  * @param connection_result the state of connection during communication
+ * @param bytes_in the request bytes
+ * @param bytes_out the replies bytes
+ * @param latency the time elapsed between request receipt and last reply sending
  * @return void
  */
 void logger::log(
         user const &usr,
         MSG_TYPE msg_type,
         ERR_TYPE message_result,
-        CONN_RES connection_result
+        CONN_RES connection_result,
+        size_t bytes_in,
+        size_t bytes_out,
+        std::chrono::microseconds latency
 ) {
-    std::string today = logger::get_time();
+    if (this->access_ofs_.is_open()) {
+        entry e{entry::ACCESS_LOG};
+        access_log::record &r = e.record;
+        r.time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+        r.bytes_in = bytes_in;
+        r.bytes_out = bytes_out;
+        r.latency_us = static_cast<uint32_t>(std::min<int64_t>(latency.count(), UINT32_MAX));
+        r.err_type = static_cast<uint16_t>(message_result);
+        r.msg_type = static_cast<uint8_t>(msg_type);
+        r.conn_res = static_cast<uint8_t>(connection_result);
+        // the user id is the hex representation of a 16 bytes digest
+        std::string const &id = usr.id();
+        auto hex_value = [](char c) { return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10; };
+        for (size_t i = 0; i < sizeof(r.user_id) && 2 * i + 1 < id.size(); i++) {
+            r.user_id[i] = hex_value(id[2 * i]) << 4 | hex_value(id[2 * i + 1]);
+        }
+        boost::system::error_code ec;
+        auto address = boost::asio::ip::make_address(usr.ip(), ec);
+        if (!ec) {
+            auto bytes = address.is_v6()
+                         ? address.to_v6().to_bytes()
+                         : boost::asio::ip::make_address_v6(boost::asio::ip::v4_mapped, address.to_v4()).to_bytes();
+            std::memcpy(r.address, bytes.data(), sizeof(r.address));
+        }
+        this->push(std::move(e));
+        return;
+    }
+    if (this->level_ < LOG_LEVEL::LOG_RESULTS) return;
     std::string const &username = usr.username();
-    std::string const &ip = usr.ip();
-    auto msg_type_str = this->msg_type_str_map_.find(msg_type)->second;
-    auto msg_res_str = this->err_type_str_map_.find(message_result)->second;
-    auto conn_res_str = this->conn_res_str_map_.find(connection_result)->second;
-    std::ostringstream log;
-    log << '[' << today << "]["
-        << username << (username.empty() ? "" : "@") << ip << "]["
-        << "TYPE: " << msg_type_str
-        << " RES: " << msg_res_str
-        << " CONN: " << conn_res_str << ']' << std::endl;
-    this->ofs_ << log.str();
+    std::string text;
+    text.reserve(username.size() + usr.ip().size() + 64);
+    text.append(1, '[').append(username).append(username.empty() ? "" : "@").append(usr.ip())
+            .append("][TYPE: ").append(access_log::msg_type_str(msg_type))
+            .append(" RES: ").append(access_log::err_type_str(message_result))
+            .append(" CONN: ").append(access_log::conn_res_str(connection_result)).append("]\n");
+    this->push(entry{entry::LOG_FILE, this->now_.load(std::memory_order_relaxed), std::move(text)});
 }
 
 /*
- * An internal logger method used to obtain the current time
- * in a string format
+ * An internal logger method used to obtain a given UTC time
+ * in the ISO extended string format
  *
- * @return a string representation of the current time
+ * @param time the time that has to be formatted
+ * @return a string representation of the given time
  */
-std::string logger::get_time() {
-    using namespace boost::posix_time;
-    ptime today{second_clock::universal_time()};
-    std::string today_string{to_iso_extended_string(today)};
-    std::istringstream iss{today_string};
-    std::string today_substring;
-    std::getline(iss, today_substring, ',');
-    return today_substring;
+std::string logger::get_time(std::time_t time) {
+    std::tm tm{};
+    gmtime_r(&time, &tm);
+    char buffer[32];
+    size_t length = std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%S", &tm);
+    return std::string(buffer, length);
 }
\ No newline at end of file
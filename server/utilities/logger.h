@@ -1,7 +1,10 @@
 #ifndef REMOTE_BACKUP_M1_SERVER_LOGGER_H
 #define REMOTE_BACKUP_M1_SERVER_LOGGER_H
 
+#include <atomic>
+#include <ctime>
 #include <fstream>
+#include <thread>
 #include <netinet/in.h>
 #include <boost/filesystem.hpp>
 #include <boost/asio.hpp>
@@ -11,38 +14,96 @@
 #include "../../shared/communication/message.h"
 #include "../../shared/communication/types.h"
 #include "../communication/message_queue.h"
+#include "access_log.h"
 
 /*
- * This class is used to log the communication result
+ * Logger verbosity levels, each one including the previous ones
+ */
+enum LOG_LEVEL : uint8_t {
+    LOG_NONE = 0,       // nothing is logged
+    LOG_RESULTS = 1,    // communication results and connection events are logged on the log file
+    LOG_MESSAGES = 2    // every request and reply is also dumped on the standard output
+};
+
+/*
+ * This class is used to log the communication result.
+ * Log entries are pushed by the io threads into a lock-free
+ * bounded ring buffer and written in batches by a dedicated
+ * writer thread, so that no I/O and no time formatting
+ * happen on the request path. If the ring buffer is full,
+ * entries are dropped and their number is reported.
+ * If an access log is provided, communication results are
+ * written on it as binary records instead of text lines.
  */
 class logger : private boost::noncopyable {
+    /*
+     * A log entry waiting to be written
+     */
+    struct entry {
+        enum SINK : uint8_t { LOG_FILE, STDOUT, ACCESS_LOG } sink = LOG_FILE;
+        std::time_t time = 0;
+        std::string text{};
+        access_log::record record{};
+    };
+
+    /*
+     * A ring buffer slot. The sequence number tells producers and
+     * the writer thread whether the slot is free or filled
+     */
+    struct slot {
+        std::atomic<size_t> seq;
+        entry value;
+    };
+
+    static size_t const RING_SIZE;
+    static size_t const BATCH_SIZE;
+
     boost::filesystem::ofstream ofs_;
-    std::unordered_map<communication::MSG_TYPE, std::string> msg_type_str_map_;
+    boost::filesystem::ofstream access_ofs_;
+    LOG_LEVEL level_;
+    std::unique_ptr<slot[]> ring_;
+    std::atomic<size_t> head_ = 0;  // next slot to be filled by producers
+    size_t tail_ = 0;               // next slot to be consumed by the writer thread
+    std::atomic<size_t> dropped_ = 0;
+    std::atomic<std::time_t> now_;  // coarse clock refreshed by the writer thread
+    std::atomic<bool> stopped_ = false;
+    std::thread writer_;
     std::unordered_map<communication::TLV_TYPE, std::string> tlv_type_str_map_;
-    std::unordered_map<communication::ERR_TYPE, std::string> err_type_str_map_;
-    std::unordered_map<communication::CONN_RES, std::string> conn_res_str_map_;
-    static std::string get_time();
+    static std::string get_time(std::time_t time);
+
+    bool push(entry &&e);
+
+    bool pop(entry &e);
+
+    void write();
 
 public:
 
-    explicit logger(boost::filesystem::path const &path);
+    explicit logger(
+            boost::filesystem::path const &path,
+            LOG_LEVEL level = LOG_LEVEL::LOG_RESULTS,
+            boost::filesystem::path const &access_log_path = {}
+    );
 
     void log(
             user const &usr,
             std::string const &message
     );
 
-    void log(user const& usr, communication::message const& message);
+    void log(user const &usr, communication::message const &message, std::string const &direction);
 
-        void log(
+    void log(
             user const &usr,
             communication::MSG_TYPE msg_type,
             communication::ERR_TYPE message_result,
-            communication::CONN_RES connection_result
+            communication::CONN_RES connection_result,
+            size_t bytes_in = 0,
+            size_t bytes_out = 0,
+            std::chrono::microseconds latency = std::chrono::microseconds::zero()
     );
 
 
-    ~logger() { this->ofs_.close(); }
+    ~logger();
 };
 
 #endif //REMOTE_BACKUP_M1_SERVER_LOGGER_H
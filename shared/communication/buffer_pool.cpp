@@ -0,0 +1,41 @@
+#include "buffer_pool.h"
+
+using namespace communication;
+
+// maximum number of unused buffers kept by the pool
+size_t const buffer_pool::MAX_POOLED = 64;
+std::vector<std::unique_ptr<std::vector<uint8_t>>> buffer_pool::buffers_;
+std::mutex buffer_pool::m_;
+
+/**
+ * Allow to obtain a buffer of a given size, reusing an unused one if available.
+ * The buffer content is unspecified.
+ *
+ * @param size the buffer size
+ * @return a buffer std::shared_ptr that gives back the buffer to the pool on release
+ */
+std::shared_ptr<std::vector<uint8_t>> buffer_pool::get(size_t size) {
+    std::unique_ptr<std::vector<uint8_t>> buffer;
+    {
+        std::unique_lock ul{m_};
+        if (!buffers_.empty()) {
+            buffer = std::move(buffers_.back());
+            buffers_.pop_back();
+        }
+    }
+    if (!buffer) buffer = std::make_unique<std::vector<uint8_t>>();
+    buffer->resize(size);
+    return std::shared_ptr<std::vector<uint8_t>>(buffer.release(), &buffer_pool::release);
+}
+
+/**
+ * Allow to give back a buffer to the pool. If the pool is full the buffer is freed.
+ *
+ * @param buffer the buffer that has to be given back
+ * @return void
+ */
+void buffer_pool::release(std::vector<uint8_t> *buffer) {
+    std::unique_ptr<std::vector<uint8_t>> buffer_ptr{buffer};
+    std::unique_lock ul{m_};
+    if (buffers_.size() < MAX_POOLED) buffers_.push_back(std::move(buffer_ptr));
+}
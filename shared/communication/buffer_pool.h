@@ -0,0 +1,30 @@
+#ifndef REMOTE_BACKUP_M1_BUFFER_POOL_H
+#define REMOTE_BACKUP_M1_BUFFER_POOL_H
+
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+
+namespace communication {
+    /*
+     * This class provides message buffers that are given back
+     * to the pool when the last std::shared_ptr referring to them
+     * is released, so that file chunks can be handed over between
+     * components without being copied and without allocating
+     * a new buffer for each one of them.
+     */
+    class buffer_pool {
+        static size_t const MAX_POOLED;
+        static std::vector<std::unique_ptr<std::vector<uint8_t>>> buffers_;
+        static std::mutex m_;
+
+        static void release(std::vector<uint8_t> *buffer);
+
+    public:
+        static std::shared_ptr<std::vector<uint8_t>> get(size_t size);
+    };
+}
+
+
+#endif //REMOTE_BACKUP_M1_BUFFER_POOL_H
@@ -0,0 +1,136 @@
+#include "cdc_message.h"
+#include "buffer_pool.h"
+#include <algorithm>
+#include <boost/filesystem/exception.hpp>
+
+using namespace communication;
+namespace fs = boost::filesystem;
+
+/**
+ * Construct a cdc_message instance for a specific file.
+ *
+ * @param msg_type the message type
+ * @param path the file absolute path
+ * @param sign the file sign
+ * @param chunks the file chunks, each one marked as missing or not on the other side
+ * @return a new constructed cdc_message instance
+ */
+cdc_message::cdc_message(
+        MSG_TYPE msg_type,
+        fs::path const &path,
+        std::string const &sign,
+        std::vector<chunk> chunks
+) : f_message{msg_type, path, sign}, chunks_{std::move(chunks)} {
+    // chunks contain CHUNK and CONTENT TLVs, so the CONTENT type is not part of the shared header
+    this->header_.pop_back();
+}
+
+/**
+ * Construct a cdc_message instance std::shared_ptr for a specific file.
+ *
+ * @param msg_type the message type
+ * @param path the file absolute path
+ * @param sign the file sign
+ * @param chunks the file chunks, each one marked as missing or not on the other side
+ * @return a new constructed cdc_message std::shared_ptr instance
+ */
+std::shared_ptr<communication::cdc_message> cdc_message::get_instance(
+        MSG_TYPE msg_type,
+        fs::path const &path,
+        std::string const &sign,
+        std::vector<chunk> chunks
+) {
+    return std::shared_ptr<communication::cdc_message>(
+            new cdc_message{msg_type, path, sign, std::move(chunks)}
+    );
+}
+
+/**
+ * Allow to split a file in content-defined chunks. All the chunks are marked as missing.
+ *
+ * @param path the file absolute path
+ * @return the file chunks
+ */
+std::vector<cdc_message::chunk> cdc_message::split(fs::path const &path) {
+    fs::ifstream ifs{path, std::ios_base::binary};
+    if (!ifs) throw fs::filesystem_error{"Failed to open file", path, boost::system::error_code{}};
+    std::vector<chunk> chunks;
+    cdc::chunker chunker{ifs};
+    uint8_t const *data;
+    size_t length;
+    while (chunker.next(data, length)) {
+        chunks.push_back(chunk{
+                chunker.offset(),
+                static_cast<uint32_t>(length),
+                cdc::chunk_hash(data, length),
+                true
+        });
+    }
+    if (ifs.bad()) throw fs::filesystem_error{"Failed to read file", path, boost::system::error_code{}};
+    return chunks;
+}
+
+/**
+ * Allow to obtain the next chunk view. The previous chunk buffer
+ * is not touched, so it remains valid for whoever is still sharing it.
+ *
+ * @return true if the next chunk is available and
+ * ready to be used.
+ */
+bool cdc_message::next_chunk() {
+    if (this->completed_) return false;
+    // the END TLV has always room in the chunk
+    size_t limit = CHUNK_SIZE - STREAM_TLV_SIZE - 3;
+
+    auto raw_msg_ptr = buffer_pool::get(limit + 3);
+    auto &raw = *raw_msg_ptr;
+    std::copy(this->header_.cbegin(), this->header_.cend(), raw.begin());
+    size_t used = this->header_size_;
+    auto add_tlv_header = [&raw, &used](TLV_TYPE tlv_type, size_t length) {
+        raw[used++] = tlv_type;
+        raw[used++] = (length >> 8) & 0xFF;
+        raw[used++] = length & 0xFF;
+    };
+    while (this->index_ < this->chunks_.size()) {
+        chunk const &c = this->chunks_[this->index_];
+        if (!c.missing) {
+            if (used + 3 + cdc::HASH_SIZE > limit) break;
+            add_tlv_header(TLV_TYPE::CHUNK, cdc::HASH_SIZE);
+            std::copy(c.hash.cbegin(), c.hash.cend(), std::next(raw.begin(), used));
+            used += cdc::HASH_SIZE;
+            this->index_++;
+            continue;
+        }
+        if (used + 3 >= limit) break;
+        // chunk data that doesn't fit is sent in the next chunk
+        size_t length = std::min(c.length - this->consumed_, limit - used - 3);
+        size_t offset = used;
+        add_tlv_header(TLV_TYPE::CONTENT, length);
+        this->is_ptr_->seekg(static_cast<std::streamoff>(c.offset + this->consumed_));
+        this->is_ptr_->read(reinterpret_cast<char *>(&raw[used]), static_cast<std::streamsize>(length));
+        if (!*this->is_ptr_) {
+            throw boost::filesystem::filesystem_error::runtime_error{"Unexpected EOF"};
+        }
+        used += this->compress_content(raw, offset, length);
+        this->consumed_ += length;
+        if (this->consumed_ == c.length) {
+            this->consumed_ = 0;
+            this->index_++;
+        }
+    }
+
+    bool completed = this->index_ == this->chunks_.size();
+    if (completed) {
+        // each chunk contains at least a data TLV, even if the file is empty
+        if (used == this->header_size_) add_tlv_header(TLV_TYPE::CONTENT, 0);
+        add_tlv_header(TLV_TYPE::END, 0);
+    }
+    raw.resize(used);
+    message::operator=(message{raw_msg_ptr});
+
+    if (completed) {
+        this->completed_ = true;
+        this->is_ptr_.reset();
+    }
+    return true;
+}
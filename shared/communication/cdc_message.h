@@ -0,0 +1,52 @@
+#ifndef REMOTE_BACKUP_M1_CDC_MESSAGE_H
+#define REMOTE_BACKUP_M1_CDC_MESSAGE_H
+
+#include "f_message.h"
+#include "../utilities/cdc.h"
+
+namespace communication {
+    /*
+     * This class is a specialization of the f_message class
+     * that sends a file split in content-defined chunks. The
+     * chunks the other side already has in its chunk store are
+     * sent as CHUNK TLVs carrying only their hash, the missing
+     * ones as CONTENT TLVs read from the file.
+     */
+    class cdc_message : public f_message {
+    public:
+        struct chunk {
+            uint64_t offset;
+            uint32_t length;
+            cdc::hash_type hash;
+            bool missing;
+        };
+
+    private:
+        std::vector<chunk> chunks_;
+        // next chunk to send and bytes of it already sent
+        size_t index_ = 0;
+        size_t consumed_ = 0;
+
+        cdc_message(
+                MSG_TYPE msg_type,
+                boost::filesystem::path const &path,
+                std::string const &sign,
+                std::vector<chunk> chunks
+        );
+
+    public:
+        static std::shared_ptr<communication::cdc_message> get_instance(
+                MSG_TYPE msg_type,
+                boost::filesystem::path const &path,
+                std::string const &sign,
+                std::vector<chunk> chunks
+        );
+
+        static std::vector<chunk> split(boost::filesystem::path const &path);
+
+        bool next_chunk() override;
+    };
+}
+
+
+#endif //REMOTE_BACKUP_M1_CDC_MESSAGE_H
@@ -0,0 +1,234 @@
+#include "d_message.h"
+#include "buffer_pool.h"
+#include <algorithm>
+#include <boost/filesystem/exception.hpp>
+
+using namespace communication;
+namespace fs = boost::filesystem;
+
+// amount of data read from the file at a time
+size_t const d_message::READ_SIZE = 256 * 1024;
+// maximum length of the literal data kept by a single op
+size_t const d_message::MAX_LITERAL = 32 * 1024;
+
+/**
+ * Construct a d_message instance for a specific file.
+ *
+ * @param msg_type the message type
+ * @param path the file absolute path
+ * @param sign the file sign
+ * @param block_size the block size of the stored version signatures
+ * @param signatures the signatures of the stored version blocks, ordered by offset
+ * @return a new constructed d_message instance
+ */
+d_message::d_message(
+        MSG_TYPE msg_type,
+        fs::path const &path,
+        std::string const &sign,
+        size_t block_size,
+        std::vector<delta::block_signature> const &signatures
+) : f_message{msg_type, path, sign}, block_size_{block_size} {
+    // chunks contain COPY and CONTENT TLVs, so the CONTENT type is not part of the shared header
+    this->header_.pop_back();
+    this->blocks_.reserve(signatures.size());
+    for (size_t i = 0; i < signatures.size(); i++) {
+        this->blocks_[signatures[i].weak].emplace_back(signatures[i].strong, i * block_size);
+    }
+}
+
+/**
+ * Construct a d_message instance std::shared_ptr for a specific file.
+ *
+ * @param msg_type the message type
+ * @param path the file absolute path
+ * @param sign the file sign
+ * @param block_size the block size of the stored version signatures
+ * @param signatures the signatures of the stored version blocks, ordered by offset
+ * @return a new constructed d_message std::shared_ptr instance
+ */
+std::shared_ptr<communication::d_message> d_message::get_instance(
+        MSG_TYPE msg_type,
+        fs::path const &path,
+        std::string const &sign,
+        size_t block_size,
+        std::vector<delta::block_signature> const &signatures
+) {
+    return std::shared_ptr<communication::d_message>(
+            new d_message{msg_type, path, sign, block_size, signatures}
+    );
+}
+
+/**
+ * Allow to read more file data if the data after the checksum window
+ * is not enough to roll it. The data already turned in ops is discarded.
+ *
+ * @return void
+ */
+void d_message::fill() {
+    if (this->eof_ || this->data_.size() > this->pos_ + this->block_size_) return;
+    if (!this->is_ptr_ || !*this->is_ptr_) {
+        throw boost::filesystem::filesystem_error::runtime_error{"Unexpected read error"};
+    }
+    this->data_.erase(this->data_.begin(), std::next(this->data_.begin(), this->literal_start_));
+    this->pos_ -= this->literal_start_;
+    this->literal_start_ = 0;
+    size_t size = this->data_.size();
+    this->data_.resize(size + READ_SIZE);
+    this->is_ptr_->read(reinterpret_cast<char *>(this->data_.data() + size), READ_SIZE);
+    auto read = static_cast<size_t>(this->is_ptr_->gcount());
+    this->data_.resize(size + read);
+    if (this->is_ptr_->bad()) throw boost::filesystem::filesystem_error::runtime_error{"Unexpected read error"};
+    if (read < READ_SIZE) this->eof_ = true;
+}
+
+/**
+ * Allow to look for a stored version block equal to the one in the checksum window.
+ * The strong checksum is computed only if the weak one matches.
+ *
+ * @return an std::optional containing the stored version block offset if found, std::nullopt otherwise
+ */
+std::optional<uint64_t> d_message::match() {
+    auto it = this->blocks_.find(this->checksum_.value());
+    if (it == this->blocks_.end()) return std::nullopt;
+    auto strong = delta::strong_checksum(&this->data_[this->pos_], this->block_size_);
+    for (auto const &[block_strong, offset] : it->second) {
+        if (block_strong == strong) return offset;
+    }
+    return std::nullopt;
+}
+
+/**
+ * Allow to turn the pending literal data in an op
+ *
+ * @return void
+ */
+void d_message::flush_literal() {
+    if (this->pos_ == this->literal_start_) return;
+    this->ops_.push_back(op{false, 0, 0, std::vector<uint8_t>(
+            std::next(this->data_.cbegin(), this->literal_start_),
+            std::next(this->data_.cbegin(), this->pos_)
+    ), 0});
+    this->pending_ += 3 + this->pos_ - this->literal_start_;
+    this->literal_start_ = this->pos_;
+}
+
+/**
+ * Allow to add a copy op, merging it with the previous one if the ranges are contiguous
+ *
+ * @param offset the offset of the range in the stored version
+ * @param length the length of the range
+ * @return void
+ */
+void d_message::add_copy(uint64_t offset, uint32_t length) {
+    if (!this->ops_.empty()) {
+        op &last = this->ops_.back();
+        if (last.copy && last.offset + last.length == offset && last.length <= UINT32_MAX - length) {
+            last.length += length;
+            return;
+        }
+    }
+    this->ops_.push_back(op{true, offset, length, {}, 0});
+    this->pending_ += 3 + delta::COPY_SIZE;
+}
+
+/**
+ * Allow to scan the file until the pending ops need at least target bytes or
+ * the whole file has been scanned. The checksum window is rolled one byte at
+ * time until it matches a stored version block, then it jumps after it.
+ *
+ * @param target the bytes of TLVs that are needed
+ * @return void
+ */
+void d_message::scan(size_t target) {
+    while (!this->scanned_ && this->pending_ < target) {
+        this->fill();
+        if (this->data_.size() - this->pos_ < this->block_size_) {
+            // no full block is left: the remaining data can only be sent as it is
+            this->pos_ = this->data_.size();
+            this->flush_literal();
+            this->scanned_ = true;
+            break;
+        }
+        if (!this->rolled_) {
+            this->checksum_.reset(&this->data_[this->pos_], this->block_size_);
+            this->rolled_ = true;
+        }
+        if (auto offset = this->match()) {
+            this->flush_literal();
+            this->add_copy(offset.value(), this->block_size_);
+            this->pos_ += this->block_size_;
+            this->literal_start_ = this->pos_;
+            this->rolled_ = false;
+            continue;
+        }
+        if (this->pos_ + this->block_size_ < this->data_.size()) {
+            this->checksum_.roll(this->data_[this->pos_], this->data_[this->pos_ + this->block_size_]);
+        } else this->rolled_ = false;
+        this->pos_++;
+        if (this->pos_ - this->literal_start_ >= MAX_LITERAL) this->flush_literal();
+    }
+}
+
+/**
+ * Allow to obtain the next delta chunk view. The previous chunk buffer
+ * is not touched, so it remains valid for whoever is still sharing it.
+ *
+ * @return true if the next chunk is available and
+ * ready to be used.
+ */
+bool d_message::next_chunk() {
+    if (this->completed_) return false;
+    // the END TLV has always room in the chunk
+    size_t limit = CHUNK_SIZE - STREAM_TLV_SIZE - 3;
+    this->scan(limit - this->header_size_);
+
+    auto raw_msg_ptr = buffer_pool::get(limit + 3);
+    auto &raw = *raw_msg_ptr;
+    std::copy(this->header_.cbegin(), this->header_.cend(), raw.begin());
+    size_t used = this->header_size_;
+    auto add_tlv_header = [&raw, &used](TLV_TYPE tlv_type, size_t length) {
+        raw[used++] = tlv_type;
+        raw[used++] = (length >> 8) & 0xFF;
+        raw[used++] = length & 0xFF;
+    };
+    while (!this->ops_.empty()) {
+        op &o = this->ops_.front();
+        if (o.copy) {
+            if (used + 3 + delta::COPY_SIZE > limit) break;
+            add_tlv_header(TLV_TYPE::COPY, delta::COPY_SIZE);
+            delta::pack_copy(o.offset, o.length, &raw[used]);
+            used += delta::COPY_SIZE;
+            this->pending_ -= 3 + delta::COPY_SIZE;
+            this->ops_.pop_front();
+            continue;
+        }
+        if (used + 3 >= limit) break;
+        // literal data that doesn't fit is sent in the next chunk
+        size_t length = std::min(o.literal.size() - o.consumed, limit - used - 3);
+        size_t offset = used;
+        add_tlv_header(TLV_TYPE::CONTENT, length);
+        std::copy_n(std::next(o.literal.cbegin(), o.consumed), length, std::next(raw.begin(), used));
+        used += this->compress_content(raw, offset, length);
+        o.consumed += length;
+        this->pending_ -= length;
+        if (o.consumed == o.literal.size()) {
+            this->pending_ -= 3;
+            this->ops_.pop_front();
+        }
+    }
+
+    bool completed = this->scanned_ && this->ops_.empty();
+    if (completed) {
+        // each chunk contains at least a data TLV, even if the file is empty
+        if (used == this->header_size_) add_tlv_header(TLV_TYPE::CONTENT, 0);
+        add_tlv_header(TLV_TYPE::END, 0);
+    }
+    raw.resize(used);
+    message::operator=(message{raw_msg_ptr});
+
+    if (completed) {
+        this->completed_ = true;
+        this->is_ptr_.reset();
+    }
+    return true;
+}
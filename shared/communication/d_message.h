@@ -0,0 +1,80 @@
+#ifndef REMOTE_BACKUP_M1_D_MESSAGE_H
+#define REMOTE_BACKUP_M1_D_MESSAGE_H
+
+#include <deque>
+#include <optional>
+#include <unordered_map>
+#include "f_message.h"
+#include "../utilities/delta.h"
+
+namespace communication {
+    /*
+     * This class is a specialization of the f_message class
+     * that sends a file as a delta against the version stored
+     * on the other side, whose block signatures are provided.
+     * The file is scanned lazily, chunk by chunk: each chunk
+     * contains COPY TLVs, referring to ranges of the stored
+     * version, and CONTENT TLVs with the data in between.
+     */
+    class d_message : public f_message {
+        /*
+         * A piece of the delta: a range of the stored version or literal data
+         */
+        struct op {
+            bool copy;
+            uint64_t offset;
+            uint32_t length;
+            std::vector<uint8_t> literal;
+            size_t consumed;
+        };
+
+        static size_t const READ_SIZE;
+        static size_t const MAX_LITERAL;
+
+        size_t block_size_;
+        // weak checksum -> (strong checksum, block offset) of the stored version blocks
+        std::unordered_map<uint32_t, std::vector<std::pair<delta::strong_checksum_type, uint64_t>>> blocks_;
+        // data read from the file and not yet turned in ops
+        std::vector<uint8_t> data_;
+        size_t pos_ = 0;            // start of the checksum window in data_
+        size_t literal_start_ = 0;  // start of the literal data not yet turned in an op
+        bool eof_ = false;
+        bool scanned_ = false;
+        delta::rolling_checksum checksum_;
+        bool rolled_ = false;       // true if checksum_ refers to the window at pos_
+        std::deque<op> ops_;
+        size_t pending_ = 0;        // bytes of TLVs needed by the ops not yet sent
+
+        d_message(
+                MSG_TYPE msg_type,
+                boost::filesystem::path const &path,
+                std::string const &sign,
+                size_t block_size,
+                std::vector<delta::block_signature> const &signatures
+        );
+
+        void fill();
+
+        void scan(size_t target);
+
+        std::optional<uint64_t> match();
+
+        void flush_literal();
+
+        void add_copy(uint64_t offset, uint32_t length);
+
+    public:
+        static std::shared_ptr<communication::d_message> get_instance(
+                MSG_TYPE msg_type,
+                boost::filesystem::path const &path,
+                std::string const &sign,
+                size_t block_size,
+                std::vector<delta::block_signature> const &signatures
+        );
+
+        bool next_chunk() override;
+    };
+}
+
+
+#endif //REMOTE_BACKUP_M1_D_MESSAGE_H
@@ -1,10 +1,13 @@
 #include "f_message.h"
+#include "buffer_pool.h"
+#include "../utilities/compression.h"
 #include <boost/filesystem/exception.hpp>
 
 using namespace communication;
 namespace fs = boost::filesystem;
 
 size_t const f_message::CHUNK_SIZE = 64*1024;
+size_t const f_message::STREAM_TLV_SIZE = 3 + 10;
 
 /**
  * Construct an f_message instance for a specific file.
@@ -18,18 +21,30 @@ f_message::f_message(
         MSG_TYPE msg_type,
         fs::path const &path,
         std::string const &sign
+) : f_message{msg_type, std::make_unique<fs::ifstream>(path, std::ios_base::binary), sign} {}
+
+/**
+ * Construct an f_message instance for a file provided as an opened stream.
+ *
+ * @param msg_type the message type
+ * @param is_ptr the file stream
+ * @param path the file sign
+ * @return a new constructed f_message instance
+ */
+f_message::f_message(
+        MSG_TYPE msg_type,
+        std::unique_ptr<std::istream> is_ptr,
+        std::string const &sign
 ) // the sign is added to improve performance
-        : message{msg_type}, ifs_{path, std::ios_base::binary}, completed_{false} {
-    this->ifs_.unsetf(std::ios::skipws);
-    this->ifs_.seekg(0, std::ios::end);
-    this->remaining_ = this->ifs_.tellg();
-    this->ifs_.seekg(0, std::ios::beg);
+        : message{msg_type}, is_ptr_{std::move(is_ptr)}, completed_{false} {
+    this->is_ptr_->unsetf(std::ios::skipws);
+    this->is_ptr_->seekg(0, std::ios::end);
+    this->remaining_ = this->is_ptr_->tellg();
+    this->is_ptr_->seekg(0, std::ios::beg);
     this->add_TLV(TLV_TYPE::ITEM, sign.size(), sign.c_str());
     this->header_size_ = this->size();
-    this->resize(CHUNK_SIZE);
-    this->f_content_ = std::next(this->raw_msg_ptr()->begin(), this->header_size_);
-    this->f_content_[0] = communication::TLV_TYPE::CONTENT;
-    std::advance(this->f_content_, 1);
+    this->header_ = *this->raw_msg_ptr();
+    this->header_.push_back(communication::TLV_TYPE::CONTENT);
 }
 
 /**
@@ -48,9 +63,64 @@ std::shared_ptr<communication::f_message> f_message::get_instance(
     return std::shared_ptr<communication::f_message>(new f_message{msg_type, path, sign});
 }
 
+/**
+ * Construct an f_message instance std::shared_ptr for a file provided as an opened stream.
+ *
+ * @param msg_type the message type
+ * @param is_ptr the file stream
+ * @param path the file sign
+ * @return a new constructed f_message std::shared_ptr instance
+ */
+std::shared_ptr<communication::f_message> f_message::get_instance(
+        MSG_TYPE msg_type,
+        std::unique_ptr<std::istream> is_ptr,
+        std::string const &sign
+) {
+    return std::shared_ptr<communication::f_message>(new f_message{msg_type, std::move(is_ptr), sign});
+}
+
+/**
+ * Allow to set the compression type used for the file data
+ *
+ * @param compression_type the compression type negotiated with the other endpoint
+ * @return void
+ */
+void f_message::compression_type(COMPRESSION_TYPE compression_type) {
+    this->compression_type_ = compression_type;
+}
+
+/**
+ * Allow to compress the data of a CONTENT TLV already written in a chunk
+ * buffer. If the data shrinks, the TLV is replaced in place by a ZCONTENT
+ * TLV, otherwise it is left as it is.
+ *
+ * @param raw the chunk buffer
+ * @param offset the TLV offset in the chunk buffer
+ * @param length the TLV data length
+ * @return the TLV data length after the compression
+ */
+size_t f_message::compress_content(std::vector<uint8_t> &raw, size_t offset, size_t length) const {
+    static thread_local std::vector<uint8_t> compressed(compression::MAX_SIZE);
+    uint8_t *data = &raw[offset + 3];
+    if (this->compression_type_ == COMPRESSION_TYPE::COMPRESSION_NONE ||
+        !compression::compressible(data, length)) {
+        return length;
+    }
+    size_t compressed_length = compression::compress(
+            this->compression_type_, data, length, compressed.data(), length - 1
+    );
+    if (compressed_length == 0) return length;
+    raw[offset] = TLV_TYPE::ZCONTENT;
+    raw[offset + 1] = (compressed_length >> 8) & 0xFF;
+    raw[offset + 2] = compressed_length & 0xFF;
+    std::copy_n(compressed.cbegin(), compressed_length, data);
+    return compressed_length;
+}
+
 
 /**
- * Allow to obtain the next file chunk view
+ * Allow to obtain the next file chunk view. The previous chunk buffer
+ * is not touched, so it remains valid for whoever is still sharing it.
  *
  * @return true if the next chunk is available and
  * ready to be used.
@@ -58,24 +128,27 @@ std::shared_ptr<communication::f_message> f_message::get_instance(
 bool f_message::next_chunk() {
     if (this->completed_) return false;
     size_t to_read;
-    if (this->remaining_ > CHUNK_SIZE - this->header_size_ - 3 - 3) {
-        to_read = CHUNK_SIZE - this->header_size_ - 3;
+    if (this->remaining_ > CHUNK_SIZE - STREAM_TLV_SIZE - this->header_size_ - 3 - 3) {
+        to_read = CHUNK_SIZE - STREAM_TLV_SIZE - this->header_size_ - 3;
     } else {
         to_read = this->remaining_;
         this->completed_ = true;
     }
+    auto raw_msg_ptr = buffer_pool::get(this->header_size_ + 3 + to_read);
+    auto f_content = std::copy(this->header_.cbegin(), this->header_.cend(), raw_msg_ptr->begin());
     for (int i = 0; i < 2; i++) {
-        this->f_content_[i] = (to_read >> (1 - i) * 8) & 0xFF;
+        *f_content++ = (to_read >> (1 - i) * 8) & 0xFF;
     }
-    this->ifs_.read(reinterpret_cast<char *>(&*(this->f_content_ + 2)), to_read);
-    if (!this->ifs_) {
+    this->is_ptr_->read(reinterpret_cast<char *>(&*f_content), to_read);
+    if (!*this->is_ptr_) {
         throw boost::filesystem::filesystem_error::runtime_error{"Unexpected EOF"};
     }
+    raw_msg_ptr->resize(this->header_size_ + 3 + this->compress_content(*raw_msg_ptr, this->header_size_, to_read));
+    message::operator=(message{raw_msg_ptr});
 
     if (this->completed_) {
-        this->resize(this->header_size_ + 3 + this->remaining_);
         this->add_TLV(communication::TLV_TYPE::END);
-        this->ifs_.close();
+        this->is_ptr_.reset();
     }
     this->remaining_ -= to_read;
     return true;
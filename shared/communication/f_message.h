@@ -8,14 +8,24 @@ namespace communication {
      * This class is a specialization of the message class
      * to handle in a more efficient way messages containing
      * file chunks. Specifically it provides on each next_chunk()
-     * invocation a new chunk view ready to be sent
+     * invocation a new chunk view ready to be sent. Each chunk
+     * is read directly from the file into its own pooled buffer,
+     * so that a chunk can be kept (e.g. queued) by sharing
+     * raw_msg_ptr() without copying it. Subclasses can send
+     * the file in a different form by overriding next_chunk().
+     * The file can also be provided as an already opened stream.
+     * If a compression type is set, the compressible CONTENT
+     * TLVs are sent as ZCONTENT TLVs.
      */
     class f_message : public message {
-        boost::filesystem::ifstream ifs_;
-        std::vector<uint8_t>::iterator f_content_;
+    protected:
+        std::unique_ptr<std::istream> is_ptr_;
+        // message type, ITEM TLV and CONTENT TLV type shared by all the chunks
+        std::vector<uint8_t> header_;
         size_t header_size_;
         size_t remaining_;
         bool completed_;
+        COMPRESSION_TYPE compression_type_ = COMPRESSION_TYPE::COMPRESSION_NONE;
 
         f_message(
                 MSG_TYPE msg_type,
@@ -23,8 +33,18 @@ namespace communication {
                 std::string const &sign
         );
 
+        f_message(
+                MSG_TYPE msg_type,
+                std::unique_ptr<std::istream> is_ptr,
+                std::string const &sign
+        );
+
+        size_t compress_content(std::vector<uint8_t> &raw, size_t offset, size_t length) const;
+
     public:
         static size_t const CHUNK_SIZE;
+        // room left in each chunk for the STREAM TLV of a 32 bit stream id
+        static size_t const STREAM_TLV_SIZE;
 
         static std::shared_ptr<communication::f_message> get_instance(
                 MSG_TYPE msg_type,
@@ -32,8 +52,17 @@ namespace communication {
                 std::string const &sign
         );
 
-        bool next_chunk();
+        static std::shared_ptr<communication::f_message> get_instance(
+                MSG_TYPE msg_type,
+                std::unique_ptr<std::istream> is_ptr,
+                std::string const &sign
+        );
+
+        void compression_type(COMPRESSION_TYPE compression_type);
+
+        virtual bool next_chunk();
 
+        virtual ~f_message() = default;
     };
 }
 
@@ -5,8 +5,9 @@
 namespace communication {
     /*
      * These enums define the allowed message type, the allowed
-     * TLV type, the possible server error response and the
-     * communication result for logging.
+     * TLV type, the possible server error response, the
+     * communication result for logging and the digest and compression
+     * algorithms that can be negotiated during authentication.
      */
     enum MSG_TYPE {
         NONE = 0,
@@ -16,7 +17,10 @@ namespace communication {
         LIST = 4,
         AUTH = 5,
         RETRIEVE = 6,
-        KEEP_ALIVE = 7
+        KEEP_ALIVE = 7,
+        SIGNATURE = 8,
+        CHUNKS = 9,
+        CLONE = 10
     };
 
     enum TLV_TYPE {
@@ -26,7 +30,18 @@ namespace communication {
         END = 3,
         OK = 4,
         ERROR = 5,
-        CONTENT = 6
+        CONTENT = 6,
+        DIGEST = 7,
+        STREAM = 8,
+        BLOCK_SIZE = 9,
+        BLOCKS = 10,
+        COPY = 11,
+        HASHES = 12,
+        MISSING = 13,
+        CHUNK = 14,
+        SOURCE = 15,
+        COMPRESSION = 16,
+        ZCONTENT = 17
     };
 
     enum ERR_TYPE {
@@ -51,7 +66,18 @@ namespace communication {
         ERR_AUTH_NO_USRN = 501,
         ERR_AUTH_NO_PSWD = 502,
         ERR_AUTH_FAILED = 503,
-        ERR_RETRIEVE_FAILED = 601
+        ERR_RETRIEVE_FAILED = 601,
+        ERR_SIGNATURE_NO_ITEM = 701,
+        ERR_SIGNATURE_NOT_EXIST = 702,
+        ERR_SIGNATURE_FAILED = 703,
+        ERR_CHUNKS_NO_ITEM = 801,
+        ERR_CHUNKS_FAILED = 802,
+        ERR_CLONE_NO_ITEM = 901,
+        ERR_CLONE_NO_SOURCE = 902,
+        ERR_CLONE_NOT_EXIST = 903,
+        ERR_CLONE_ALREADY_EXIST = 904,
+        ERR_CLONE_NO_MATCH = 905,
+        ERR_CLONE_FAILED = 906
     };
 
     // communication result for logging
@@ -60,6 +86,16 @@ namespace communication {
         CONN_OK = 1,
         CONN_ERR = 2
     };
+
+    enum DIGEST_TYPE {
+        DIGEST_MD5 = 0,
+        DIGEST_SHA256 = 1
+    };
+
+    enum COMPRESSION_TYPE {
+        COMPRESSION_NONE = 0,
+        COMPRESSION_ZLIB = 1
+    };
 }
 
 #endif //REMOTE_BACKUP_M1_TYPES_H
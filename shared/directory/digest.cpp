@@ -0,0 +1,91 @@
+#include "digest.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace directory;
+
+namespace {
+    char const HEX_DIGITS[] = "0123456789ABCDEF";
+
+    /**
+     * Allow to obtain the value of an upper case hex digit
+     *
+     * @param c the hex digit
+     * @return the hex digit value or -1 if c is not an upper case hex digit
+     */
+    int hex_value(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+}
+
+/**
+ * Construct a digest instance from its string representation
+ *
+ * @param str the digest string representation
+ * @return a new constructed digest instance
+ */
+digest::digest(std::string const &str) {
+    this->hex_ = !str.empty() && str.size() % 2 == 0 && str.size() <= 2 * MAX_SIZE
+                 && std::all_of(str.cbegin(), str.cend(), [](char c) { return hex_value(c) != -1; });
+    if (this->hex_) {
+        this->size_ = str.size() / 2;
+        for (size_t i = 0; i < this->size_; i++) {
+            this->bytes_[i] = hex_value(str[2 * i]) << 4 | hex_value(str[2 * i + 1]);
+        }
+    } else if (str.size() <= MAX_SIZE) {
+        this->size_ = str.size();
+        std::memcpy(this->bytes_.data(), str.data(), str.size());
+    } else this->long_ptr_ = std::make_shared<std::string const>(str);
+}
+
+/**
+ * Allow to obtain the string representation of the digest
+ *
+ * @return the digest string representation
+ */
+std::string digest::str() const {
+    if (this->long_ptr_) return *this->long_ptr_;
+    if (!this->hex_) return std::string(reinterpret_cast<char const *>(this->bytes_.data()), this->size_);
+    std::string result(2 * this->size_, '0');
+    for (size_t i = 0; i < this->size_; i++) {
+        result[2 * i] = HEX_DIGITS[this->bytes_[i] >> 4];
+        result[2 * i + 1] = HEX_DIGITS[this->bytes_[i] & 0x0F];
+    }
+    return result;
+}
+
+/**
+ * Compare two digests
+ *
+ * @param other the digest to compare with
+ * @return true if the digests have the same string representation, false otherwise
+ */
+bool digest::operator==(digest const &other) const {
+    if (this->long_ptr_ || other.long_ptr_) {
+        return this->long_ptr_ && other.long_ptr_ && *this->long_ptr_ == *other.long_ptr_;
+    }
+    return this->hex_ == other.hex_ && this->size_ == other.size_
+           && std::equal(this->bytes_.cbegin(), this->bytes_.cbegin() + this->size_, other.bytes_.cbegin());
+}
+
+/**
+ * Compare the digest with a digest string representation without building
+ * the digest string representation
+ *
+ * @param str the digest string representation to compare with
+ * @return true if str is the digest string representation, false otherwise
+ */
+bool digest::operator==(std::string const &str) const {
+    if (this->long_ptr_) return *this->long_ptr_ == str;
+    if (!this->hex_) {
+        return str.size() == this->size_ && std::memcmp(str.data(), this->bytes_.data(), this->size_) == 0;
+    }
+    if (str.size() != 2 * this->size_) return false;
+    for (size_t i = 0; i < this->size_; i++) {
+        if (str[2 * i] != HEX_DIGITS[this->bytes_[i] >> 4]
+            || str[2 * i + 1] != HEX_DIGITS[this->bytes_[i] & 0x0F]) return false;
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef REMOTE_BACKUP_M1_DIGEST_H
+#define REMOTE_BACKUP_M1_DIGEST_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <cstdint>
+
+namespace directory {
+    /*
+     * This class stores a resource digest in a compact form.
+     * Digests are exchanged as upper case hex strings: they are kept
+     * as raw bytes in a fixed-size inline buffer, halving their size
+     * and avoiding a heap allocation for each directory entry.
+     * Any other string (e.g. a malformed digest sent by a peer) is
+     * kept as it is, inline if it fits, so that the string
+     * representation is always given back unchanged.
+     */
+    class digest {
+        static size_t const MAX_SIZE = 32;    // SHA256 raw digest size
+
+        std::array<uint8_t, MAX_SIZE> bytes_{};
+        uint8_t size_ = 0;
+        bool hex_ = false;
+        std::shared_ptr<std::string const> long_ptr_;  // strings that don't fit in bytes_
+
+    public:
+        digest() = default;
+
+        digest(std::string const &str);
+
+        [[nodiscard]] std::string str() const;
+
+        bool operator==(digest const &other) const;
+
+        bool operator==(std::string const &str) const;
+    };
+}
+
+
+#endif //REMOTE_BACKUP_M1_DIGEST_H
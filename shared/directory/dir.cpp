@@ -27,6 +27,35 @@ std::shared_ptr<dir<R>> dir<R>::get_instance(boost::filesystem::path path, bool
     return std::shared_ptr<dir<R>>(new dir<R>{std::move(path), concurrent_accessed});
 }
 
+/**
+ * Select the shard responsible for the provided path.
+ *
+ * @param path Path of the entry.
+ * @return the shard the entry belongs to.
+ */
+template<typename R>
+typename dir<R>::shard &dir<R>::shard_of(boost::filesystem::path const &path) {
+    return this->shards_[std::hash<boost::filesystem::path>()(path) % DIR_SHARDS];
+}
+
+template<typename R>
+typename dir<R>::shard const &dir<R>::shard_of(boost::filesystem::path const &path) const {
+    return this->shards_[std::hash<boost::filesystem::path>()(path) % DIR_SHARDS];
+}
+
+/**
+ * Acquire the provided shard lock if the directory is accessed in concurrent mode.
+ *
+ * @param s Shard that have to be locked.
+ * @return a lock owning the shard mutex in concurrent mode, an empty lock otherwise.
+ */
+template<typename R>
+std::unique_lock<std::mutex> dir<R>::lock(shard const &s) const {
+    std::unique_lock ul{s.m_, std::defer_lock};
+    if (this->concurrent_accessed_) ul.lock();
+    return ul;
+}
+
 /**
  * Insert or assign a new directory entry.
  *
@@ -36,9 +65,9 @@ std::shared_ptr<dir<R>> dir<R>::get_instance(boost::filesystem::path path, bool
  */
 template<typename R>
 bool dir<R>::insert_or_assign(boost::filesystem::path const &path, R const &rsrc) {
-    std::unique_lock ul{this->m_, std::defer_lock};
-    if (concurrent_accessed_) ul.lock();
-    return this->content_.insert_or_assign(path, rsrc).second;
+    auto &s = this->shard_of(path);
+    auto ul = this->lock(s);
+    return s.content_.insert_or_assign(path, rsrc).second;
 }
 
 /**
@@ -49,9 +78,9 @@ bool dir<R>::insert_or_assign(boost::filesystem::path const &path, R const &rsrc
  */
 template<typename R>
 bool dir<R>::erase(boost::filesystem::path const &path) {
-    std::unique_lock ul{this->m_, std::defer_lock};
-    if (concurrent_accessed_) ul.lock();
-    return this->content_.erase(path) == 1;
+    auto &s = this->shard_of(path);
+    auto ul = this->lock(s);
+    return s.content_.erase(path) == 1;
 }
 
 /**
@@ -62,9 +91,24 @@ bool dir<R>::erase(boost::filesystem::path const &path) {
  */
 template<typename R>
 bool dir<R>::contains(boost::filesystem::path const &path) const {
-    std::unique_lock ul{this->m_, std::defer_lock};
-    if (concurrent_accessed_) ul.lock();
-    return this->content_.find(path) != this->content_.end();
+    auto const &s = this->shard_of(path);
+    auto ul = this->lock(s);
+    return s.content_.find(path) != s.content_.end();
+}
+
+/**
+ * Provide the number of directory entries
+ *
+ * @return the number of directory entries.
+ */
+template<typename R>
+size_t dir<R>::size() const {
+    size_t size = 0;
+    for (auto const &s : this->shards_) {
+        auto ul = this->lock(s);
+        size += s.content_.size();
+    }
+    return size;
 }
 
 /**
@@ -86,25 +130,40 @@ boost::filesystem::path const &dir<R>::path() const {
  */
 template<typename R>
 std::optional<R> dir<R>::rsrc(boost::filesystem::path const &path) const {
-    std::unique_lock ul{this->m_, std::defer_lock};
-    if (concurrent_accessed_) ul.lock();
-    auto it = this->content_.find(path);
-    return it != this->content_.end() ? std::optional<R>{it->second} : std::nullopt;
-
+    auto const &s = this->shard_of(path);
+    auto ul = this->lock(s);
+    auto it = s.content_.find(path);
+    return it != s.content_.end() ? std::optional<R>{it->second} : std::nullopt;
 }
 
 /**
- * Allows to execute a specified function on each directory entry
+ * Allows to execute a specified function on each directory entry.
+ * In concurrent mode each shard is copied under its lock and the
+ * function is executed on the copy after releasing it, so that long
+ * running functions don't block concurrent updates. Entries inserted,
+ * assigned or erased during the iteration may or may not be visited.
  *
  * @param fn Function that have to be executed on each directory entry.
  * @return void
  */
 template<typename R>
 void dir<R>::for_each(std::function<void(std::pair<boost::filesystem::path, R> const &)> const &fn) const {
-    std::unique_lock ul{this->m_, std::defer_lock};
-    if (concurrent_accessed_) ul.lock();
-    auto it = this->content_.cbegin();
-    while (it != this->content_.cend()) fn(*it++);
+    if (!this->concurrent_accessed_) {
+        for (auto const &s : this->shards_) {
+            auto it = s.content_.cbegin();
+            while (it != s.content_.cend()) fn(*it++);
+        }
+        return;
+    }
+    std::vector<std::pair<boost::filesystem::path, R>> snapshot;
+    for (auto const &s : this->shards_) {
+        snapshot.clear();
+        {
+            auto ul = this->lock(s);
+            snapshot.assign(s.content_.cbegin(), s.content_.cend());
+        }
+        for (auto const &entry : snapshot) fn(entry);
+    }
 }
 
 /**
@@ -114,7 +173,8 @@ void dir<R>::for_each(std::function<void(std::pair<boost::filesystem::path, R> c
  */
 template<typename R>
 void dir<R>::clear() {
-    std::unique_lock ul{this->m_, std::defer_lock};
-    if (concurrent_accessed_) ul.lock();
-    this->content_.clear();
+    for (auto &s : this->shards_) {
+        auto ul = this->lock(s);
+        s.content_.clear();
+    }
 }
\ No newline at end of file
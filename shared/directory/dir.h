@@ -2,6 +2,11 @@
 #define REMOTE_BACKUP_M1_DIR_H
 
 
+#include <array>
+#include <optional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
@@ -24,18 +29,26 @@ namespace std {
     };
 }
 
+#define DIR_SHARDS 16
+
 /*
  * This class provides an abstraction of a filesystem directory.
  * It allows to manage the associated directory resources in
- * a concurrent way.
+ * a concurrent way. Entries are spread over DIR_SHARDS shards
+ * by path hash, each one guarded by its own lock, so that
+ * operations on different paths rarely contend.
  */
 namespace directory {
     template<typename R>
     class dir {
+        struct shard {
+            std::unordered_map<boost::filesystem::path, R> content_;
+            mutable std::mutex m_;    // we need to acquire lock also in const methods
+        };
+
         boost::filesystem::path path_;
-        std::unordered_map<boost::filesystem::path, R> content_;
+        std::array<shard, DIR_SHARDS> shards_;
         bool concurrent_accessed_;
-        mutable std::mutex m_;    // we need to acquire lock also in const methods
 
     public:
         static std::shared_ptr<dir> get_instance(
@@ -49,6 +62,8 @@ namespace directory {
 
         bool contains(boost::filesystem::path const &path) const;
 
+        size_t size() const;
+
         boost::filesystem::path const &path() const;
 
         std::optional<R> rsrc(boost::filesystem::path const &path) const;
@@ -61,6 +76,12 @@ namespace directory {
 
     private:
         dir(boost::filesystem::path path, bool concurrent_accessed);
+
+        shard &shard_of(boost::filesystem::path const &path);
+
+        shard const &shard_of(boost::filesystem::path const &path) const;
+
+        std::unique_lock<std::mutex> lock(shard const &s) const;
     };
 }
 
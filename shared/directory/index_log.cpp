@@ -0,0 +1,85 @@
+#include "index_log.h"
+
+namespace {
+    // an index is compacted when it has more than COMPACTION_RATIO records per entry
+    size_t const COMPACTION_RATIO = 2;
+    size_t const MIN_COMPACTION_RECORDS = 1024;
+}
+
+/**
+ * Allow to read a string of a given length
+ *
+ * @param is the index stream
+ * @param str the string the read data is assigned to
+ * @param length the string length
+ * @return true if the string has been read, false otherwise
+ */
+bool index_log::read_string(std::istream &is, std::string &str, size_t length) {
+    str.resize(length);
+    return static_cast<bool>(is.read(str.data(), static_cast<std::streamsize>(length)));
+}
+
+/**
+ * Allow to write the common part of a record: its type and the relative path
+ *
+ * @param os the index stream
+ * @param record_type the record type
+ * @param path the relative path
+ * @return void
+ */
+void index_log::write_record(std::ostream &os, RECORD_TYPE record_type, std::string const &path) {
+    write_value(os, record_type);
+    write_value(os, static_cast<uint16_t>(path.size()));
+    os.write(path.data(), static_cast<std::streamsize>(path.size()));
+}
+
+/**
+ * Allow to read the common part of a record: its type and the relative path
+ *
+ * @param is the index stream
+ * @param record_type the read record type
+ * @param path the read relative path
+ * @return true if the record has been read, false if the index ends (possibly with a truncated record)
+ */
+bool index_log::read_record(std::istream &is, RECORD_TYPE &record_type, std::string &path) {
+    uint8_t type;
+    uint16_t path_length;
+    if (!read_value(is, type) || !read_value(is, path_length) || !read_string(is, path, path_length)) return false;
+    record_type = static_cast<RECORD_TYPE>(type);
+    return true;
+}
+
+/**
+ * Allow to write the digest of a put record
+ *
+ * @param os the index stream
+ * @param digest the digest
+ * @return void
+ */
+void index_log::write_digest(std::ostream &os, std::string const &digest) {
+    write_value(os, static_cast<uint8_t>(digest.size()));
+    os.write(digest.data(), static_cast<std::streamsize>(digest.size()));
+}
+
+/**
+ * Allow to read the digest of a put record
+ *
+ * @param is the index stream
+ * @param digest the read digest
+ * @return true if the digest has been read, false otherwise
+ */
+bool index_log::read_digest(std::istream &is, std::string &digest) {
+    uint8_t digest_length;
+    return read_value(is, digest_length) && read_string(is, digest, digest_length);
+}
+
+/**
+ * Allow to check if an index contains too many stale records
+ *
+ * @param records the number of records of the index
+ * @param entries the number of entries the index content is made of
+ * @return true if the index has to be compacted, false otherwise
+ */
+bool index_log::needs_compaction(size_t records, size_t entries) {
+    return records > COMPACTION_RATIO * entries + MIN_COMPACTION_RECORDS;
+}
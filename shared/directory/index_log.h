@@ -0,0 +1,92 @@
+#ifndef REMOTE_BACKUP_M1_INDEX_LOG_H
+#define REMOTE_BACKUP_M1_INDEX_LOG_H
+
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include "../communication/types.h"
+
+/*
+ * Encoding shared by the client and the server indexes. An index is an
+ * append-only log: a header (magic, version and digest type) followed by
+ * put and erase records, each one starting with the record type and the
+ * relative path. The rest of a put record depends on the index. The log
+ * is compacted once it contains too many stale records.
+ */
+namespace index_log {
+    enum RECORD_TYPE : uint8_t {
+        ERASE = 0,
+        PUT = 1
+    };
+
+    template<typename T>
+    void write_value(std::ostream &os, T value) {
+        os.write(reinterpret_cast<char const *>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    bool read_value(std::istream &is, T &value) {
+        return static_cast<bool>(is.read(reinterpret_cast<char *>(&value), sizeof(value)));
+    }
+
+    bool read_string(std::istream &is, std::string &str, size_t length);
+
+    /**
+     * Allow to write the header of an index
+     *
+     * @param os the index stream
+     * @param magic the index magic string
+     * @param version the index format version
+     * @param digest_type the digest type of the stored digests
+     * @return void
+     */
+    template<size_t N>
+    void write_header(
+            std::ostream &os,
+            char const (&magic)[N],
+            uint8_t version,
+            communication::DIGEST_TYPE digest_type
+    ) {
+        os.write(magic, N);
+        write_value(os, version);
+        write_value(os, static_cast<uint8_t>(digest_type));
+    }
+
+    /**
+     * Allow to read the header of an index, checking it matches the expected one
+     *
+     * @param is the index stream
+     * @param magic the index magic string
+     * @param version the index format version
+     * @param digest_type the digest type of the requested digests
+     * @return true if the header matches, false otherwise
+     */
+    template<size_t N>
+    bool read_header(
+            std::istream &is,
+            char const (&magic)[N],
+            uint8_t version,
+            communication::DIGEST_TYPE digest_type
+    ) {
+        char stored_magic[N];
+        uint8_t stored_version, stored_digest_type;
+        return is.read(stored_magic, N) && std::memcmp(stored_magic, magic, N) == 0 &&
+               read_value(is, stored_version) && stored_version == version &&
+               read_value(is, stored_digest_type) && stored_digest_type == digest_type;
+    }
+
+    void write_record(std::ostream &os, RECORD_TYPE record_type, std::string const &path);
+
+    bool read_record(std::istream &is, RECORD_TYPE &record_type, std::string &path);
+
+    void write_digest(std::ostream &os, std::string const &digest);
+
+    bool read_digest(std::istream &is, std::string &digest);
+
+    bool needs_compaction(size_t records, size_t entries);
+}
+
+
+#endif //REMOTE_BACKUP_M1_INDEX_LOG_H
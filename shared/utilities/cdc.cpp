@@ -0,0 +1,146 @@
+#include "cdc.h"
+#include <algorithm>
+#include <boost/algorithm/hex.hpp>
+#include <openssl/evp.h>
+
+namespace {
+    // the cut point masks have more bits before the average chunk size and less after it,
+    // so that chunk sizes are normalized around it
+    uint64_t const MASK_SMALL = ((uint64_t{1} << 15) - 1) << (64 - 15);
+    uint64_t const MASK_LARGE = ((uint64_t{1} << 13) - 1) << (64 - 13);
+    size_t const BUFFER_SIZE = 4 * cdc::MAX_SIZE;
+
+    /**
+     * Allow to generate the gear table, a random value for each byte value.
+     * It is generated at compile time through splitmix64, so that client
+     * and server always cut the same data in the same chunks.
+     *
+     * @return the gear table
+     */
+    constexpr std::array<uint64_t, 256> make_gear() {
+        std::array<uint64_t, 256> gear{};
+        uint64_t state = 0x5242'4D31'4344'4331;
+        for (auto &value : gear) {
+            uint64_t z = (state += 0x9E37'79B9'7F4A'7C15);
+            z = (z ^ (z >> 30)) * 0xBF58'476D'1CE4'E5B9;
+            z = (z ^ (z >> 27)) * 0x94D0'49BB'1331'11EB;
+            value = z ^ (z >> 31);
+        }
+        return gear;
+    }
+
+    constexpr std::array<uint64_t, 256> GEAR = make_gear();
+}
+
+/**
+ * Construct a chunker instance reading from a given stream
+ *
+ * @param is the stream the data has to be read from
+ * @return a new constructed chunker instance
+ */
+cdc::chunker::chunker(std::istream &is) : is_{is}, buffer_(BUFFER_SIZE) {}
+
+/**
+ * Allow to read more data if less than a maximum size chunk is buffered.
+ * The data already returned is discarded.
+ *
+ * @return void
+ */
+void cdc::chunker::fill() {
+    if (this->eof_ || this->end_ - this->begin_ >= MAX_SIZE) return;
+    std::copy(
+            std::next(this->buffer_.begin(), this->begin_),
+            std::next(this->buffer_.begin(), this->end_),
+            this->buffer_.begin()
+    );
+    this->end_ -= this->begin_;
+    this->begin_ = 0;
+    while (!this->eof_ && this->end_ < this->buffer_.size()) {
+        this->is_.read(
+                reinterpret_cast<char *>(this->buffer_.data() + this->end_),
+                static_cast<std::streamsize>(this->buffer_.size() - this->end_)
+        );
+        this->end_ += static_cast<size_t>(this->is_.gcount());
+        if (!this->is_) this->eof_ = true;
+    }
+}
+
+/**
+ * Allow to obtain the next chunk. The chunk data remains valid until the next
+ * invocation. A read error ends the chunks as the end of the stream does, so
+ * it has to be checked on the stream.
+ *
+ * @param data the pointer the chunk data is assigned to
+ * @param length the variable the chunk length is assigned to
+ * @return true if a chunk is available, false at the end of the stream
+ */
+bool cdc::chunker::next(uint8_t const *&data, size_t &length) {
+    this->fill();
+    if (this->begin_ == this->end_) return false;
+    data = this->buffer_.data() + this->begin_;
+    length = cut(data, this->end_ - this->begin_);
+    this->begin_ += length;
+    this->offset_ = this->position_;
+    this->position_ += length;
+    return true;
+}
+
+/**
+ * Allow to obtain the offset in the stream of the last returned chunk
+ *
+ * @return the chunk offset
+ */
+uint64_t cdc::chunker::offset() const {
+    return this->offset_;
+}
+
+/**
+ * Allow to find the first cut point in the given data. The data has to
+ * contain at least MAX_SIZE bytes, unless it is the end of the stream.
+ *
+ * @param data a pointer to the data
+ * @param length the data length
+ * @return the length of the chunk starting at data
+ */
+size_t cdc::cut(uint8_t const *data, size_t length) {
+    if (length <= MIN_SIZE) return length;
+    length = std::min(length, MAX_SIZE);
+    size_t normal = std::min(length, AVG_SIZE);
+    uint64_t fingerprint = 0;
+    size_t i = MIN_SIZE;
+    for (; i < normal; i++) {
+        fingerprint = (fingerprint << 1) + GEAR[data[i]];
+        if (!(fingerprint & MASK_SMALL)) return i + 1;
+    }
+    for (; i < length; i++) {
+        fingerprint = (fingerprint << 1) + GEAR[data[i]];
+        if (!(fingerprint & MASK_LARGE)) return i + 1;
+    }
+    return length;
+}
+
+/**
+ * Allow to compute the hash (SHA256) identifying a chunk
+ *
+ * @param data a pointer to the chunk data
+ * @param length the chunk length
+ * @return the chunk hash
+ */
+cdc::hash_type cdc::chunk_hash(uint8_t const *data, size_t length) {
+    hash_type hash;
+    EVP_Digest(data, length, hash.data(), nullptr, EVP_sha256(), nullptr);
+    return hash;
+}
+
+/**
+ * Allow to obtain the upper case hex representation of a chunk hash
+ *
+ * @param hash the chunk hash
+ * @return the hex representation
+ */
+std::string cdc::to_hex(hash_type const &hash) {
+    std::string hex;
+    hex.reserve(2 * HASH_SIZE);
+    boost::algorithm::hex(hash.cbegin(), hash.cend(), std::back_inserter(hex));
+    return hex;
+}
@@ -0,0 +1,59 @@
+#ifndef REMOTE_BACKUP_M1_CDC_H
+#define REMOTE_BACKUP_M1_CDC_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+/*
+ * Content-defined chunking (FastCDC). Files are split where a gear
+ * rolling hash of the last bytes matches a mask, so that chunk
+ * boundaries depend only on the surrounding content: the same data
+ * produces the same chunks in different files or at different offsets.
+ * Chunks are identified by their SHA256 hash, which is used both by the
+ * client to ask which chunks the server is missing and by the server to
+ * keep a single copy of each chunk in its chunk store.
+ */
+namespace cdc {
+    size_t const MIN_SIZE = 4 * 1024;
+    size_t const AVG_SIZE = 16 * 1024;
+    size_t const MAX_SIZE = 64 * 1024;
+    size_t const HASH_SIZE = 32;
+
+    typedef std::array<uint8_t, HASH_SIZE> hash_type;
+
+    /*
+     * This class splits the data read from a stream in chunks, one at time.
+     */
+    class chunker {
+        std::istream &is_;
+        std::vector<uint8_t> buffer_;
+        size_t begin_ = 0;
+        size_t end_ = 0;
+        // offset in the stream of the next chunk and of the last returned one
+        uint64_t position_ = 0;
+        uint64_t offset_ = 0;
+        bool eof_ = false;
+
+        void fill();
+
+    public:
+        explicit chunker(std::istream &is);
+
+        bool next(uint8_t const *&data, size_t &length);
+
+        [[nodiscard]] uint64_t offset() const;
+    };
+
+    size_t cut(uint8_t const *data, size_t length);
+
+    hash_type chunk_hash(uint8_t const *data, size_t length);
+
+    std::string to_hex(hash_type const &hash);
+}
+
+
+#endif //REMOTE_BACKUP_M1_CDC_H
@@ -0,0 +1,100 @@
+#include "compression.h"
+#include <array>
+#include <cmath>
+#include <zlib.h>
+
+using namespace communication;
+
+namespace {
+    // the sampled data: SAMPLES slices of SAMPLE_SIZE bytes spread over the whole data
+    size_t const SAMPLES = 16;
+    size_t const SAMPLE_SIZE = 64;
+    // estimated entropy (bits per byte) above which the data is considered incompressible
+    double const MAX_ENTROPY = 7.2;
+}
+
+/**
+ * Provide the supported compression types, ordered from the preferred one
+ *
+ * @return the supported compression types
+ */
+std::vector<COMPRESSION_TYPE> const &compression::supported() {
+    static std::vector<COMPRESSION_TYPE> const compression_types{COMPRESSION_TYPE::COMPRESSION_ZLIB};
+    return compression_types;
+}
+
+/**
+ * Allow to estimate if data is worth compressing, computing the
+ * byte entropy of a sample of it.
+ *
+ * @param data a pointer to the data
+ * @param length the data length
+ * @return true if the data is likely to shrink, false otherwise
+ */
+bool compression::compressible(uint8_t const *data, size_t length) {
+    if (length < MIN_SIZE) return false;
+    std::array<uint32_t, 256> counts{};
+    size_t sampled = 0;
+    size_t stride = length / SAMPLES;
+    for (size_t i = 0; i < SAMPLES; i++) {
+        uint8_t const *sample = data + i * stride;
+        size_t sample_size = std::min(SAMPLE_SIZE, length - i * stride);
+        for (size_t j = 0; j < sample_size; j++) counts[sample[j]]++;
+        sampled += sample_size;
+    }
+    double entropy = 0;
+    for (auto count : counts) {
+        if (count == 0) continue;
+        double p = static_cast<double>(count) / static_cast<double>(sampled);
+        entropy -= p * std::log2(p);
+    }
+    return entropy < MAX_ENTROPY;
+}
+
+/**
+ * Allow to compress data, if it fits in the provided buffer. A buffer
+ * smaller than the data allows to keep the compressed data only if it shrinks.
+ *
+ * @param compression_type the compression type
+ * @param data a pointer to the data
+ * @param length the data length
+ * @param out a pointer to the buffer the compressed data has to be written in
+ * @param capacity the buffer size
+ * @return the compressed data length, 0 if it doesn't fit in the buffer
+ */
+size_t compression::compress(
+        COMPRESSION_TYPE compression_type,
+        uint8_t const *data,
+        size_t length,
+        uint8_t *out,
+        size_t capacity
+) {
+    if (compression_type != COMPRESSION_TYPE::COMPRESSION_ZLIB) return 0;
+    uLongf out_length = capacity;
+    // the fastest level, since the data is compressed while it is sent
+    if (compress2(out, &out_length, data, length, Z_BEST_SPEED) != Z_OK) return 0;
+    return out_length;
+}
+
+/**
+ * Allow to decompress the data of a ZCONTENT TLV
+ *
+ * @param compression_type the compression type
+ * @param data a pointer to the compressed data
+ * @param length the compressed data length
+ * @param out the buffer the decompressed data has to be written in
+ * @return true if the data has been decompressed, false if it is not valid
+ */
+bool compression::decompress(
+        COMPRESSION_TYPE compression_type,
+        uint8_t const *data,
+        size_t length,
+        std::vector<char> &out
+) {
+    if (compression_type != COMPRESSION_TYPE::COMPRESSION_ZLIB) return false;
+    out.resize(MAX_SIZE);
+    uLongf out_length = out.size();
+    if (uncompress(reinterpret_cast<Bytef *>(out.data()), &out_length, data, length) != Z_OK) return false;
+    out.resize(out_length);
+    return true;
+}
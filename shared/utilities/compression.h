@@ -0,0 +1,44 @@
+#ifndef REMOTE_BACKUP_M1_COMPRESSION_H
+#define REMOTE_BACKUP_M1_COMPRESSION_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "../communication/types.h"
+
+/*
+ * Per-TLV compression of the file data. Once a compression type has been
+ * negotiated during authentication, each CONTENT TLV whose data is
+ * compressible is sent as a ZCONTENT TLV instead. The data is compressed
+ * only if a sample of it doesn't look random (e.g. already compressed or
+ * encrypted files) and it is kept only if it actually shrinks, so that
+ * incompressible data costs only the sampling.
+ */
+namespace compression {
+    // data shorter than this is never compressed
+    size_t const MIN_SIZE = 256;
+    // maximum decompressed size of a ZCONTENT TLV
+    size_t const MAX_SIZE = 64 * 1024;
+
+    std::vector<communication::COMPRESSION_TYPE> const &supported();
+
+    bool compressible(uint8_t const *data, size_t length);
+
+    size_t compress(
+            communication::COMPRESSION_TYPE compression_type,
+            uint8_t const *data,
+            size_t length,
+            uint8_t *out,
+            size_t capacity
+    );
+
+    bool decompress(
+            communication::COMPRESSION_TYPE compression_type,
+            uint8_t const *data,
+            size_t length,
+            std::vector<char> &out
+    );
+}
+
+
+#endif //REMOTE_BACKUP_M1_COMPRESSION_H
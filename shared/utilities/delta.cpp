@@ -0,0 +1,149 @@
+#include "delta.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <boost/uuid/detail/md5.hpp>
+
+using boost::uuids::detail::md5;
+
+namespace {
+    /**
+     * Allow to write an unsigned integer in big endian order
+     *
+     * @param value the value that has to be written
+     * @param size the number of bytes that have to be written
+     * @param out the destination
+     * @return void
+     */
+    void put_be(uint64_t value, size_t size, uint8_t *out) {
+        for (size_t i = 0; i < size; i++) out[i] = (value >> (size - 1 - i) * 8) & 0xFF;
+    }
+
+    /**
+     * Allow to read an unsigned integer stored in big endian order
+     *
+     * @param in the source
+     * @param size the number of bytes that have to be read
+     * @return the read value
+     */
+    uint64_t get_be(uint8_t const *in, size_t size) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < size; i++) value = value << 8 | in[i];
+        return value;
+    }
+}
+
+/**
+ * Allow to compute the checksum of a block from scratch
+ *
+ * @param data a pointer to the block data
+ * @param length the block length
+ * @return void
+ */
+void delta::rolling_checksum::reset(uint8_t const *data, size_t length) {
+    this->a_ = 0;
+    this->b_ = 0;
+    this->length_ = length;
+    for (size_t i = 0; i < length; i++) {
+        this->a_ += data[i];
+        this->b_ += (length - i) * data[i];
+    }
+}
+
+/**
+ * Allow to slide the checksum window by one byte
+ *
+ * @param out the byte leaving the window
+ * @param in the byte entering the window
+ * @return void
+ */
+void delta::rolling_checksum::roll(uint8_t out, uint8_t in) {
+    this->a_ += in - out;
+    this->b_ += this->a_ - this->length_ * out;
+}
+
+/**
+ * Allow to obtain the checksum of the current window
+ *
+ * @return the checksum value
+ */
+uint32_t delta::rolling_checksum::value() const {
+    return (this->a_ & 0xFFFF) | (this->b_ << 16);
+}
+
+/**
+ * Allow to obtain the block size used for a file of a given size:
+ * it grows with the square root of the file size, so that both the
+ * signatures and the literal data around a change stay small
+ *
+ * @param file_size the size of the stored version of the file
+ * @return the block size
+ */
+size_t delta::block_size(uintmax_t file_size) {
+    auto size = static_cast<size_t>(std::sqrt(static_cast<double>(file_size))) & ~size_t{63};
+    return std::clamp<size_t>(size, 2048, 64 * 1024);
+}
+
+/**
+ * Allow to compute the strong checksum (MD5) of a block
+ *
+ * @param data a pointer to the block data
+ * @param length the block length
+ * @return the strong checksum
+ */
+delta::strong_checksum_type delta::strong_checksum(uint8_t const *data, size_t length) {
+    md5 hash;
+    hash.process_bytes(data, length);
+    md5::digest_type digest;
+    hash.get_digest(digest);
+    strong_checksum_type result;
+    for (size_t i = 0; i < 4; i++) put_be(digest[i], 4, result.data() + 4 * i);
+    return result;
+}
+
+/**
+ * Allow to pack a block signature in SIGNATURE_SIZE bytes
+ *
+ * @param signature the block signature
+ * @param out the destination
+ * @return void
+ */
+void delta::pack_signature(block_signature const &signature, uint8_t *out) {
+    put_be(signature.weak, 4, out);
+    std::copy(signature.strong.cbegin(), signature.strong.cend(), out + 4);
+}
+
+/**
+ * Allow to unpack a block signature
+ *
+ * @param in the packed block signature
+ * @return the block signature
+ */
+delta::block_signature delta::unpack_signature(uint8_t const *in) {
+    block_signature signature{static_cast<uint32_t>(get_be(in, 4)), {}};
+    std::copy(in + 4, in + SIGNATURE_SIZE, signature.strong.begin());
+    return signature;
+}
+
+/**
+ * Allow to pack a COPY TLV value in COPY_SIZE bytes
+ *
+ * @param offset the offset of the copied range in the stored version
+ * @param length the length of the copied range
+ * @param out the destination
+ * @return void
+ */
+void delta::pack_copy(uint64_t offset, uint32_t length, uint8_t *out) {
+    put_be(offset, 8, out);
+    put_be(length, 4, out + 8);
+}
+
+/**
+ * Allow to unpack a COPY TLV value
+ *
+ * @param in the packed COPY TLV value
+ * @return an std::pair containing the offset and the length of the copied range
+ */
+std::pair<uint64_t, uint32_t> delta::unpack_copy(uint8_t const *in) {
+    return {get_be(in, 8), static_cast<uint32_t>(get_be(in + 8, 4))};
+}
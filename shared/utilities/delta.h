@@ -0,0 +1,60 @@
+#ifndef REMOTE_BACKUP_M1_DELTA_H
+#define REMOTE_BACKUP_M1_DELTA_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+/*
+ * Building blocks of the delta UPDATE. The server splits the stored
+ * version of a file in blocks and sends, for each one of them, a
+ * weak rolling checksum and a strong checksum. The client slides a
+ * block-sized window over the new version looking for blocks the
+ * server already has, and sends only COPY references to them and
+ * the literal data in between.
+ */
+namespace delta {
+    // packed block signature size: 4 bytes weak checksum and 16 bytes strong checksum
+    size_t const SIGNATURE_SIZE = 4 + 16;
+    // packed COPY TLV value size: 8 bytes offset and 4 bytes length in the stored version
+    size_t const COPY_SIZE = 8 + 4;
+
+    typedef std::array<uint8_t, 16> strong_checksum_type;
+
+    struct block_signature {
+        uint32_t weak;
+        strong_checksum_type strong;
+    };
+
+    /*
+     * The rsync weak checksum. It can be rolled one byte at time
+     * along the data in constant time.
+     */
+    class rolling_checksum {
+        uint32_t a_ = 0;
+        uint32_t b_ = 0;
+        size_t length_ = 0;
+    public:
+        void reset(uint8_t const *data, size_t length);
+
+        void roll(uint8_t out, uint8_t in);
+
+        [[nodiscard]] uint32_t value() const;
+    };
+
+    size_t block_size(uintmax_t file_size);
+
+    strong_checksum_type strong_checksum(uint8_t const *data, size_t length);
+
+    void pack_signature(block_signature const &signature, uint8_t *out);
+
+    block_signature unpack_signature(uint8_t const *in);
+
+    void pack_copy(uint64_t offset, uint32_t length, uint8_t *out);
+
+    std::pair<uint64_t, uint32_t> unpack_copy(uint8_t const *in);
+}
+
+
+#endif //REMOTE_BACKUP_M1_DELTA_H
@@ -0,0 +1,95 @@
+#include "hasher.h"
+#include <stdexcept>
+#include <boost/algorithm/hex.hpp>
+
+using boost::uuids::detail::md5;
+using namespace communication;
+
+/**
+ * Construct a hasher instance std::shared_ptr for a given digest type
+ *
+ * @param digest_type the digest type
+ * @return a new constructed hasher instance std::shared_ptr
+ */
+std::shared_ptr<hasher> hasher::get_instance(DIGEST_TYPE digest_type) {
+    switch (digest_type) {
+        case DIGEST_TYPE::DIGEST_MD5:
+            return std::make_shared<md5_hasher>();
+        case DIGEST_TYPE::DIGEST_SHA256:
+            return std::make_shared<sha256_hasher>();
+        default:
+            throw std::invalid_argument{"Unsupported digest type"};
+    }
+}
+
+/**
+ * Provide the supported digest types, ordered from the preferred one
+ *
+ * @return the supported digest types
+ */
+std::vector<DIGEST_TYPE> const &hasher::supported() {
+    static std::vector<DIGEST_TYPE> const digest_types{DIGEST_TYPE::DIGEST_SHA256, DIGEST_TYPE::DIGEST_MD5};
+    return digest_types;
+}
+
+/**
+ * Allow to add data to the digest computation
+ *
+ * @param data a pointer to the data
+ * @param length the data length
+ * @return void
+ */
+void md5_hasher::update(void const *data, size_t length) {
+    this->hash_.process_bytes(data, length);
+}
+
+/**
+ * Allow to obtain the string representation of the digest
+ *
+ * @return the string representation of the digest
+ */
+std::string md5_hasher::digest() {
+    md5::digest_type digest;
+    this->hash_.get_digest(digest);
+    const auto int_digest = reinterpret_cast<const int *>(&digest);
+    std::string result;
+    boost::algorithm::hex(int_digest, int_digest + (sizeof(md5::digest_type) / sizeof(int)),
+                          std::back_inserter(result));
+    return result;
+}
+
+/**
+ * Construct a sha256_hasher instance
+ *
+ * @return a new constructed sha256_hasher instance
+ */
+sha256_hasher::sha256_hasher() : ctx_{EVP_MD_CTX_new(), &EVP_MD_CTX_free} {
+    if (!this->ctx_ || !EVP_DigestInit_ex(this->ctx_.get(), EVP_sha256(), nullptr)) {
+        throw std::runtime_error{"Failed to initialize SHA256 context"};
+    }
+}
+
+/**
+ * Allow to add data to the digest computation
+ *
+ * @param data a pointer to the data
+ * @param length the data length
+ * @return void
+ */
+void sha256_hasher::update(void const *data, size_t length) {
+    EVP_DigestUpdate(this->ctx_.get(), data, length);
+}
+
+/**
+ * Allow to obtain the string representation of the digest
+ *
+ * @return the string representation of the digest
+ */
+std::string sha256_hasher::digest() {
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int length;
+    EVP_DigestFinal_ex(this->ctx_.get(), digest, &length);
+    std::string result;
+    boost::algorithm::hex(digest, digest + length, std::back_inserter(result));
+    return result;
+}
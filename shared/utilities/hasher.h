@@ -0,0 +1,57 @@
+#ifndef REMOTE_BACKUP_M1_HASHER_H
+#define REMOTE_BACKUP_M1_HASHER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/uuid/detail/md5.hpp>
+#include <openssl/evp.h>
+#include "../communication/types.h"
+
+/*
+ * This class provides an abstraction of an incremental hash function.
+ * Data can be provided through multiple update() invocations, then
+ * digest() returns the string representation of the final digest.
+ * The concrete implementation is selected through the DIGEST_TYPE
+ * negotiated between client and server.
+ */
+class hasher {
+public:
+    static std::shared_ptr<hasher> get_instance(communication::DIGEST_TYPE digest_type);
+
+    static std::vector<communication::DIGEST_TYPE> const &supported();
+
+    virtual void update(void const *data, size_t length) = 0;
+
+    virtual std::string digest() = 0;
+
+    virtual ~hasher() = default;
+};
+
+/*
+ * MD5 implementation of hasher
+ */
+class md5_hasher : public hasher {
+    boost::uuids::detail::md5 hash_;
+public:
+    void update(void const *data, size_t length) override;
+
+    std::string digest() override;
+};
+
+/*
+ * SHA256 implementation of hasher. It relies on OpenSSL, which
+ * uses the SHA extensions or the SIMD units of the CPU when available.
+ */
+class sha256_hasher : public hasher {
+    std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)> ctx_;
+public:
+    sha256_hasher();
+
+    void update(void const *data, size_t length) override;
+
+    std::string digest() override;
+};
+
+
+#endif //REMOTE_BACKUP_M1_HASHER_H
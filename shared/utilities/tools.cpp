@@ -1,12 +1,16 @@
 #include "tools.h"
+#include "hasher.h"
 #include <boost/algorithm/hex.hpp>
 #include <boost/asio.hpp>
 #include <openssl/sha.h>
 #include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
 
-using boost::uuids::detail::md5;
 namespace fs = boost::filesystem;
 
+size_t const tools::HASH_BLOCK_SIZE = 1024 * 1024;
+
 /**
 * Create a sign to uniquely identify a specific resource.
 *
@@ -68,58 +72,52 @@ std::pair<bool, std::vector<std::string>> tools::match_and_parse(boost::regex co
 * @return a string representation of the str digest
 */
 std::string tools::MD5_hash(std::string const &str) {
-    md5 hash;
-    md5::digest_type digest;
-    hash.process_bytes(str.data(), str.size());
-    hash.get_digest(digest);
-    return MD5_to_string(digest);
+    md5_hasher hash;
+    hash.update(str.data(), str.size());
+    return hash.digest();
 }
 
 /**
-* An MD5 based hash function to obtain a file digest
+* A hash function to obtain a file digest. The file is read in
+* HASH_BLOCK_SIZE blocks, so the used memory doesn't depend on the file size.
 *
 * @param absolute_path the absolute path location of the file
 * @param relative_path the relative path location that has to be included in digest computation
-* @return a string representation of file MD5 digest
+* @param digest_type the algorithm used to compute the digest
+* @return a string representation of file digest
+* @throw boost::filesystem::filesystem_error if the file can't be read
 */
-std::string tools::MD5_hash(fs::path const &absolute_path, fs::path const &relative_path) {
-    fs::ifstream ifs;
-    ifs.open(absolute_path, std::ios_base::binary);
-    ifs.unsetf(std::ios::skipws);
-    std::streampos length;
-    ifs.seekg(0, std::ios::end);
-    length = ifs.tellg();
-    ifs.seekg(0, std::ios::beg);
-    md5 hash;
-    md5::digest_type digest;
+std::string tools::file_hash(
+        fs::path const &absolute_path,
+        fs::path const &relative_path,
+        communication::DIGEST_TYPE digest_type
+) {
+    // a per thread buffer avoids an allocation for each hashed file
+    thread_local std::vector<char> buffer(HASH_BLOCK_SIZE);
+    auto hash = hasher::get_instance(digest_type);
 
-    std::vector<char> file_buffer(length);
-    file_buffer.reserve(length);
-    file_buffer.insert(file_buffer.begin(),
-                       std::istream_iterator<char>(ifs),
-                       std::istream_iterator<char>());
+    int fd = open(absolute_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw fs::filesystem_error{"Failed to open file", absolute_path,
+                                   boost::system::error_code{errno, boost::system::system_category()}};
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
 
     std::string relative_path_str{relative_path.generic_path().string()};
-    hash.process_bytes(relative_path_str.c_str(), relative_path_str.size());
-    hash.process_bytes(&*file_buffer.cbegin(), length);
-    hash.get_digest(digest);
-
-    return MD5_to_string(digest);
-}
-
-/**
-* Allow to obtain a string representation from an MD5 digest
-*
-* @param digest the digest that has to be converted
-* @return a string representation of an MD5 digest
-*/
-std::string tools::MD5_to_string(boost::uuids::detail::md5::digest_type const &digest) {
-    const auto int_digest = reinterpret_cast<const int *>(&digest);
-    std::string result;
+    hash->update(relative_path_str.c_str(), relative_path_str.size());
+    ssize_t length;
+    while ((length = read(fd, buffer.data(), buffer.size())) != 0) {
+        if (length == -1) {
+            if (errno == EINTR) continue;
+            boost::system::error_code ec{errno, boost::system::system_category()};
+            close(fd);
+            throw fs::filesystem_error{"Failed to read file", absolute_path, ec};
+        }
+        hash->update(buffer.data(), length);
+    }
+    close(fd);
 
-    boost::algorithm::hex(int_digest, int_digest + (sizeof(md5::digest_type) / sizeof(int)),
-                          std::back_inserter(result));
-    return result;
+    return hash->digest();
 }
 
 /**
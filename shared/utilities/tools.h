@@ -3,10 +3,12 @@
 #include <string>
 #include <boost/filesystem.hpp>
 #include <boost/regex.hpp>
-#include <boost/uuid/detail/md5.hpp>
+#include "../communication/types.h"
 
 // Utility static methods
 struct tools {
+    static size_t const HASH_BLOCK_SIZE;
+
     static std::string create_sign(
             boost::filesystem::path const &relative_path,
             std::string const &digest
@@ -21,9 +23,10 @@ struct tools {
 
     static std::string MD5_hash(std::string const &str);
 
-    static std::string MD5_hash(
+    static std::string file_hash(
             boost::filesystem::path const &absolute_path,
-            boost::filesystem::path const &relative_path
+            boost::filesystem::path const &relative_path,
+            communication::DIGEST_TYPE digest_type = communication::DIGEST_TYPE::DIGEST_MD5
     );
 
     static std::string SHA512_hash(std::string const &str);
@@ -33,9 +36,6 @@ struct tools {
             std::string const &username,
             std::string const &password
     );
-
-private:
-    static std::string MD5_to_string(boost::uuids::detail::md5::digest_type const &digest);
 };
 
 